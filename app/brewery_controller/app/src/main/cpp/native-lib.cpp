@@ -1,5 +1,7 @@
 #include <jni.h>
 #include <string>
+#include <vector>
+#include "include/service/timeseries.h"
 
 extern "C"
 JNIEXPORT jstring JNICALL
@@ -9,3 +11,39 @@ Java_com_creativejuicesbrewing_brewerycontroller_MainActivity_stringFromJNI(
     std::string hello = "Hello from C++";
     return env->NewStringUTF(hello.c_str());
 }
+
+/*
+ * Decode an application/x-brewctl-ts response (e.g. from /session/{id}/history)
+ * into a flat array of points: [t0, v0..., t1, v1..., ...], where each
+ * timestamp is followed by one value per column.  Returns null if the data is
+ * malformed.
+ */
+extern "C"
+JNIEXPORT jdoubleArray JNICALL
+Java_com_creativejuicesbrewing_brewerycontroller_MainActivity_decodeTimeSeries(
+        JNIEnv *env,
+        jobject /* this */,
+        jbyteArray data) {
+    const jsize len = env->GetArrayLength(data);
+    jbyte *bytes = env->GetByteArrayElements(data, nullptr);
+
+    TimeSeries::Decoder decoder(reinterpret_cast<const uint8_t *>(bytes), len);
+    std::vector<double> points;
+    double values[TimeSeries::MAX_COLUMNS];
+    int64_t t;
+
+    while (decoder.next(t, values)) {
+        points.push_back(static_cast<double>(t));
+        points.insert(points.end(), values, values + decoder.columns());
+    }
+
+    env->ReleaseByteArrayElements(data, bytes, JNI_ABORT);
+
+    if (decoder.error()) {
+        return nullptr;
+    }
+
+    jdoubleArray result = env->NewDoubleArray(points.size());
+    env->SetDoubleArrayRegion(result, 0, points.size(), points.data());
+    return result;
+}
@@ -26,4 +26,12 @@ public class MainActivity extends AppCompatActivity {
      * which is packaged with this application.
      */
     public native String stringFromJNI();
+
+    /**
+     * Decodes an application/x-brewctl-ts time series, as returned by the
+     * controller's history endpoint, into a flat array of points: each
+     * timestamp followed by one value per column.  Returns null if the data
+     * is malformed.
+     */
+    public native double[] decodeTimeSeries(byte[] data);
 }
@@ -0,0 +1,119 @@
+/*
+    alarm.cc: alarm rules and alarm events, and a store through which the alarm engine publishes immutable snapshots of
+    the current alarm state to readers (the display, the web service).
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/alarm.h"
+#include <boost/algorithm/string.hpp>
+
+using boost::iequals;
+using std::string;
+
+
+// Metric, aggregate and operator names, as used in the alarmrule table
+static const struct
+{
+    AlarmMetric_t       metric;
+    const char *        name;
+} metricNames[] =
+{
+    {ALARM_METRIC_TEMP,         "temp"},
+    {ALARM_METRIC_DEVIATION,    "deviation"},
+    {ALARM_METRIC_DUTY,         "duty"},
+    {ALARM_METRIC_STALE,        "stale"}
+};
+
+static const struct
+{
+    AlarmAggregate_t    aggregate;
+    const char *        name;
+} aggregateNames[] =
+{
+    {ALARM_AGG_LAST,            "last"},
+    {ALARM_AGG_MEAN,            "mean"},
+    {ALARM_AGG_MIN,             "min"},
+    {ALARM_AGG_MAX,             "max"},
+    {ALARM_AGG_VARIANCE,        "variance"}
+};
+
+static const struct
+{
+    AlarmOperator_t     op;
+    const char *        name;
+} operatorNames[] =
+{
+    {ALARM_OP_LT,               "<"},
+    {ALARM_OP_LE,               "<="},
+    {ALARM_OP_GT,               ">"},
+    {ALARM_OP_GE,               ">="}
+};
+
+
+// ctor - start with an empty alarm set, so that readers never see a null ptr.
+//
+AlarmStore::AlarmStore() noexcept
+    : current_(new AlarmSet_t()),
+      version_(0)
+{
+}
+
+
+// publish() - assign the next version number to <alarms> and make it the current alarm set.  The store takes ownership
+// of <alarms>, which must not be modified after this call.  Only the alarm engine thread should call this method.
+//
+void AlarmStore::publish(AlarmSet_t * const alarms) noexcept
+{
+    alarms->version = version_ + 1;
+
+    current_.store(alarms);
+    version_ = alarms->version;
+}
+
+
+// current() - return the most-recently-published alarm set.  May be called from any thread, and never waits for the
+// alarm engine or for other readers.
+//
+AlarmSet_sptr_t AlarmStore::current() const noexcept
+{
+    return current_.load();
+}
+
+
+// metricFromName() - return the metric named by <name>, or ALARM_METRIC_NONE if no metric matches.
+//
+AlarmMetric_t AlarmStore::metricFromName(const string& name) noexcept
+{
+    for(auto& m : metricNames)
+        if(iequals(name, m.name))
+            return m.metric;
+
+    return ALARM_METRIC_NONE;
+}
+
+
+// aggregateFromName() - return the aggregate named by <name>.  An empty or unrecognised name means ALARM_AGG_LAST.
+//
+AlarmAggregate_t AlarmStore::aggregateFromName(const string& name) noexcept
+{
+    for(auto& a : aggregateNames)
+        if(iequals(name, a.name))
+            return a.aggregate;
+
+    return ALARM_AGG_LAST;
+}
+
+
+// operatorFromName() - return the comparison operator named by <name>, or ALARM_OP_INVALID if no operator matches.
+//
+AlarmOperator_t AlarmStore::operatorFromName(const string& name) noexcept
+{
+    for(auto& o : operatorNames)
+        if(name == o.name)
+            return o.op;
+
+    return ALARM_OP_INVALID;
+}
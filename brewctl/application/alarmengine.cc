@@ -0,0 +1,441 @@
+/*
+    alarmengine.cc: evaluates the alarm rules stored in the database against the live telemetry stream.  Each rule
+    keeps a bucketed sliding-window aggregate of its metric, updated incrementally as records arrive on the telemetry
+    bus, so evaluating a rule never touches the database.  Alarms are raised and cleared as rules' conditions change;
+    alarm events are written to the database and published, via the registry's AlarmStore, to the display and web
+    service.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/alarmengine.h"
+#include "include/framework/log.h"
+#include "include/framework/registry.h"
+#include "include/sqlite/sqlitestmt.h"
+#include "include/util/validator.h"
+#include <string>
+#include <utility>
+
+extern "C"
+{
+#include <unistd.h>         // ::usleep()
+}
+
+using std::string;
+using std::vector;
+namespace Validator = Util::Validator;
+
+
+static const int
+    DEFAULT_POLL_INTERVAL_MS    = 500,      // Default interval between drains of the telemetry bus
+    DEFAULT_RELOAD_INTERVAL_S   = 60,       // Default interval between reloads of the alarm rules
+    DEFAULT_HISTORY_LEN         = 20,       // Default number of cleared alarms retained for the web service
+    MAX_RECORDS_PER_DRAIN       = 1024;     // Maximum number of records consumed per poll
+
+
+// ctor - trivial initialisation of members
+//
+AlarmEngine::AlarmEngine() noexcept
+    : Thread(),
+      startTime_(0.0),
+      lastReload_(0.0),
+      changed_(false),
+      pollInterval_(DEFAULT_POLL_INTERVAL_MS),
+      reloadInterval_(DEFAULT_RELOAD_INTERVAL_S),
+      historyLen_(DEFAULT_HISTORY_LEN)
+{
+}
+
+
+// init() - subscribe to the telemetry bus and load the alarm rules.  Alarms left open by a previous run are closed:
+// their state is unknown, and any that still apply will be raised again once their windows fill.  A failure to load
+// the rules (e.g. a database which pre-dates the alarmrule table) is logged, but is not fatal.
+//
+bool AlarmEngine::init(Error * const err) noexcept
+{
+    auto& config = Registry::instance().config();
+
+    subscriber_.reset(new TelemetrySubscriber(Registry::instance().telemetry()));
+    if(subscriber_ == nullptr)
+    {
+        formatError(err, MALLOC_FAILED);
+        return false;
+    }
+
+    pollInterval_ = config.get("alarm.poll_interval_ms", DEFAULT_POLL_INTERVAL_MS, Validator::gt0);
+    reloadInterval_ = config.get("alarm.reload_interval_s", DEFAULT_RELOAD_INTERVAL_S, Validator::gt0);
+    historyLen_ = config.get("alarm.history_len", DEFAULT_HISTORY_LEN, Validator::ge0);
+
+    startTime_ = TelemetryBus::now() / 1000.0;
+
+    SQLiteStmt stmt;
+    Error closeErr;
+    if(!Registry::instance().db().prepare("UPDATE alarm SET date_cleared=CURRENT_TIMESTAMP WHERE date_cleared IS NULL",
+                                          stmt, &closeErr)
+       || !stmt.execute(&closeErr))
+        logWarning("AlarmEngine: failed to close stale alarms: %s", closeErr.message().c_str());
+
+    Error loadErr;
+    if(!loadRules(&loadErr))
+        logWarning("AlarmEngine: failed to load alarm rules (%s); alarms disabled", loadErr.message().c_str());
+
+    publish(startTime_);
+
+    return true;
+}
+
+
+// run() - main loop.  Periodically drain the telemetry bus, feeding each record into the rules which monitor it, then
+// evaluate all rules.
+//
+bool AlarmEngine::run() noexcept
+{
+    running_ = true;
+    setName("alarm");
+
+    while(!stop_)
+    {
+        updateTargets();
+
+        TelemetryRecord_t record;
+        for(int n = 0; (n < MAX_RECORDS_PER_DRAIN) && subscriber_->next(record); ++n)
+            observe(record);
+
+        const double now = TelemetryBus::now() / 1000.0;
+
+        if((now - lastReload_) >= reloadInterval_)
+        {
+            Error err;
+            if(!loadRules(&err))
+                logWarning("AlarmEngine: failed to reload alarm rules: %s", err.message().c_str());
+        }
+
+        for(auto& effector : effectors_)
+            feedDuty(effector.first, now);
+
+        evaluate(now);
+
+        if(changed_)
+            publish(now);
+
+        ::usleep(pollInterval_ * 1000);
+    }
+
+    logInfo("AlarmEngine stopping");
+    running_ = false;
+
+    return true;
+}
+
+
+// loadRules() - (re)load the enabled alarm rules from the database.  Rules whose definitions are unchanged keep their
+// window state and alarm status; rules which have been removed or changed have any active alarm cleared.
+//
+bool AlarmEngine::loadRules(Error * const err) noexcept
+{
+    const double now = TelemetryBus::now() / 1000.0;
+    vector<RuleState_t> rules;
+    SQLiteStmt stmt;
+
+    lastReload_ = now;
+
+    if(!Registry::instance().db().prepare("SELECT id, name, metric, target_id, aggregate, operator, threshold, window_s "
+                                          "FROM alarmrule WHERE enabled=1 ORDER BY id", stmt, err))
+        return false;
+
+    while(stmt.step(err))
+    {
+        AlarmRule_t rule;
+
+        rule.id         = stmt["id"].get<int>();
+        rule.name       = stmt["name"].get<string>();
+        rule.metric     = AlarmStore::metricFromName(stmt["metric"].get<string>());
+        rule.target     = stmt["target_id"].get<int>();
+        rule.aggregate  = AlarmStore::aggregateFromName(stmt["aggregate"].get<string>());
+        rule.op         = AlarmStore::operatorFromName(stmt["operator"].get<string>());
+        rule.threshold  = stmt["threshold"].get<double>();
+        rule.window     = stmt["window_s"].get<int>();
+
+        if((rule.metric == ALARM_METRIC_NONE) || (rule.op == ALARM_OP_INVALID) || (rule.window < 0))
+        {
+            logWarning("AlarmEngine: ignoring invalid alarm rule %d (%s)", rule.id, rule.name.c_str());
+            continue;
+        }
+
+        rules.push_back({rule, Util::WindowedAggregate(rule.window), false, Alarm_t()});
+    }
+
+    if((err != nullptr) && err->code())
+        return false;
+
+    for(auto& state : rules)
+    {
+        for(auto& old : rules_)
+        {
+            if((old.rule.id == state.rule.id) && sameDefinition(old.rule, state.rule))
+            {
+                state = std::move(old);
+                old.active = false;
+                break;
+            }
+        }
+
+        if((state.rule.metric == ALARM_METRIC_DUTY) && (effectors_.find(state.rule.target) == effectors_.end()))
+            effectors_[state.rule.target] = {false, now};
+    }
+
+    // Clear any alarms belonging to rules which no longer exist, or whose definitions have changed
+    for(auto& old : rules_)
+        if(old.active)
+            clear(old, now);
+
+    if(rules.size() != rules_.size())
+        logInfo("AlarmEngine: %u alarm rule(s) loaded", (unsigned int) rules.size());
+
+    rules_ = std::move(rules);
+
+    return true;
+}
+
+
+// sameDefinition() - return true if <lhs> and <rhs> describe the same condition.
+//
+bool AlarmEngine::sameDefinition(const AlarmRule_t& lhs, const AlarmRule_t& rhs) noexcept
+{
+    return (lhs.name == rhs.name) && (lhs.metric == rhs.metric) && (lhs.target == rhs.target)
+           && (lhs.aggregate == rhs.aggregate) && (lhs.op == rhs.op) && (lhs.threshold == rhs.threshold)
+           && (lhs.window == rhs.window);
+}
+
+
+// updateTargets() - refresh the target temperatures of active sessions from the most recent session snapshot.  These
+// are needed to compute the "deviation" metric.
+//
+void AlarmEngine::updateTargets() noexcept
+{
+    const SessionSnapshotSet_sptr_t snapshot = Registry::instance().snapshots().current();
+
+    targets_.clear();
+    for(const auto& s : snapshot->sessions)
+        if(s.active && s.targetTemp)
+            targets_[s.id] = s.targetTemp.C();
+}
+
+
+// observe() - feed a single telemetry record into the rules which monitor it.
+//
+void AlarmEngine::observe(const TelemetryRecord_t& record) noexcept
+{
+    const double t = record.timestamp / 1000.0;
+
+    switch(record.type)
+    {
+        case TELEMETRY_SENSOR_SAMPLE:
+        {
+            lastSample_[record.channel] = t;
+
+            auto target = targets_.find(record.sessionId);
+
+            for(auto& state : rules_)
+            {
+                if((state.rule.metric == ALARM_METRIC_TEMP) && (state.rule.target == record.channel))
+                    state.agg.add(t, record.sensor.tempC);
+                else if((state.rule.metric == ALARM_METRIC_DEVIATION) && (state.rule.target == record.sessionId)
+                        && (target != targets_.end()))
+                    state.agg.add(t, record.sensor.tempC - target->second);
+            }
+            break;
+        }
+
+        case TELEMETRY_EFFECTOR_TRANSITION:
+        {
+            auto effector = effectors_.find(record.channel);
+            if(effector != effectors_.end())
+            {
+                feedDuty(record.channel, t);
+                effector->second.on = record.effector.state != 0;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+
+// feedDuty() - add the time which the effector on <channel> has spent in its current state, since it was last fed, to
+// the duty-cycle rules which monitor the effector.
+//
+void AlarmEngine::feedDuty(const int channel, const double now) noexcept
+{
+    EffectorState_t& effector = effectors_[channel];
+
+    if(now <= effector.since)
+        return;
+
+    for(auto& state : rules_)
+        if((state.rule.metric == ALARM_METRIC_DUTY) && (state.rule.target == channel))
+            state.agg.add(now, effector.on ? 1.0 : 0.0, now - effector.since);
+
+    effector.since = now;
+}
+
+
+// value() - compute the current value of the aggregate monitored by rule <state>.  Returns false if the rule cannot
+// yet be evaluated, i.e. if its window has not been filled.
+//
+bool AlarmEngine::value(const RuleState_t& state, const double now, double& val) const noexcept
+{
+    if(state.rule.metric == ALARM_METRIC_STALE)
+    {
+        auto last = lastSample_.find(state.rule.target);
+        val = now - ((last != lastSample_.end()) ? last->second : startTime_);
+        return true;
+    }
+
+    if(state.agg.weight() <= 0.0)
+        return false;
+
+    if(state.rule.window && !state.agg.full(now))
+        return false;
+
+    switch(state.rule.aggregate)
+    {
+        case ALARM_AGG_MEAN:        val = state.agg.mean();         break;
+        case ALARM_AGG_MIN:         val = state.agg.min();          break;
+        case ALARM_AGG_MAX:         val = state.agg.max();          break;
+        case ALARM_AGG_VARIANCE:    val = state.agg.variance();     break;
+        default:                    val = state.agg.last();         break;
+    }
+
+    return true;
+}
+
+
+// compare() - return the result of the comparison "<val> <op> <threshold>".
+//
+bool AlarmEngine::compare(const double val, const AlarmOperator_t op, const double threshold) noexcept
+{
+    switch(op)
+    {
+        case ALARM_OP_LT:   return val < threshold;
+        case ALARM_OP_LE:   return val <= threshold;
+        case ALARM_OP_GT:   return val > threshold;
+        case ALARM_OP_GE:   return val >= threshold;
+        default:            return false;
+    }
+}
+
+
+// evaluate() - evaluate every rule, raising or clearing alarms as necessary.  A rule whose window has emptied (e.g.
+// because its sensor has stopped reporting, or its session has become inactive) has its alarm cleared: its condition
+// can no longer be demonstrated.  Missing data is the business of "stale" rules.
+//
+void AlarmEngine::evaluate(const double now) noexcept
+{
+    for(auto& state : rules_)
+    {
+        if(state.rule.metric != ALARM_METRIC_STALE)
+            state.agg.advance(now);
+
+        double val;
+        if(!value(state, now, val))
+        {
+            if(state.active && (state.agg.weight() <= 0.0))
+                clear(state, now);
+
+            continue;
+        }
+
+        const bool condition = compare(val, state.rule.op, state.rule.threshold);
+
+        if(condition && !state.active)
+            raise(state, val, now);
+        else if(!condition && state.active)
+            clear(state, now);
+    }
+}
+
+
+// raise() - raise an alarm for rule <state>, whose aggregate has value <val>, and record it in the database.  The
+// alarm takes the id of its row in the alarm table, so that ids are stable across restarts; the row is found by rule
+// id, rather than by sqlite3_last_insert_rowid(), as other threads insert rows through the same connection.
+//
+void AlarmEngine::raise(RuleState_t& state, const double val, const double now) noexcept
+{
+    state.active = true;
+    state.alarm = {0, state.rule.id, state.rule.name, val, (time_t) now, 0};
+    changed_ = true;
+
+    logWarning("Alarm raised: %s (value %.3f)", state.rule.name.c_str(), val);
+
+    SQLiteStmt stmt;
+    Error err;
+    if(!Registry::instance().db().prepare("INSERT INTO alarm(rule_id, date_raised, value) "
+                                          "VALUES(:rule_id, DATETIME(:ts, 'unixepoch'), :value)", stmt, &err)
+       || !stmt.bind(":rule_id", state.rule.id, &err)
+       || !stmt.bind(":ts", (long long) now, &err)
+       || !stmt.bind(":value", val, &err)
+       || !stmt.execute(&err))
+    {
+        logWarning("AlarmEngine: failed to record alarm: %s", err.message().c_str());
+        return;
+    }
+
+    if(!Registry::instance().db().prepare("SELECT MAX(id) AS id FROM alarm "
+                                          "WHERE rule_id=:rule_id AND date_cleared IS NULL", stmt, &err)
+       || !stmt.bind(":rule_id", state.rule.id, &err)
+       || !stmt.step(&err))
+        logWarning("AlarmEngine: failed to read id of recorded alarm: %s", err.message().c_str());
+    else
+        state.alarm.id = stmt["id"].get<unsigned long long>();
+}
+
+
+// clear() - clear the active alarm for rule <state>, and record the time at which it cleared.
+//
+void AlarmEngine::clear(RuleState_t& state, const double now) noexcept
+{
+    state.active = false;
+    state.alarm.cleared = (time_t) now;
+    changed_ = true;
+
+    logInfo("Alarm cleared: %s", state.rule.name.c_str());
+
+    recent_.push_front(state.alarm);
+    while(recent_.size() > historyLen_)
+        recent_.pop_back();
+
+    SQLiteStmt stmt;
+    Error err;
+    if(!Registry::instance().db().prepare("UPDATE alarm SET date_cleared=DATETIME(:ts, 'unixepoch') "
+                                          "WHERE rule_id=:rule_id AND date_cleared IS NULL", stmt, &err)
+       || !stmt.bind(":ts", (long long) now, &err)
+       || !stmt.bind(":rule_id", state.rule.id, &err)
+       || !stmt.execute(&err))
+        logWarning("AlarmEngine: failed to record alarm clearance: %s", err.message().c_str());
+}
+
+
+// publish() - publish the current set of active and recently-cleared alarms.
+//
+void AlarmEngine::publish(const double now) noexcept
+{
+    AlarmSet_t * const alarms = new AlarmSet_t();
+    if(alarms == nullptr)
+        return;
+
+    alarms->timestamp = (time_t) now;
+
+    for(const auto& state : rules_)
+        if(state.active)
+            alarms->active.push_back(state.alarm);
+
+    alarms->recent.assign(recent_.begin(), recent_.end());
+
+    Registry::instance().alarms().publish(alarms);
+    changed_ = false;
+}
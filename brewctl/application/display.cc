@@ -51,7 +51,8 @@ Display::Display(SessionManager& sm) noexcept
       lcd_(Registry::instance().lcd()),
       lastDisplayUpdate_(0),
       displayUpdateInterval_(DEFAULT_DISPLAY_UPDATE_INTERVAL),
-      currentMode_(DM_DEFAULT)
+      currentMode_(DM_DEFAULT),
+      alarmShown_(false)
 {
     sessionDwellTime_ = Registry::instance().config()
                             .get("display.session_dwell_time", DEFAULT_SESSION_DWELL_TIME, Validator::gt0);
@@ -144,21 +145,22 @@ void Display::displayDefault() noexcept
         ::strftime(buffer, sizeof(buffer), "%H:%M", ::localtime(&tm));
         lcd_.printAt(0, 0, buffer);
 
-        const Temperature ambientTemp = sm_.ambientTemp();
-        if(ambientTemp)
-            lcd_.printAt(15, 0, "% 3d\xdf""C", (int) (ambientTemp.C() + 0.5));
+        // Render from the most recent published snapshot; this avoids touching the hardware, and guarantees that the
+        // values displayed are mutually consistent.
+        const SessionSnapshotSet_sptr_t snapshot = sm_.snapshot();
+
+        if(snapshot->ambientTemp)
+            lcd_.printAt(15, 0, "% 3d\xdf""C", (int) (snapshot->ambientTemp.C() + 0.5));
         else
             lcd_.printAt(16, 0, "--\xdf""C");
 
-        const size_t nsessions = sm_.sessions().size();
+        displayAlarms(now);
+
+        const size_t nsessions = snapshot->sessions.size();
         if(nsessions)
         {
             const size_t sessionIdx = (now / sessionDwellTime_) % nsessions;
-            auto itSession = sm_.sessions().begin();
-            for(size_t i = 0; (i < sessionIdx) && (itSession != sm_.sessions().end()); ++i)
-                ++itSession;
-
-            const auto& session = itSession->second;
+            const SessionSnapshot_t& session = snapshot->sessions[sessionIdx];
 
             // If we're about to render a new session, clear the bottom half of the LCD in preparation for writing
             // session data to it.
@@ -169,25 +171,25 @@ void Display::displayDefault() noexcept
                 lcd_.clearLine(3);
             }
 
-            lcd_.printAt(0, 2, "G%-3d", session->gyleId());
-            lcd_.printAt(0, 3, "%.20s", session->gyleName().c_str());
+            lcd_.printAt(0, 2, "G%-3d", session.gyleId);
+            lcd_.printAt(0, 3, "%.20s", session.gyleName.c_str());
             
-            if(session->isActive())
+            if(session.active)
             {
-                lcd_.putAt(5, 2, getSessionTypeIndicator(session->type()));
+                lcd_.putAt(5, 2, getSessionTypeIndicator(session.type));
 
-                lcd_.putAt(7, 2, getTempControlIndicator(session->tempControlState()));
-                if(session->vesselTempSensorInRange())
-                    lcd_.printAt(8, 2, "%4.1lf\xdf", session->currentTemp().C());
+                lcd_.putAt(7, 2, getTempControlIndicator(session.tempControlState));
+                if(session.sensorInRange)
+                    lcd_.printAt(8, 2, "%4.1lf\xdf", session.currentTemp.C());
                 else
                     lcd_.printAt(8, 2, "--.-\xdf");
 
                 const char *fmt = nullptr;
                 time_t field1 = 0, field2 = 0;
 
-                if(session->type() != SERVE)
+                if(session.type != SERVE)
                 {
-                    const time_t secsRemaining  = session->remainingTime(),
+                    const time_t secsRemaining  = session.remainingTime,
                                  days           = secsRemaining / SECS_PER_DAY,
                                  hours          = secsRemaining / SECS_PER_HOUR,
                                  minutes        = secsRemaining / SECS_PER_MINUTE;
@@ -219,7 +221,7 @@ void Display::displayDefault() noexcept
             }
             else
             {
-                lcd_.printAt(5, 2, session->isComplete() ? "Complete" : "Starts in");
+                lcd_.printAt(5, 2, session.complete ? "Complete" : "Starts in");
             }
         }
         else
@@ -228,6 +230,29 @@ void Display::displayDefault() noexcept
 }
 
 
+// displayAlarms() - show active alarms on the second line of the display, cycling through them if more than one is
+// active.  The line is cleared once all alarms have cleared.
+//
+void Display::displayAlarms(const time_t now) noexcept
+{
+    const AlarmSet_sptr_t alarms = Registry::instance().alarms().current();
+    const size_t nalarms = alarms->active.size();
+
+    if(nalarms)
+    {
+        const Alarm_t& alarm = alarms->active[(now / sessionDwellTime_) % nalarms];
+
+        lcd_.printAt(0, 1, "!%-19.19s", alarm.ruleName.c_str());
+        alarmShown_ = true;
+    }
+    else if(alarmShown_)
+    {
+        lcd_.clearLine(1);
+        alarmShown_ = false;
+    }
+}
+
+
 void Display::displayTopMenu() noexcept
 {
 }
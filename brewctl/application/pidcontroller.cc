@@ -0,0 +1,235 @@
+/*
+    pidcontroller.cc: PID controller for vessel temperature, and a relay-feedback autotuner which learns the
+    controller's gains.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/pidcontroller.h"
+#include "include/framework/log.h"
+#include <cmath>
+
+
+static const double
+    OUTPUT_MIN                  = -1.0,     // Full cooling
+    OUTPUT_MAX                  = 1.0,      // Full heating
+    DERIVATIVE_FILTER_S         = 60.0,     // Time constant of the low-pass filter applied to the derivative term
+    AUTOTUNE_PERIOD_TOLERANCE   = 0.2;      // Max relative spread of the last oscillation periods for convergence
+
+
+// ctor - controller starts with an empty integrator
+//
+PIDController::PIDController(const PIDGains_t& gains) noexcept
+    : gains_(gains)
+{
+    reset();
+}
+
+
+// reset() - clear the controller's state, e.g. when the session becomes inactive or its sensor fails.
+//
+void PIDController::reset() noexcept
+{
+    integral_ = 0.0;
+    derivative_ = 0.0;
+    lastMeasurement_ = 0.0;
+    hasLastMeasurement_ = false;
+    output_ = 0.0;
+}
+
+
+// setIntegrator() - restore the integral term, e.g. from a checkpoint.  The value is clamped to the output range.
+//
+void PIDController::setIntegrator(const double integral) noexcept
+{
+    integral_ = std::fmin(OUTPUT_MAX, std::fmax(OUTPUT_MIN, integral));
+}
+
+
+// update() - advance the controller by <dt> seconds and return its new output, in the range [<lo>, <hi>] (a subrange
+// of [-1, 1]): positive values request heating, negative values request cooling, and the magnitude is the requested
+// duty cycle.
+//
+// The derivative acts on the (low-pass-filtered) measurement rather than on the error, so that step changes in the
+// setpoint do not "kick" the output.  The integrator is only advanced while doing so does not push the output further
+// into saturation (conditional integration), which prevents wind-up during long heating/cooling runs.  Saturation is
+// judged against [<lo>, <hi>], so that the integrator also holds while the caller limits the output more tightly.
+//
+double PIDController::update(const double setpoint, const double measurement, const double dt, double lo,
+                             double hi) noexcept
+{
+    const double error = setpoint - measurement;
+
+    lo = std::fmax(OUTPUT_MIN, lo);
+    hi = std::fmin(OUTPUT_MAX, hi);
+
+    if((dt > 0.0) && hasLastMeasurement_)
+    {
+        const double rate = (measurement - lastMeasurement_) / dt;
+        derivative_ += (rate - derivative_) * (dt / (DERIVATIVE_FILTER_S + dt));
+    }
+
+    const double p = gains_.kp * error,
+                 d = -gains_.kd * derivative_;
+
+    if(dt > 0.0)
+    {
+        const double integral = integral_ + (gains_.ki * error * dt),
+                     unclamped = p + integral + d;
+
+        if(((unclamped <= hi) && (unclamped >= lo))
+           || ((unclamped > hi) && (error < 0.0))
+           || ((unclamped < lo) && (error > 0.0)))
+            integral_ = std::fmin(OUTPUT_MAX, std::fmax(OUTPUT_MIN, integral));
+    }
+
+    output_ = std::fmin(hi, std::fmax(lo, p + integral_ + d));
+
+    lastMeasurement_ = measurement;
+    hasLastMeasurement_ = true;
+
+    return output_;
+}
+
+
+// ctor
+//
+RelayAutotuner::RelayAutotuner() noexcept
+    : state_(AUTOTUNE_IDLE),
+      hysteresis_(0.0),
+      maxDuration_(0.0),
+      cyclesRequired_(0),
+      startTime_(-1.0),
+      output_(0.0),
+      lastFallTime_(-1.0),
+      cycleMax_(0.0),
+      cycleMin_(0.0),
+      ncycles_(0),
+      Ku_(0.0),
+      Tu_(0.0),
+      gains_({0.0, 0.0, 0.0})
+{
+}
+
+
+// start() - begin a relay-feedback experiment (Astrom-Hagglund).  The relay switches between full heating and full
+// cooling whenever the measurement crosses the setpoint +/- <hysteresis>, which drives the vessel into a limit cycle
+// whose period and amplitude characterise the plant.  The experiment completes once <cycles> full oscillations have
+// been observed and the last periods agree; it fails if that has not happened within <maxDuration> seconds.
+//
+void RelayAutotuner::start(const double hysteresis, const double maxDuration, const int cycles) noexcept
+{
+    state_ = AUTOTUNE_RUNNING;
+    hysteresis_ = hysteresis;
+    maxDuration_ = maxDuration;
+    cyclesRequired_ = (cycles < 2) ? 2 : ((cycles >= MAX_CYCLES) ? MAX_CYCLES - 1 : cycles);
+    startTime_ = -1.0;
+    output_ = 0.0;
+    lastFallTime_ = -1.0;
+    ncycles_ = 0;
+    Ku_ = Tu_ = 0.0;
+}
+
+
+// abort() - abandon any experiment in progress.
+//
+void RelayAutotuner::abort() noexcept
+{
+    if(state_ == AUTOTUNE_RUNNING)
+        state_ = AUTOTUNE_FAILED;
+}
+
+
+// update() - feed a new <measurement>, taken at monotonic time <now> (seconds), into the experiment; return the relay
+// output (+1: heat; -1: cool).  Returns 0 if no experiment is running.
+//
+double RelayAutotuner::update(const double setpoint, const double measurement, const double now) noexcept
+{
+    if(state_ != AUTOTUNE_RUNNING)
+        return 0.0;
+
+    if(startTime_ < 0.0)
+    {
+        startTime_ = now;
+        output_ = (measurement < setpoint) ? 1.0 : -1.0;
+        cycleMax_ = cycleMin_ = measurement;
+    }
+
+    if((now - startTime_) > maxDuration_)
+    {
+        logWarning("Autotune: no stable oscillation after %.0f seconds; giving up", now - startTime_);
+        state_ = AUTOTUNE_FAILED;
+        return 0.0;
+    }
+
+    cycleMax_ = std::fmax(cycleMax_, measurement);
+    cycleMin_ = std::fmin(cycleMin_, measurement);
+
+    if((output_ > 0.0) && (measurement > (setpoint + hysteresis_)))
+    {
+        output_ = -1.0;
+        cycleComplete(now, measurement);
+    }
+    else if((output_ < 0.0) && (measurement < (setpoint - hysteresis_)))
+        output_ = 1.0;
+
+    return (state_ == AUTOTUNE_RUNNING) ? output_ : 0.0;
+}
+
+
+// cycleComplete() - called each time the relay switches from heating to cooling.  The interval since the previous such
+// switch is one oscillation period; the peak-to-peak excursion over that interval gives the amplitude.  The first
+// (partial) cycle is discarded, as it includes the approach to the setpoint.
+//
+void RelayAutotuner::cycleComplete(const double now, const double measurement) noexcept
+{
+    if(lastFallTime_ >= 0.0)
+    {
+        periods_[ncycles_] = now - lastFallTime_;
+        amplitudes_[ncycles_] = (cycleMax_ - cycleMin_) / 2.0;
+
+        logDebug("Autotune: cycle %d: period %.0fs, amplitude %.3fC", ncycles_, periods_[ncycles_],
+                 amplitudes_[ncycles_]);
+
+        if((++ncycles_ >= cyclesRequired_) || (ncycles_ >= MAX_CYCLES))
+        {
+            // Average over the last two cycles, if they agree
+            const double p1 = periods_[ncycles_ - 1], p2 = periods_[ncycles_ - 2],
+                         a = (amplitudes_[ncycles_ - 1] + amplitudes_[ncycles_ - 2]) / 2.0;
+
+            if((a <= 0.0) || (p1 <= 0.0))
+            {
+                logWarning("Autotune: no measurable oscillation; giving up");
+                state_ = AUTOTUNE_FAILED;
+            }
+            else if(std::fabs(p1 - p2) <= (AUTOTUNE_PERIOD_TOLERANCE * std::fmax(p1, p2)))
+            {
+                // Describing-function estimate of the ultimate gain for a relay of amplitude d = 1 with hysteresis
+                const double a_eff = (a > hysteresis_) ? std::sqrt((a * a) - (hysteresis_ * hysteresis_)) : a;
+
+                Tu_ = (p1 + p2) / 2.0;
+                Ku_ = 4.0 / (M_PI * a_eff);
+
+                // Ziegler-Nichols "no overshoot" rule: Kp = 0.2Ku, Ti = Tu/2, Td = Tu/3.  The vessels are slow,
+                // heavily-lagged plants, and overshoot is the main thing we are trying to eliminate.
+                gains_.kp = 0.2 * Ku_;
+                gains_.ki = gains_.kp / (Tu_ / 2.0);
+                gains_.kd = gains_.kp * (Tu_ / 3.0);
+
+                logInfo("Autotune: Ku=%.4f Tu=%.0fs -> Kp=%.4f Ki=%.6f Kd=%.2f", Ku_, Tu_, gains_.kp, gains_.ki,
+                        gains_.kd);
+                state_ = AUTOTUNE_COMPLETE;
+            }
+            else if(ncycles_ >= MAX_CYCLES)
+            {
+                logWarning("Autotune: oscillation did not settle after %d cycles; giving up", ncycles_);
+                state_ = AUTOTUNE_FAILED;
+            }
+        }
+    }
+
+    lastFallTime_ = now;
+    cycleMax_ = cycleMin_ = measurement;
+}
@@ -0,0 +1,205 @@
+/*
+    powerscheduler.cc: brewhouse-wide scheduler for effector switch-on requests.  Keeps the total power drawn by all
+    active effectors within a configured budget, and staggers switch-ons.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/powerscheduler.h"
+#include "include/framework/log.h"
+#include "include/util/sys.h"
+#include "include/util/validator.h"
+#include <algorithm>
+
+using std::vector;
+namespace Validator = Util::Validator;
+
+
+static const double
+    DEFAULT_BUDGET_W            = 0.0,      // Default power budget, in watts; 0 = unlimited
+    DEFAULT_STAGGER_MS          = 1000.0,   // Default minimum interval between effector switch-ons
+    DEFAULT_AGING_PER_S         = 0.01,     // Default rate at which waiting requests gain priority, per second
+    DEFAULT_STARVATION_S        = 600.0;    // Default wait after which a request blocks lower-priority backfill
+
+
+// ctor - trivial initialisation of members
+//
+PowerScheduler::PowerScheduler() noexcept
+    : budget_(DEFAULT_BUDGET_W),
+      load_(0.0),
+      stagger_(DEFAULT_STAGGER_MS / 1000.0),
+      aging_(DEFAULT_AGING_PER_S),
+      starvation_(DEFAULT_STARVATION_S),
+      lastSwitchOn_(-1.0)
+{
+}
+
+
+// init() - read scheduler parameters from <config>.
+//
+void PowerScheduler::init(Config& config) noexcept
+{
+    budget_ = config.get("power.budget_w", DEFAULT_BUDGET_W, Validator::ge0);
+    stagger_ = config.get("power.stagger_ms", DEFAULT_STAGGER_MS, Validator::ge0) / 1000.0;
+    aging_ = config.get("power.aging_per_s", DEFAULT_AGING_PER_S, Validator::ge0);
+    starvation_ = config.get("power.starvation_s", DEFAULT_STARVATION_S, Validator::gt0);
+
+    if(budget_ > 0.0)
+        logInfo("Power scheduler: budget %.1fW, switch-ons staggered by %.0fms", budget_, stagger_ * 1000.0);
+    else
+        logInfo("Power scheduler: no budget; switch-ons staggered by %.0fms", stagger_ * 1000.0);
+}
+
+
+// request() - register (or refresh) a request to switch on <effector>, on behalf of session <sessionId>, with the
+// specified <priority>.  The effector is not switched on here: that happens in schedule(), if and when the request is
+// granted.  Requests persist until release() is called.  A request for an effector which draws more power than the
+// whole budget can never be granted; it is registered, so that the session reports that it is waiting, but it does not
+// hold up other requests.
+//
+void PowerScheduler::request(DefaultEffector& effector, const int sessionId, const double priority) noexcept
+{
+    auto it = find(effector);
+    if(it != requests_.end())
+    {
+        it->priority = priority;
+        return;
+    }
+
+    Request_t r;
+
+    r.effector = &effector;
+    r.sessionId = sessionId;
+    r.priority = priority;
+    r.requested = Util::Sys::monotonicTime();
+    r.granted = effector.state();       // An effector already on (e.g. after a handoff) already holds its power
+
+    if(!r.granted && exceedsBudget(effector))
+        logWarning("Power scheduler: session %d requested %.1fW, which exceeds the power budget (%.1fW); the request "
+                   "cannot be granted", sessionId, effector.powerConsumption(), budget_);
+
+    requests_.push_back(r);
+}
+
+
+// release() - switch off <effector> immediately, and withdraw any request for it.  Switch-offs are never deferred.
+//
+bool PowerScheduler::release(DefaultEffector& effector, Error * const err) noexcept
+{
+    auto it = find(effector);
+    if(it != requests_.end())
+    {
+        if(it->granted)
+            load_ -= effector.powerConsumption();
+
+        requests_.erase(it);
+    }
+
+    return effector.state() ? effector.activate(false, err) : true;
+}
+
+
+// schedule() - called once per control-loop tick, after every session has registered its demand.  Grants at most one
+// pending request per stagger interval, in order of effective priority (the session-supplied priority plus a term
+// which grows with time spent waiting, so that no request waits forever).  A request is granted only if the
+// effector's power consumption fits within the remaining budget.  Lower-priority requests may "backfill" unused budget
+// ahead of a larger request which does not fit, unless that request has been waiting for longer than the starvation
+// limit; a request which could never fit, even with every other effector off, does not block backfill.  If an effector
+// fails to switch on, the next request is considered instead.  Running effectors are never pre-empted: their sessions
+// switch them off as control requires.
+//
+void PowerScheduler::schedule() noexcept
+{
+    const double now = Util::Sys::monotonicTime();
+
+    // Recompute the load from the granted requests, dropping grants whose effector has been switched off elsewhere
+    load_ = 0.0;
+    for(auto& r : requests_)
+    {
+        if(r.granted && !r.effector->state())
+        {
+            r.granted = false;
+            r.requested = now;
+        }
+
+        if(r.granted)
+            load_ += r.effector->powerConsumption();
+    }
+
+    if((lastSwitchOn_ >= 0.0) && ((now - lastSwitchOn_) < stagger_))
+        return;
+
+    // Find pending requests, in descending order of effective priority
+    vector<Request_t *> pending;
+    for(auto& r : requests_)
+        if(!r.granted)
+            pending.push_back(&r);
+
+    if(pending.empty())
+        return;
+
+    std::sort(pending.begin(), pending.end(), [this, now](const Request_t *a, const Request_t *b)
+    {
+        return (a->priority + (aging_ * (now - a->requested))) > (b->priority + (aging_ * (now - b->requested)));
+    });
+
+    for(auto r : pending)
+    {
+        const double power = r->effector->powerConsumption();
+
+        if((budget_ <= 0.0) || ((load_ + power) <= budget_))
+        {
+            Error err;
+            if(!r->effector->activate(true, &err))
+            {
+                logWarning("Power scheduler: failed to switch on effector for session %d: %s", r->sessionId,
+                           err.message().c_str());
+                continue;
+            }
+
+            logDebug("Power scheduler: granted %.1fW to session %d after %.1fs (load %.1f/%.1fW)", power,
+                     r->sessionId, now - r->requested, load_ + power, budget_);
+            r->granted = true;
+            load_ += power;
+            lastSwitchOn_ = now;
+
+            return;
+        }
+
+        if(((now - r->requested) >= starvation_) && !exceedsBudget(*r->effector))
+            return;         // Don't let anything else overtake a starving request
+    }
+}
+
+
+// isWaiting() - return true if a request for <effector> is pending, i.e. has not yet been granted.
+//
+bool PowerScheduler::isWaiting(const DefaultEffector& effector) const noexcept
+{
+    auto it = find(effector);
+    return (it != requests_.end()) && !it->granted;
+}
+
+
+// exceedsBudget() - return true if <effector> draws more power than the entire budget, so can never be switched on.
+//
+bool PowerScheduler::exceedsBudget(const DefaultEffector& effector) const noexcept
+{
+    return (budget_ > 0.0) && (effector.powerConsumption() > budget_);
+}
+
+
+vector<PowerScheduler::Request_t>::iterator PowerScheduler::find(const DefaultEffector& effector) noexcept
+{
+    return std::find_if(requests_.begin(), requests_.end(),
+                        [&effector](const Request_t& r) { return r.effector == &effector; });
+}
+
+
+vector<PowerScheduler::Request_t>::const_iterator PowerScheduler::find(const DefaultEffector& effector) const noexcept
+{
+    return std::find_if(requests_.begin(), requests_.end(),
+                        [&effector](const Request_t& r) { return r.effector == &effector; });
+}
@@ -11,8 +11,10 @@
 #include "include/framework/registry.h"
 #include "include/peripherals/effector.h"
 #include "include/peripherals/tempsensor.h"
+#include "include/util/sys.h"
 #include "include/util/validator.h"
 #include <boost/algorithm/string.hpp>
+#include <cmath>
 #include <cstdlib>      // NULL
 #include <ctime>        // ::time()
 
@@ -27,6 +29,26 @@ static const double
 static const time_t
     DEFAULT_EFF_UPDATE_INTERVAL_S   = 1;    // Default interval between effector updates, in seconds
 
+static const double
+    DEFAULT_PID_KP                  = 0.5,      // Default PID gains, used until the vessel has been autotuned
+    DEFAULT_PID_KI                  = 0.0002,
+    DEFAULT_PID_KD                  = 0.0,
+    DEFAULT_PWM_WINDOW_S            = 300.0,    // Default length of the time-proportioning window, in seconds
+    DEFAULT_PWM_MIN_ON_S            = 20.0,     // Default minimum effector on/off time within a window, in seconds
+    DEFAULT_AUTOTUNE_HYSTERESIS     = 0.2,      // Default autotune relay hysteresis, in deg C
+    DEFAULT_AUTOTUNE_MAX_S          = 86400.0,  // Default maximum duration of an autotune experiment, in seconds
+    DEFAULT_MODEL_FORGETTING        = 0.999,    // Default RLS forgetting factor for the thermal model
+    DEFAULT_MODEL_SAMPLE_INTERVAL_S = 60.0,     // Default interval between thermal-model updates, in seconds
+    DEFAULT_MODEL_HORIZON_S         = 300.0,    // Default look-ahead for predictive switching, in seconds
+    PRIORITY_WEIGHT_FERMENT         = 3.0,      // Power-scheduler priority weights, by session type
+    PRIORITY_WEIGHT_CONDITION       = 2.0,
+    PRIORITY_WEIGHT_OTHER           = 1.0,
+    HEAT_COOL_THRESHOLD             = 0.02,     // Min |PID output| regarded as heating/cooling, for display purposes
+    FAST_THRESHOLD                  = 0.99;     // Min |PID output| regarded as fast heating/cooling, for display
+
+static const int
+    DEFAULT_AUTOTUNE_CYCLES         = 4;        // Default number of oscillations observed by the autotuner
+
 
 Session::Session(const session_id_t id, Error * const err) noexcept
     : id_(id),
@@ -42,14 +64,29 @@ Session::Session(const session_id_t id, Error * const err) noexcept
       effectorCooler_(Effector::getSessionCooler(id, err)),
       tempControlState_(HOLD),
       type_(NONE),
-      complete_(false)
+      complete_(false),
+      targetOverridden_(false),
+      holdStart_(0),
+      controlMode_(CONTROL_BANGBANG),
+      pidInterval_(0.0),
+      lastPidUpdate_(-1.0),
+      pwmWindow_(DEFAULT_PWM_WINDOW_S),
+      pwmMinOn_(DEFAULT_PWM_MIN_ON_S),
+      windowStart_(-1.0),
+      windowDuty_(0.0),
+      controlOutput_(0.0),
+      modelHorizon_(DEFAULT_MODEL_HORIZON_S)
 {
     if(err->code())
         return;         // Stop if initialisation of any member variable failed
 
-    // As a precaution, deactivate effectors
-    effectorHeater_->activate(false);
-    effectorCooler_->activate(false);
+    // As a precaution, deactivate effectors - unless taking over from a previous instance of the application, in which
+    // case they are left as they are until the session's control state has been restored.
+    if(Registry::instance().handoff() == nullptr)
+    {
+        effectorHeater_->activate(false);
+        effectorCooler_->activate(false);
+    }
 
     // Read basic session information
     auto& cfg = Registry::instance().config();
@@ -58,7 +95,9 @@ Session::Session(const session_id_t id, Error * const err) noexcept
 
     // FIXME: if a value is set for date_finish, and that value is <=CURRENT_TIMESTAMP, log a message and set
     // complete_ = true.
-    if(!db.prepare("SELECT gyle_id, profile_id, CAST((JULIANDAY(date_start) - 2440587.5) * 86400.0 AS INT) AS start_ts "
+    if(!db.prepare("SELECT gyle_id, profile_id, "
+                   "CAST((JULIANDAY(date_start) - 2440587.5) * 86400.0 AS INT) AS start_ts, "
+                   "CAST((JULIANDAY(date_hold) - 2440587.5) * 86400.0 AS INT) AS hold_ts, target_override "
                    "FROM session "
                    "WHERE id=:id", session, err) ||
        !session.bind(":id", id_, err))
@@ -76,6 +115,16 @@ Session::Session(const session_id_t id, Error * const err) noexcept
     profile_ = session["profile_id"].get<int>();
     start_ts_ = session["start_ts"].get<int>();
 
+    // Restore any hold or target override applied before a restart
+    if(!session["hold_ts"].isNull())
+        holdStart_ = session["hold_ts"].get<int>();
+
+    if(!session["target_override"].isNull())
+    {
+        targetOverride_ = Temperature(session["target_override"].get<double>(), TEMP_UNIT_CELSIUS);
+        targetOverridden_ = true;
+    }
+
     SQLiteStmt gyle;
     if(!db.prepare("SELECT name FROM gyle WHERE id=:gyle_id", gyle, err) ||
        !gyle.bind(":gyle_id", gyle_id_, err))
@@ -166,14 +215,35 @@ Session::Session(const session_id_t id, Error * const err) noexcept
     deadZone_ = cfg.get("session.dead_zone", DEFAULT_TEMP_DEADZONE, Validator::gt0);
     effectorUpdateInterval_ = cfg.get("session.effector_update_interval_s", DEFAULT_EFF_UPDATE_INTERVAL_S,
                                         Validator::gt0);
+
+    // Set up closed-loop control
+    controlMode_ = iequals(cfg.get<string>("session.control_mode", "pid"), "bangbang") ? CONTROL_BANGBANG : CONTROL_PID;
+    pidInterval_ = effectorUpdateInterval_;
+    pwmWindow_ = cfg.get("session.pwm_window_s", DEFAULT_PWM_WINDOW_S, Validator::gt0);
+    pwmMinOn_ = cfg.get("session.pwm_min_on_s", DEFAULT_PWM_MIN_ON_S, Validator::ge0);
+
+    if(pwmMinOn_ > (pwmWindow_ / 2.0))
+        pwmMinOn_ = pwmWindow_ / 2.0;
+
+    model_ = ThermalModel(cfg.get("model.forgetting", DEFAULT_MODEL_FORGETTING, Validator::gt0),
+                          cfg.get("model.sample_interval_s", DEFAULT_MODEL_SAMPLE_INTERVAL_S, Validator::gt0));
+    modelHorizon_ = cfg.get("model.horizon_s", DEFAULT_MODEL_HORIZON_S, Validator::gt0);
+
+    Error gainsErr;
+    if(!loadGains(&gainsErr))
+        logWarning("Session %d: failed to load PID gains (%s); using defaults", id_, gainsErr.message().c_str());
 }
 
 
-// targetTemp() - return the current target temperature for this session.
+// targetTemp() - return the current target temperature for this session: the override temperature, if one has been
+// set; otherwise the temperature specified by the current stage of the session's profile.
 //
-Temperature Session::targetTemp() noexcept
+Temperature Session::targetTemp() const noexcept
 {
-    const time_t now = ::time(NULL);
+    if(targetOverridden_)
+        return targetOverride_;
+
+    const time_t now = profileTime();
 
     if(now >= start_ts_)
     {
@@ -217,8 +287,8 @@ bool Session::updateEffectors(Error * const err) noexcept
     if(!isActive())
     {
         // Session is inactive; ensure that its effectors are deactivated.
-        effectorHeater_->activate(false);
-        effectorCooler_->activate(false);
+        switchOff(*effectorHeater_);
+        switchOff(*effectorCooler_);
         tempControlState_ = HOLD;
 
         return true;
@@ -230,8 +300,8 @@ bool Session::updateEffectors(Error * const err) noexcept
     {
         // Failed to sense temperature, or no sensor attached, or sensed temperature is out of the probe's range.
         // Deactivate effectors and return failure.
-        effectorHeater_->activate(false);
-        effectorCooler_->activate(false);
+        switchOff(*effectorHeater_);
+        switchOff(*effectorCooler_);
         tempControlState_ = UNKNOWN;
 
         return false;
@@ -248,8 +318,8 @@ bool Session::updateEffectors(Error * const err) noexcept
                  id_, gyle_id_, t.C(), upperLimit.C());
         tempControlState_ = COOL;
 
-        effectorHeater_->activate(false);   // Not ideal: error code not captured
-        return effectorCooler_->activate(true);
+        switchOff(*effectorHeater_);        // Not ideal: error code not captured
+        return switchOn(*effectorCooler_);
     }
     else if(t < lowerLimit)
     {
@@ -258,8 +328,22 @@ bool Session::updateEffectors(Error * const err) noexcept
                  id_, gyle_id_, t.C(), lowerLimit.C());
         tempControlState_ = HEAT;
 
-        effectorCooler_->activate(false);   // Not ideal: error code not captured
-        return effectorHeater_->activate(true);
+        switchOff(*effectorCooler_);        // Not ideal: error code not captured
+        return switchOn(*effectorHeater_);
+    }
+    else if(((t > target) && effectorCooler_->state() && coastsToTarget(t, target, false))
+            || ((t < target) && effectorHeater_->state() && coastsToTarget(t, target, true)))
+    {
+        // Within the dead zone, the thermal model predicts that the vessel will reach the target temperature with the
+        // active effector switched off (e.g. because the ambient temperature is on the far side of the target); switch
+        // it off early.  This is only done within the dead zone, so the effector is not switched straight back on at
+        // the next update.
+        logDebug("Session %d (G%d): temp %.2fC predicted to coast to target (%.2fC); switching off early",
+                 id_, gyle_id_, t.C(), target.C());
+        tempControlState_ = HOLD;
+
+        switchOff(*effectorCooler_);        // Not ideal: error code not captured
+        return switchOff(*effectorHeater_);
     }
     else if((t >= target) && effectorCooler_->state())
     {
@@ -283,8 +367,336 @@ bool Session::updateEffectors(Error * const err) noexcept
                  id_, gyle_id_, t.C(), target.C(), deadZone_);
         tempControlState_ = HOLD;
 
-        effectorCooler_->activate(false);   // Not ideal: error code not captured
-        return effectorHeater_->activate(false);
+        switchOff(*effectorCooler_);        // Not ideal: error code not captured
+        return switchOff(*effectorHeater_);
+    }
+
+    return true;
+}
+
+
+// updateEffectorsPID() - closed-loop control of the session temperature.  A PID controller, sampled every
+// <pidInterval_> seconds, computes a signed duty cycle (positive: heat; negative: cool).  The duty cycle is latched at the
+// start of each <pwmWindow_>-second window: the relevant effector is switched on at the start of the window and off
+// once the on-time has elapsed.  Duty cycles shorter than the minimum on-time are dropped, and those within the minimum
+// off-time of 100% are rounded up, so an effector is never switched twice in quick succession.  Timing uses the
+// monotonic clock.  While an autotune experiment is running, the relay autotuner drives the effectors instead.
+//
+bool Session::updateEffectorsPID(Error * const err) noexcept
+{
+    (void) err;         // Suppress arg-not-used warning
+
+    if(!isActive())
+    {
+        autotuner_.abort();
+        pid_.reset();
+        controlOutput_ = windowDuty_ = 0.0;
+        windowStart_ = lastPidUpdate_ = -1.0;
+        tempControlState_ = HOLD;
+
+        return setEffectors(false, false);
+    }
+
+    const Temperature t = lastTemp_;
+
+    if(!((bool) t) || !tempSensorVessel_->inRange())
+    {
+        // Failed to sense temperature, or no sensor attached, or sensed temperature is out of the probe's range.
+        // Deactivate effectors, and start control afresh once the sensor recovers.
+        autotuner_.abort();
+        pid_.reset();
+        controlOutput_ = windowDuty_ = 0.0;
+        windowStart_ = lastPidUpdate_ = -1.0;
+        tempControlState_ = UNKNOWN;
+        setEffectors(false, false);
+
+        return false;
+    }
+
+    const double now = Util::Sys::monotonicTime(),
+                 target = targetTemp().C();
+
+    if(autotuner_.isRunning())
+    {
+        controlOutput_ = autotuner_.update(target, t.C(), now);
+
+        if(autotuner_.state() == AUTOTUNE_COMPLETE)
+        {
+            logInfo("Session %d: autotune complete", id_);
+            pid_.setGains(autotuner_.gains());
+            pid_.reset();
+            saveGains(autotuner_.gains());
+            windowStart_ = lastPidUpdate_ = -1.0;
+        }
+        else if(autotuner_.state() == AUTOTUNE_FAILED)
+        {
+            logWarning("Session %d: autotune failed; keeping existing gains", id_);
+            windowStart_ = lastPidUpdate_ = -1.0;
+        }
+
+        tempControlState_ = (controlOutput_ > 0.0) ? FAST_HEAT : ((controlOutput_ < 0.0) ? FAST_COOL : HOLD);
+        return setEffectors(controlOutput_ > 0.0, controlOutput_ < 0.0);
+    }
+
+    if((lastPidUpdate_ < 0.0) || ((now - lastPidUpdate_) >= pidInterval_))
+    {
+        // Limit the output to the duty cycles which the thermal model predicts will just reach the target over the
+        // look-ahead horizon, so that the controller backs off before, rather than after, an overshoot.  The limits are
+        // passed to the controller, so that its integrator doesn't wind up while the output is held at one of them.
+        double lo = -1.0, hi = 1.0;
+
+        if(model_.isValid() && ambientTemp_)
+        {
+            lo = -model_.dutyFor(t.C(), ambientTemp_.C(), target, modelHorizon_, false);
+            hi = model_.dutyFor(t.C(), ambientTemp_.C(), target, modelHorizon_, true);
+        }
+
+        controlOutput_ = pid_.update(target, t.C(), (lastPidUpdate_ < 0.0) ? 0.0 : now - lastPidUpdate_, lo, hi);
+        lastPidUpdate_ = now;
+    }
+
+    if((windowStart_ < 0.0) || ((now - windowStart_) >= pwmWindow_))
+    {
+        // Start a new window, and latch the duty cycle for its duration
+        const double onTime = ::fabs(controlOutput_) * pwmWindow_;
+
+        windowStart_ = now;
+        if(onTime < pwmMinOn_)
+            windowDuty_ = 0.0;
+        else if((pwmWindow_ - onTime) < pwmMinOn_)
+            windowDuty_ = (controlOutput_ > 0.0) ? 1.0 : -1.0;
+        else
+            windowDuty_ = controlOutput_;
+    }
+
+    const bool on = (now - windowStart_) < (::fabs(windowDuty_) * pwmWindow_);
+
+    if(controlOutput_ >= HEAT_COOL_THRESHOLD)
+        tempControlState_ = (controlOutput_ >= FAST_THRESHOLD) ? FAST_HEAT : HEAT;
+    else if(controlOutput_ <= -HEAT_COOL_THRESHOLD)
+        tempControlState_ = (controlOutput_ <= -FAST_THRESHOLD) ? FAST_COOL : COOL;
+    else
+        tempControlState_ = HOLD;
+
+    return setEffectors(on && (windowDuty_ > 0.0), on && (windowDuty_ < 0.0));
+}
+
+
+// coastsToTarget() - return true if the thermal model is valid, and predicts that the vessel temperature will rise
+// (if <heating>) or fall to <target> within the model look-ahead horizon with both effectors switched off.
+//
+bool Session::coastsToTarget(const Temperature& t, const Temperature& target, const bool heating) const noexcept
+{
+    if(!model_.isValid() || !ambientTemp_)
+        return false;
+
+    const double predicted = model_.predict(t.C(), ambientTemp_.C(), 0.0, 0.0, modelHorizon_);
+
+    return heating ? (predicted >= target.C()) : (predicted <= target.C());
+}
+
+
+// timeToTarget() - return the thermal model's forecast of the time, in seconds, for the vessel to reach its target
+// temperature at full heating/cooling power; or -1 if no forecast can be made.
+//
+double Session::timeToTarget() const noexcept
+{
+    if(!isActive() || !lastTemp_ || !ambientTemp_)
+        return -1.0;
+
+    return model_.timeTo(lastTemp_.C(), ambientTemp_.C(), targetTemp().C());
+}
+
+
+// switchOn() - ask the power scheduler to switch on <effector>.  The request is granted, and the effector switched on,
+// when the brewhouse power budget allows; until then the effector stays off.  Requests are prioritised by the size of
+// the session's temperature error, weighted by the session type (a fermenting batch is more sensitive to temperature
+// excursions than one being conditioned or served).  Returns true; the request itself cannot fail.
+//
+bool Session::switchOn(DefaultEffector& effector) noexcept
+{
+    const double error = (lastTemp_ && isActive()) ? ::fabs(targetTemp().C() - lastTemp_.C()) : 0.0;
+    double weight;
+
+    switch(type_)
+    {
+        case FERMENT:       weight = PRIORITY_WEIGHT_FERMENT;       break;
+        case CONDITION:     weight = PRIORITY_WEIGHT_CONDITION;     break;
+        default:            weight = PRIORITY_WEIGHT_OTHER;         break;
+    }
+
+    Registry::instance().powerScheduler().request(effector, id_, error * weight);
+
+    return true;
+}
+
+
+// isWaitingForPower() - return true if either of the session's effectors is waiting for the power scheduler to grant
+// it power.
+//
+bool Session::isWaitingForPower() const noexcept
+{
+    const auto& scheduler = Registry::instance().powerScheduler();
+
+    return scheduler.isWaiting(*effectorHeater_) || scheduler.isWaiting(*effectorCooler_);
+}
+
+
+// switchOff() - switch off <effector> immediately, withdrawing any pending power request for it.
+//
+bool Session::switchOff(DefaultEffector& effector) noexcept
+{
+    return Registry::instance().powerScheduler().release(effector);
+}
+
+
+// setEffectors() - set the heater and cooler states to <heat> and <cool> respectively.  Switch-ons are subject to the
+// power scheduler; effectors are only touched if their state needs to change, and the heater and cooler are never both
+// on.
+//
+bool Session::setEffectors(const bool heat, const bool cool) noexcept
+{
+    bool ret = true;
+
+    // Switch off before requesting power, so that the heater and cooler never run together
+    if(!heat)
+        ret = switchOff(*effectorHeater_) && ret;
+
+    if(!cool)
+        ret = switchOff(*effectorCooler_) && ret;
+
+    if(heat && !cool)
+        ret = switchOn(*effectorHeater_) && ret;
+
+    if(cool && !heat)
+        ret = switchOn(*effectorCooler_) && ret;
+
+    return ret;
+}
+
+
+// startAutotune() - begin a relay-feedback autotune experiment at the session's current target temperature.  On
+// completion, the learned gains are used immediately and stored against the vessel's temperature sensor.
+//
+bool Session::startAutotune(Error * const err) noexcept
+{
+    if((controlMode_ != CONTROL_PID) || !isActive())
+    {
+        formatError(err, SESSION_NOT_ACTIVE, id_);
+        return false;
+    }
+
+    auto& cfg = Registry::instance().config();
+
+    logInfo("Session %d: starting autotune at %.2fC", id_, targetTemp().C());
+
+    autotuner_.start(cfg.get("session.autotune_hysteresis", DEFAULT_AUTOTUNE_HYSTERESIS, Validator::gt0),
+                     cfg.get("session.autotune_max_s", DEFAULT_AUTOTUNE_MAX_S, Validator::gt0),
+                     cfg.get("session.autotune_cycles", DEFAULT_AUTOTUNE_CYCLES, Validator::gt0));
+    return true;
+}
+
+
+// saveState() - capture the session's control state - vessel sensor filter, PID integrator, PWM window, thermal
+// model and effector states - into <state>, for checkpointing.
+//
+void Session::saveState(SessionState_t& state) noexcept
+{
+    state.id = id_;
+    state.heater = effectorHeater_->state() ? 1 : 0;
+    state.cooler = effectorCooler_->state() ? 1 : 0;
+    state.reserved[0] = state.reserved[1] = 0;
+    state.integrator = pid_.integrator();
+    state.controlOutput = controlOutput_;
+    state.windowDuty = windowDuty_;
+    state.windowElapsed = (windowStart_ < 0.0) ? -1.0 : Util::Sys::monotonicTime() - windowStart_;
+    state.model = model_.state();
+
+    if(!tempSensorVessel_->getState(state.sensor))
+        state.sensor.channel = -1;
+}
+
+
+// restoreState() - restore the session's control state from a checkpoint taken <age> seconds ago.  The sensor filter
+// is restored first; if that fails (e.g. because the vessel's sensor has changed), nothing else is restored, since the
+// controller state would not describe this vessel.  Effectors which were on are requested from the power scheduler
+// again, and the PWM window resumes where it would have been had there been no restart.
+//
+bool Session::restoreState(const SessionState_t& state, const double age) noexcept
+{
+    if((state.id != id_) || !tempSensorVessel_->setState(state.sensor))
+        return false;
+
+    pid_.setIntegrator(state.integrator);
+    model_.setState(state.model);
+
+    if(isActive())
+    {
+        controlOutput_ = state.controlOutput;
+
+        if((controlMode_ == CONTROL_PID) && (state.windowElapsed >= 0.0) && ((state.windowElapsed + age) < pwmWindow_))
+        {
+            windowStart_ = Util::Sys::monotonicTime() - (state.windowElapsed + age);
+            windowDuty_ = state.windowDuty;
+        }
+
+        setEffectors(state.heater, state.cooler);
+    }
+
+    logInfo("Session %d: restored control state from checkpoint (age %.0fs)", id_, age);
+
+    return true;
+}
+
+
+// loadGains() - load the PID gains learned for this session's vessel, identified by the channel of its temperature
+// sensor.  If the vessel has not been autotuned, use the gains specified in config.
+//
+bool Session::loadGains(Error * const err) noexcept
+{
+    auto& cfg = Registry::instance().config();
+    PIDGains_t gains = {cfg.get("session.pid_kp", DEFAULT_PID_KP, Validator::ge0),
+                        cfg.get("session.pid_ki", DEFAULT_PID_KI, Validator::ge0),
+                        cfg.get("session.pid_kd", DEFAULT_PID_KD, Validator::ge0)};
+    SQLiteStmt stmt;
+
+    if(!Registry::instance().db().prepare("SELECT kp, ki, kd FROM pidgains WHERE sensor_channel=:channel", stmt, err)
+       || !stmt.bind(":channel", tempSensorVessel_->channel(), err))
+        return false;
+
+    if(stmt.step(err))
+    {
+        gains.kp = stmt["kp"].get<double>();
+        gains.ki = stmt["ki"].get<double>();
+        gains.kd = stmt["kd"].get<double>();
+
+        logInfo("Session %d: using learned PID gains Kp=%.4f Ki=%.6f Kd=%.2f", id_, gains.kp, gains.ki, gains.kd);
+    }
+    else if(err->code())
+        return false;
+
+    pid_.setGains(gains);
+
+    return true;
+}
+
+
+// saveGains() - store <gains> as the learned PID gains for this session's vessel.
+//
+bool Session::saveGains(const PIDGains_t& gains, Error * const err) noexcept
+{
+    SQLiteStmt stmt;
+
+    if(!Registry::instance().db().prepare("INSERT OR REPLACE INTO pidgains(sensor_channel, kp, ki, kd, date_tuned) "
+                                          "VALUES(:channel, :kp, :ki, :kd, CURRENT_TIMESTAMP)", stmt, err)
+       || !stmt.bind(":channel", tempSensorVessel_->channel(), err)
+       || !stmt.bind(":kp", gains.kp, err)
+       || !stmt.bind(":ki", gains.ki, err)
+       || !stmt.bind(":kd", gains.kd, err)
+       || !stmt.execute(err))
+    {
+        logWarning("Session %d: failed to store PID gains", id_);
+        return false;
     }
 
     return true;
@@ -313,7 +725,7 @@ bool Session::isActive() const noexcept
 //
 time_t Session::remainingTime() const noexcept
 {
-    const time_t now = ::time(NULL);
+    const time_t now = profileTime();
 
     if((now >= start_ts_) && (now < end_ts_))
         return end_ts_ - now;
@@ -330,9 +742,28 @@ bool Session::iterate(Error * const err) noexcept
 
     const time_t now = ::time(NULL);
 
-    currentTemp();      // Always sense the current temperature: oversampling maintains the moving average
+    // Always sense the current temperature: oversampling maintains the moving average.  The sensor decides for itself
+    // whether to read the ADC, based on the signal dynamics and the distance to the target temperature.
+    tempSensorVessel_->setSetpoint(isActive() ? targetTemp() : Temperature());
+    lastTemp_ = currentTemp();
+
+    // Feed the thermal model, if all the data it needs is available
+    if(lastTemp_ && ambientTemp_ && tempSensorVessel_->inRange())
+        model_.observe(Util::Sys::monotonicTime(), lastTemp_.C(), ambientTemp_.C(), effectorHeater_->state(),
+                       effectorCooler_->state());
+
+    const SessionTempControlState_t prevState = tempControlState_;
 
-    if((now - lastEffectorUpdate_) >= effectorUpdateInterval_)
+    if(controlMode_ == CONTROL_PID)
+    {
+        // Time-proportioned output is switched on every iteration, so that effector transitions happen precisely
+        // when the window requires them; the controller itself runs at the effector-update interval.
+        if(now >= start_ts_)
+            updateEffectorsPID();
+        else
+            deactivateEffectors();
+    }
+    else if((now - lastEffectorUpdate_) >= effectorUpdateInterval_)
     {
         if(now >= start_ts_)
         {
@@ -343,6 +774,10 @@ bool Session::iterate(Error * const err) noexcept
             deactivateEffectors();
     }
 
+    if(tempControlState_ != prevState)
+        Registry::instance().telemetry().publishControlState(id_, tempControlState_, targetTemp().C(),
+                                                             lastTemp_.C());
+
     return true;
 }
 
@@ -359,9 +794,9 @@ bool Session::markComplete(Error * const err) noexcept
         logWarning("Session %d: markComplete(): failed to deactivate effectors; marking session complete anyway.", id_);
 
     // Mark session as complete in database
-    if(!db.prepare("UPDATE session SET date_finish=NOW() WHERE id=:id", session, err) ||
+    if(!db.prepare("UPDATE session SET date_finish=CURRENT_TIMESTAMP WHERE id=:id", session, err) ||
        !session.bind(":id", id_, err) ||
-       !session.step(err))
+       !session.execute(err))
         return false;
 
     complete_ = true;
@@ -370,12 +805,176 @@ bool Session::markComplete(Error * const err) noexcept
 }
 
 
+// setTargetOverride() - override the profile: hold the session at <target> until the override is cleared.  The
+// override is recorded in the database, so that it survives a restart.
+//
+bool Session::setTargetOverride(const Temperature& target, Error * const err) noexcept
+{
+    if(!saveProgress(start_ts_, holdStart_, &target, err))
+        return false;
+
+    logInfo("Session %d: target temperature overridden: %.2fC", id_, target.C());
+
+    targetOverride_ = target;
+    targetOverridden_ = true;
+
+    return true;
+}
+
+
+// clearTargetOverride() - remove any target-temperature override; return to following the session's profile.
+//
+bool Session::clearTargetOverride(Error * const err) noexcept
+{
+    if(!targetOverridden_)
+        return true;
+
+    if(!saveProgress(start_ts_, holdStart_, nullptr, err))
+        return false;
+
+    logInfo("Session %d: target temperature override cleared", id_);
+    targetOverridden_ = false;
+
+    return true;
+}
+
+
+// hold() - freeze the session's progress through its profile.  While the session is held, the current stage does not
+// advance and the remaining time does not decrease.  Returns true on success (including if the session is already
+// held); false if the session is not active, or if the hold could not be recorded in the database.
+//
+bool Session::hold(Error * const err) noexcept
+{
+    if(!isActive())
+    {
+        formatError(err, SESSION_NOT_ACTIVE, id_);
+        return false;
+    }
+
+    if(!holdStart_)
+    {
+        const time_t now = ::time(NULL);
+
+        if(!saveProgress(start_ts_, now, targetOverridden_ ? &targetOverride_ : nullptr, err))
+            return false;
+
+        logInfo("Session %d: held", id_);
+        holdStart_ = now;
+    }
+
+    return true;
+}
+
+
+// release() - resume progress through the session's profile after a hold().  The profile is shifted forward in time by
+// the length of the hold.  Releasing a session which is not held is not an error.
+//
+bool Session::release(Error * const err) noexcept
+{
+    if(holdStart_)
+    {
+        const time_t heldFor = ::time(NULL) - holdStart_;
+
+        if(!saveProgress(start_ts_ + heldFor, 0, targetOverridden_ ? &targetOverride_ : nullptr, err))
+            return false;
+
+        logInfo("Session %d: released after %ld seconds", id_, (long) heldFor);
+
+        start_ts_ += heldFor;
+        end_ts_ += heldFor;
+        holdStart_ = 0;
+    }
+
+    return true;
+}
+
+
+// skipStage() - end the current profile stage immediately, by shifting the profile back in time so that the current
+// stage ends now.  Returns false if the session is not active, if the current stage is the last one, or if the new
+// start time could not be recorded in the database.
+//
+bool Session::skipStage(Error * const err) noexcept
+{
+    if(!isActive())
+    {
+        formatError(err, SESSION_NOT_ACTIVE, id_);
+        return false;
+    }
+
+    const time_t now = profileTime();
+    time_t offset = start_ts_;
+
+    for(size_t i = 0; i < stages_.size(); ++i)
+    {
+        const SessionStage_t& stage = stages_[i];
+
+        if(stage.forever || ((offset + stage.duration) > now))
+        {
+            if(stage.forever || ((i + 1) == stages_.size()))
+                break;
+
+            const time_t shift = (offset + stage.duration) - now;
+
+            if(!saveProgress(start_ts_ - shift, holdStart_, targetOverridden_ ? &targetOverride_ : nullptr, err))
+                return false;
+
+            logInfo("Session %d: skipping stage %d", id_, (int) i);
+
+            start_ts_ -= shift;
+            end_ts_ -= shift;
+            return true;
+        }
+
+        offset += stage.duration;
+    }
+
+    formatError(err, SESSION_FINAL_STAGE, id_);
+    return false;
+}
+
+
+// saveProgress() - record the session's position in its profile - its start time <startTs>, as shifted by holds and
+// skipped stages, and the time <holdStart> at which the current hold began (0 if not held) - and its target override
+// <targetOverride> (nullptr if none) in the session's database row, so that a restart or an upgrade resumes the
+// session where it left off.
+//
+bool Session::saveProgress(const time_t startTs, const time_t holdStart, const Temperature * const targetOverride,
+                           Error * const err) noexcept
+{
+    SQLiteStmt stmt;
+
+    if(!Registry::instance().db().prepare("UPDATE session SET date_start=DATETIME(:start_ts, 'unixepoch'), "
+                                          "date_hold=DATETIME(:hold_ts, 'unixepoch'), target_override=:target "
+                                          "WHERE id=:id", stmt, err)
+       || !stmt.bind(":start_ts", (long long) startTs, err)
+       || !(holdStart ? stmt.bind(":hold_ts", (long long) holdStart, err) : stmt.bindNull(":hold_ts", err))
+       || !(targetOverride ? stmt.bind(":target", targetOverride->C(), err) : stmt.bindNull(":target", err))
+       || !stmt.bind(":id", id_, err)
+       || !stmt.execute(err))
+    {
+        logWarning("Session %d: failed to record session progress", id_);
+        return false;
+    }
+
+    return true;
+}
+
+
+// profileTime() - return the point in time at which the session's profile should be evaluated: the current time or, if
+// the session is held, the time at which the hold started.
+//
+time_t Session::profileTime() const noexcept
+{
+    return holdStart_ ? holdStart_ : ::time(NULL);
+}
+
+
 // deactivateEffectors() - switch off heating/cooling effectors.  Returns true if both operations were successful;
 // false otherwise.
 //
 bool Session::deactivateEffectors() noexcept
 {
-    return effectorHeater_->activate(false) && effectorCooler_->activate(false);
+    return switchOff(*effectorHeater_) && switchOff(*effectorCooler_);
 }
 
 
@@ -0,0 +1,83 @@
+/*
+    sessioncommand.cc: commands sent to the session manager from other threads (e.g. the web service, the button
+    manager).  Commands are queued, lock-free, and executed by the session manager at the start of its next tick; each
+    caller receives a future which becomes ready once its command has been executed.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/sessioncommand.h"
+#include <boost/algorithm/string.hpp>
+#include <utility>
+
+using boost::iequals;
+using std::future;
+using std::string;
+
+
+// Command names, as used by the web service
+static const struct
+{
+    SessionCommandType_t    type;
+    const char *            name;
+} commandNames[] =
+{
+    {SESSION_CMD_SET_TARGET,        "settarget"},
+    {SESSION_CMD_CLEAR_TARGET,      "cleartarget"},
+    {SESSION_CMD_HOLD,              "hold"},
+    {SESSION_CMD_RELEASE,           "release"},
+    {SESSION_CMD_SKIP_STAGE,        "skipstage"},
+    {SESSION_CMD_MARK_COMPLETE,     "complete"},
+    {SESSION_CMD_AUTOTUNE,          "autotune"}
+};
+
+
+SessionCommandQueue::SessionCommandQueue() noexcept
+{
+}
+
+
+// submit() - enqueue a command for execution by the session manager.  May be called from any thread; never blocks.
+// Returns a future through which the outcome of the command (an Error object whose code() is zero on success) is
+// delivered.
+//
+future<Error> SessionCommandQueue::submit(const SessionCommandType_t type, const session_id_t sessionId,
+                                          const double value) noexcept
+{
+    SessionCommand_t cmd;
+
+    cmd.type = type;
+    cmd.sessionId = sessionId;
+    cmd.value = value;
+
+    future<Error> ret = cmd.result.get_future();
+    queue_.push(std::move(cmd));
+
+    return ret;
+}
+
+
+// name() - return the name of the command <type>, or "unknown".
+//
+const char *SessionCommandQueue::name(const SessionCommandType_t type) noexcept
+{
+    for(auto& c : commandNames)
+        if(c.type == type)
+            return c.name;
+
+    return "unknown";
+}
+
+
+// fromName() - return the command type corresponding to <name>, or SESSION_CMD_NONE if no command matches.
+//
+SessionCommandType_t SessionCommandQueue::fromName(const std::string_view name) noexcept
+{
+    for(auto& c : commandNames)
+        if(iequals(name, c.name))
+            return c.type;
+
+    return SESSION_CMD_NONE;
+}
@@ -11,7 +11,11 @@
 #include "include/application/sessionmanager.h"
 #include "include/application/temperature.h"
 #include "include/framework/log.h"
+#include "include/framework/registry.h"
 #include "include/peripherals/tempsensor.h"
+#include "include/util/validator.h"
+#include <cstring>
+#include <ctime>
 #include <thread>
 
 extern "C"
@@ -19,15 +23,34 @@ extern "C"
 #include <unistd.h>         // ::usleep()
 }
 
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+using std::chrono::steady_clock;
+using std::string;
 using std::thread;
+namespace Validator = Util::Validator;
+
+
+static const int
+    DEFAULT_SNAPSHOT_INTERVAL_MS    = 500,  // Default interval between publications of session-state snapshots
+    DEFAULT_CHECKPOINT_INTERVAL_S   = 10,   // Default interval between checkpoints of the control state
+    DEFAULT_CHECKPOINT_MAX_AGE_S    = 300;  // Default max age of a checkpoint from which state will be restored
+
+static const char * const
+    DEFAULT_STATE_FILE              = "/home/swallace/cjbc/brewctl/brewctl.state";
 
 
 // ctor - trivial initialisation of members
 //
 SessionManager::SessionManager() noexcept
     : Thread(),
-      display_(nullptr)
+      display_(nullptr),
+      snapshotInterval_(DEFAULT_SNAPSHOT_INTERVAL_MS),
+      checkpointInterval_(DEFAULT_CHECKPOINT_INTERVAL_S),
+      maxCheckpointAge_(DEFAULT_CHECKPOINT_MAX_AGE_S),
+      handoff_(false)
 {
+    ::memset(&handoffState_, 0, sizeof(handoffState_));
 }
 
 
@@ -43,17 +66,109 @@ SessionManager::~SessionManager() noexcept
 }
 
 
-// init() - read active sessions from the database and build a vector of them in <sessions_>.
+// init() - read active sessions from the database and build a vector of them in <sessions_>; then restore their
+// control state from the state handed off by a previous instance of the application, if any, or otherwise from the
+// state file, if it holds a recent checkpoint.  Failure to open the state file is not fatal.
 //
 bool SessionManager::init(Error * const err) noexcept
 {
+    auto& config = Registry::instance().config();
+
     display_ = new Display(*this);
 
+    Registry::instance().powerScheduler().init(Registry::instance().config());
+
+    snapshotInterval_ = milliseconds(Registry::instance().config()
+                                        .get("session.snapshot_interval_ms", DEFAULT_SNAPSHOT_INTERVAL_MS,
+                                             Validator::gt0));
+
+    checkpointInterval_ = seconds(config.get("state.checkpoint_interval_s", DEFAULT_CHECKPOINT_INTERVAL_S,
+                                             Validator::gt0));
+    maxCheckpointAge_ = config.get("state.max_age_s", DEFAULT_CHECKPOINT_MAX_AGE_S, Validator::ge0);
+
     tempSensorAmbient_ = TempSensor::getAmbientTempSensor(err);
     if(err->code())
         return false;
 
-    return updateSessionList(err);
+    if(!updateSessionList(err))
+        return false;
+
+    Error stateErr;
+    const string stateFile = config.get<string>("state.file", DEFAULT_STATE_FILE, Validator::notEmpty);
+    const HandoffData_t * const handoff = Registry::instance().handoff();
+    StateData_t data;
+
+    if(stateFile_.open(stateFile, &stateErr))
+    {
+        if((handoff == nullptr) && stateFile_.load(data))
+            restore(data);
+    }
+    else
+        logWarning("Failed to open state file %s (%s); state will not be checkpointed", stateFile.c_str(),
+                   stateErr.message().c_str());
+
+    if(handoff != nullptr)
+        restore(handoff->state);
+
+    return true;
+}
+
+
+// captureState() - capture the control state of the ambient sensor and of each session into <data>.
+//
+void SessionManager::captureState(StateData_t& data) noexcept
+{
+    ::memset(&data, 0, sizeof(data));
+
+    data.timestamp = ::time(NULL);
+    if(!tempSensorAmbient_->getState(data.ambient))
+        data.ambient.channel = -1;
+
+    for(auto it : sessions_)
+    {
+        if(data.nsessions == STATE_MAX_SESSIONS)
+            break;
+
+        it.second->saveState(data.sessions[data.nsessions++]);
+    }
+}
+
+
+// checkpoint() - write the control state of the ambient sensor and of each session to the state file.
+//
+void SessionManager::checkpoint() noexcept
+{
+    if(!stateFile_.isOpen())
+        return;
+
+    StateData_t data;
+
+    captureState(data);
+    stateFile_.save(data);
+}
+
+
+// restore() - restore the control state of the ambient sensor and of each session from <data>, provided that it is no
+// more than <maxCheckpointAge_> seconds old.  Older state no longer describes the vessels.
+//
+void SessionManager::restore(const StateData_t& data) noexcept
+{
+    const double age = ::difftime(::time(NULL), (time_t) data.timestamp);
+
+    if((age < 0.0) || (age > maxCheckpointAge_))
+    {
+        logInfo("Ignoring state checkpoint: age %.0fs exceeds limit of %ds", age, maxCheckpointAge_);
+        return;
+    }
+
+    tempSensorAmbient_->setState(data.ambient);
+
+    for(uint32_t i = 0; i < data.nsessions; ++i)
+    {
+        auto it = sessions_.find(data.sessions[i].id);
+        if(it != sessions_.end())
+            it->second->restoreState(data.sessions[i], age);
+    }
 }
 
 
@@ -108,6 +223,150 @@ const SessionMap_t& SessionManager::sessions() noexcept
 }
 
 
+// snapshot() - return the most recently published snapshot of session state.  Safe to call from any thread; never
+// touches the hardware.
+//
+SessionSnapshotSet_sptr_t SessionManager::snapshot() const noexcept
+{
+    return Registry::instance().snapshots().current();
+}
+
+
+// publishSnapshot() - capture the state of every session, as observed by the most recent iteration of the main loop,
+// into a new immutable snapshot and publish it.  The snapshot is built from values cached during the iteration, so no
+// hardware is touched here.
+//
+void SessionManager::publishSnapshot() noexcept
+{
+    SessionSnapshotSet_t * const snapshot = new SessionSnapshotSet_t();
+
+    snapshot->timestamp = ::time(NULL);
+    snapshot->ambientTemp = lastAmbientTemp_;
+    snapshot->powerLoad = Registry::instance().powerScheduler().load();
+    snapshot->powerBudget = Registry::instance().powerScheduler().budget();
+    snapshot->sessions.reserve(sessions_.size());
+
+    for(auto it : sessions_)
+    {
+        const Session * const session = it.second;
+        SessionSnapshot_t s;
+
+        s.id                = session->id();
+        s.gyleId            = session->gyleId();
+        s.gyleName          = session->gyleName();
+        s.type              = session->type();
+        s.active            = session->isActive();
+        s.complete          = session->isComplete();
+        s.targetTemp        = session->targetTemp();
+        s.targetOverridden  = session->hasTargetOverride();
+        s.held              = session->isHeld();
+        s.currentTemp       = session->lastTemp();
+        s.sensorInRange     = session->vesselTempSensorInRange();
+        s.tempControlState  = session->tempControlState();
+        s.remainingTime     = session->remainingTime();
+        s.controlOutput     = session->controlOutput();
+        s.autotuning        = session->isAutotuning();
+        s.timeToTarget      = session->timeToTarget();
+        s.modelValid        = session->model().isValid();
+        s.modelSamples      = session->model().samples();
+        s.modelTimeConstant = session->model().timeConstant();
+        s.modelHeatRate     = session->model().heatRate();
+        s.modelCoolRate     = session->model().coolRate();
+        s.modelCoupling     = session->model().coupling();
+        s.heaterState       = session->heaterState();
+        s.coolerState       = session->coolerState();
+        s.powerWaiting      = session->isWaitingForPower();
+
+        snapshot->sessions.push_back(s);
+    }
+
+    Registry::instance().snapshots().publish(snapshot);
+}
+
+
+// processCommands() - execute all commands queued by other threads since the last tick, and deliver the result of each
+// to its submitter.  Called only from the session manager thread, so commands never race with the control loop.
+//
+void SessionManager::processCommands() noexcept
+{
+    auto& queue = Registry::instance().sessionCommands();
+    SessionCommand_t cmd;
+
+    while(queue.pop(cmd))
+    {
+        Error err;
+
+        if(!executeCommand(cmd, &err))
+            logWarning("Session %d: command '%s' failed: %s", cmd.sessionId, SessionCommandQueue::name(cmd.type),
+                       err.message().c_str());
+
+        cmd.result.set_value(err);
+    }
+}
+
+
+// executeCommand() - execute a single command against the session it names.  Returns true on success; false, with
+// <err> set, otherwise.
+//
+bool SessionManager::executeCommand(const SessionCommand_t& cmd, Error * const err) noexcept
+{
+    auto it = sessions_.find(cmd.sessionId);
+    if(it == sessions_.end())
+    {
+        formatError(err, NO_SUCH_SESSION, cmd.sessionId);
+        return false;
+    }
+
+    Session * const session = it->second;
+
+    switch(cmd.type)
+    {
+        case SESSION_CMD_SET_TARGET:
+            return session->setTargetOverride(Temperature(cmd.value, TEMP_UNIT_CELSIUS), err);
+
+        case SESSION_CMD_CLEAR_TARGET:
+            return session->clearTargetOverride(err);
+
+        case SESSION_CMD_HOLD:
+            return session->hold(err);
+
+        case SESSION_CMD_RELEASE:
+            return session->release(err);
+
+        case SESSION_CMD_SKIP_STAGE:
+            return session->skipStage(err);
+
+        case SESSION_CMD_MARK_COMPLETE:
+            return session->markComplete(err);
+
+        case SESSION_CMD_AUTOTUNE:
+            return session->startAutotune(err);
+
+        default:
+            formatError(err, INVALID_SESSION_COMMAND, cmd.type);
+            return false;
+    }
+}
+
+
+// rejectCommands() - fail any commands still queued when the session manager stops, so that no submitter waits
+// forever.
+//
+void SessionManager::rejectCommands() noexcept
+{
+    auto& queue = Registry::instance().sessionCommands();
+    SessionCommand_t cmd;
+
+    while(queue.pop(cmd))
+    {
+        Error err;
+
+        formatError(&err, SESSION_MANAGER_STOPPING);
+        cmd.result.set_value(err);
+    }
+}
+
+
 // run() - main loop.
 //
 bool SessionManager::run() noexcept
@@ -119,32 +378,77 @@ bool SessionManager::run() noexcept
 
     while(!stop_)
     {
-        ambientTemp();      // Force an update of the ambient temperature moving average
+        processCommands();
+
+        lastAmbientTemp_ = ambientTemp();   // Force an update of the ambient temperature moving average
 
         for(auto it = sessions_.begin(); it != sessions_.end(); ++it)
         {
             Session * const session = it->second;
 
+            session->setAmbientTemp(lastAmbientTemp_);
+
 //            if(session->isComplete())
 //                sessions_.erase(it);
 //            else
                 session->iterate();
         }
 
+        // Grant power to effectors, subject to the brewhouse power budget
+        Registry::instance().powerScheduler().schedule();
+
+        const auto now = steady_clock::now();
+        if((now - lastSnapshot_) >= snapshotInterval_)
+        {
+            publishSnapshot();
+            lastSnapshot_ = now;
+        }
+
+        if((now - lastCheckpoint_) >= checkpointInterval_)
+        {
+            checkpoint();
+            lastCheckpoint_ = now;
+        }
+
         display_->update();
         ::usleep(10 * 1000);
     }
 
     logInfo("SessionManager stopping");
 
-    for(auto session : sessions_)
-        session.second->stop();
+    rejectCommands();
+
+    // Take a final checkpoint before the effectors are switched off, so that a restart picks up where this run left off
+    checkpoint();
+
+    if(handoff_)
+    {
+        // Handing off to a new instance of the application: leave the effectors and the display as they are, and
+        // capture the state from which the new instance will resume control.
+        captureState(handoffState_);
+    }
+    else
+    {
+        for(auto session : sessions_)
+            session.second->stop();
 
-    display_->notifyShutdown();
+        display_->notifyShutdown();
+
+        display_->stop();
+    }
 
-    display_->stop();
     running_ = false;
 
     return true;
 }
 
+
+// handOff() - stop the session manager without switching off the effectors, in preparation for handing control to a
+// new instance of the application.  Once the thread has stopped, handoffState() returns the state to hand off.
+//
+void SessionManager::handOff() noexcept
+{
+    handoff_ = true;
+    stop();
+}
+
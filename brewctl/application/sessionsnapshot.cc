@@ -0,0 +1,43 @@
+/*
+    sessionsnapshot.cc: immutable, versioned snapshots of session state.  Snapshots are published by the session manager
+    and consumed by readers (the display, the web service) which must not touch the hardware.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/sessionsnapshot.h"
+
+
+// ctor - start with an empty snapshot, so that readers never see a null ptr.
+//
+SessionSnapshotStore::SessionSnapshotStore() noexcept
+    : current_(new SessionSnapshotSet_t()),
+      version_(0)
+{
+}
+
+
+// publish() - assign the next version number to <snapshot> and make it the current snapshot.  The store takes
+// ownership of <snapshot>, which must not be modified after this call.  Readers holding the previous snapshot continue
+// to see it, unchanged, until they release it; it is freed when the last reader lets go.  Only the session manager
+// thread should call this method.
+//
+void SessionSnapshotStore::publish(SessionSnapshotSet_t * const snapshot) noexcept
+{
+    snapshot->version = version_ + 1;
+
+    current_.store(snapshot);
+    version_ = snapshot->version;
+}
+
+
+// current() - return the most-recently-published snapshot.  May be called from any thread, and never waits for the
+// publisher or for other readers.  The returned object is immutable and remains valid for as long as the caller holds
+// the ptr.
+//
+SessionSnapshotSet_sptr_t SessionSnapshotStore::current() const noexcept
+{
+    return current_.load();
+}
@@ -0,0 +1,194 @@
+/*
+    statefile.cc: memory-mapped checkpoint of the control state (sensor filters, PID integrators, thermal models,
+    effector states), from which the session manager restores itself after a restart.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/statefile.h"
+#include "include/framework/log.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+extern "C"
+{
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+using std::string;
+
+
+static const uint32_t
+    STATE_FILE_MAGIC    = 0x42435354,           // "BCST"
+    STATE_FILE_VERSION  = 1,
+    FNV_OFFSET_BASIS    = 2166136261u,
+    FNV_PRIME           = 16777619u;
+
+
+// ctor
+//
+StateFile::StateFile() noexcept
+    : fd_(-1),
+      map_(nullptr),
+      generation_(0)
+{
+}
+
+
+// dtor - unmap and close the file
+//
+StateFile::~StateFile() noexcept
+{
+    close();
+}
+
+
+// open() - open (creating if necessary) the state file at <path>, and map it into memory.  A file of the wrong size,
+// e.g. one written by a version of the application with a different state layout, is resized; its contents will then
+// fail validation, so nothing is restored from it.
+//
+bool StateFile::open(const string& path, Error * const err) noexcept
+{
+    close();
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if(fd_ == -1)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "open()");
+        return false;
+    }
+
+    struct stat st;
+    if(::fstat(fd_, &st))
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "fstat()");
+        close();
+        return false;
+    }
+
+    if(((size_t) st.st_size != sizeof(Layout_t)) && ::ftruncate(fd_, sizeof(Layout_t)))
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "ftruncate()");
+        close();
+        return false;
+    }
+
+    void * const p = ::mmap(NULL, sizeof(Layout_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(p == MAP_FAILED)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "mmap()");
+        close();
+        return false;
+    }
+
+    map_ = static_cast<Layout_t *>(p);
+
+    generation_ = 0;
+    for(const auto& slot : map_->slots)
+        if(isValid(slot) && (slot.generation > generation_))
+            generation_ = slot.generation;
+
+    return true;
+}
+
+
+// close() - unmap and close the file, if open.
+//
+void StateFile::close() noexcept
+{
+    if(map_ != nullptr)
+    {
+        ::msync(map_, sizeof(Layout_t), MS_SYNC);
+        ::munmap(map_, sizeof(Layout_t));
+        map_ = nullptr;
+    }
+
+    if(fd_ != -1)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+
+// checksum() - return the FNV-1a hash of <slot>'s generation number and data.
+//
+uint32_t StateFile::checksum(const Slot_t& slot) noexcept
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&slot.generation);
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for(size_t i = 0; i < sizeof(slot.generation); ++i)
+        hash = (hash ^ p[i]) * FNV_PRIME;
+
+    p = reinterpret_cast<const unsigned char *>(&slot.data);
+    for(size_t i = 0; i < sizeof(slot.data); ++i)
+        hash = (hash ^ p[i]) * FNV_PRIME;
+
+    return hash;
+}
+
+
+// isValid() - return true if <slot> contains a complete checkpoint written by this version of the application.
+//
+bool StateFile::isValid(const Slot_t& slot) const noexcept
+{
+    return (slot.magic == STATE_FILE_MAGIC) && (slot.version == STATE_FILE_VERSION)
+           && (slot.data.nsessions <= STATE_MAX_SESSIONS) && (slot.checksum == checksum(slot));
+}
+
+
+// save() - write <data> into the older of the two slots, and schedule it to be written back to the file.  The write is
+// to memory, so this is cheap enough to call from the control loop; the kernel writes the page back asynchronously,
+// and the data survives a crash of the process (though not necessarily of the system) as soon as save() returns.
+//
+bool StateFile::save(const StateData_t& data) noexcept
+{
+    if(map_ == nullptr)
+        return false;
+
+    Slot_t& slot = map_->slots[(generation_ + 1) & 1];
+
+    slot.magic = STATE_FILE_MAGIC;
+    slot.version = STATE_FILE_VERSION;
+    slot.generation = ++generation_;
+    slot.reserved = 0;
+    ::memcpy(&slot.data, &data, sizeof(data));
+    slot.checksum = checksum(slot);
+
+    if(::msync(map_, sizeof(Layout_t), MS_ASYNC))
+    {
+        logWarning("StateFile: msync() failed: %s", ::strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+
+// load() - copy the most recent valid checkpoint into <data>.  Returns false if the file contains no valid checkpoint.
+//
+bool StateFile::load(StateData_t& data) const noexcept
+{
+    if(map_ == nullptr)
+        return false;
+
+    const Slot_t *best = nullptr;
+
+    for(const auto& slot : map_->slots)
+        if(isValid(slot) && ((best == nullptr) || (slot.generation > best->generation)))
+            best = &slot;
+
+    if(best == nullptr)
+        return false;
+
+    ::memcpy(&data, &best->data, sizeof(data));
+
+    return true;
+}
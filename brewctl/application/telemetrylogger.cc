@@ -0,0 +1,172 @@
+/*
+    telemetrylogger.cc: subscribes to the telemetry bus, and writes persistent records (temperature samples, effector
+    transitions) to the database.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/telemetrylogger.h"
+#include "include/framework/log.h"
+#include "include/framework/registry.h"
+#include "include/sqlite/sqlitestmt.h"
+#include "include/util/validator.h"
+
+extern "C"
+{
+#include <unistd.h>         // ::usleep()
+}
+
+namespace Validator = Util::Validator;
+
+
+static const int
+    DEFAULT_POLL_INTERVAL_MS    = 250,      // Default interval between drains of the telemetry bus
+    MAX_RECORDS_PER_DRAIN       = 256,      // Maximum number of records consumed per transaction
+    BUSY_TIMEOUT_MS             = 2000;     // Max time to wait for another connection to release the database
+
+
+// ctor - trivial initialisation of members
+//
+TelemetryLogger::TelemetryLogger() noexcept
+    : Thread(),
+      pollInterval_(DEFAULT_POLL_INTERVAL_MS),
+      lastDropped_(0)
+{
+}
+
+
+// init() - open a connection to the application's database, and subscribe to the telemetry bus.  This must be called
+// before any producer starts publishing, so that no persistent records are missed.  The logger writes on its own
+// connection, so that statements run by other threads on the shared connection don't join its transactions.
+//
+bool TelemetryLogger::init(Error * const err) noexcept
+{
+    if(!db_.open(Registry::instance().db().path(), SQLITE_OPEN_READWRITE, err)
+       || !db_.exec("PRAGMA busy_timeout=" + std::to_string(BUSY_TIMEOUT_MS), err))
+        return false;
+
+    subscriber_.reset(new TelemetrySubscriber(Registry::instance().telemetry()));
+    if(subscriber_ == nullptr)
+    {
+        formatError(err, MALLOC_FAILED);
+        return false;
+    }
+
+    pollInterval_ = Registry::instance().config().get("telemetry.logger_interval_ms", DEFAULT_POLL_INTERVAL_MS,
+                                                      Validator::gt0);
+    return true;
+}
+
+
+// run() - main loop.  Periodically drain the bus, writing persistent records to the database.
+//
+bool TelemetryLogger::run() noexcept
+{
+    running_ = true;
+    setName("tlog");
+
+    while(!stop_)
+    {
+        // Keep draining while there is a backlog; otherwise sleep until the next poll.
+        if(drain() < MAX_RECORDS_PER_DRAIN)
+            ::usleep(pollInterval_ * 1000);
+    }
+
+    // Flush any records published during shutdown
+    while(drain() == MAX_RECORDS_PER_DRAIN)
+        ;
+
+    logInfo("TelemetryLogger stopping");
+    running_ = false;
+
+    return true;
+}
+
+
+// drain() - consume up to MAX_RECORDS_PER_DRAIN records from the bus, writing any persistent records to the database
+// in a single transaction.  Returns the number of records consumed.
+//
+int TelemetryLogger::drain() noexcept
+{
+    bool inTransaction = false;
+    TelemetryRecord_t record;
+    int n;
+
+    for(n = 0; (n < MAX_RECORDS_PER_DRAIN) && subscriber_->next(record); ++n)
+    {
+        if(!(record.flags & TELEMETRY_FLAG_PERSIST))
+            continue;
+
+        if(!inTransaction)
+            inTransaction = db_.exec("BEGIN");
+
+        write(record);
+    }
+
+    if(inTransaction && !db_.exec("COMMIT"))
+    {
+        logWarning("TelemetryLogger: failed to commit telemetry records");
+        db_.exec("ROLLBACK");
+    }
+
+    if(subscriber_->dropped() != lastDropped_)
+    {
+        logWarning("TelemetryLogger: %llu telemetry records lost (logger fell behind)",
+                   (unsigned long long) (subscriber_->dropped() - lastDropped_));
+        lastDropped_ = subscriber_->dropped();
+    }
+
+    return n;
+}
+
+
+// write() - write a single persistent record to the appropriate database table.  Swallow (but log) any errors.  Each
+// record is given the next change sequence number (see /changes), which is shared by the temperature and effectorlog
+// tables.  Each MAX(seq) is a lookup of the last row of a table, so the cost of this doesn't grow with the size of the
+// log; and the number is allocated within the writer's transaction, so numbers become visible to readers in order.
+//
+bool TelemetryLogger::write(const TelemetryRecord_t& record) noexcept
+{
+    SQLiteStmt stmt;
+    Error err;
+
+    const long long timestamp = record.timestamp / 1000;
+
+    switch(record.type)
+    {
+        case TELEMETRY_SENSOR_SAMPLE:
+            if(db_.prepare("INSERT INTO temperature(seq, date_create, sensor_id, temperature) "
+                           "SELECT MAX(COALESCE((SELECT MAX(seq) FROM temperature), 0), "
+                           "COALESCE((SELECT MAX(seq) FROM effectorlog), 0)) + 1, "
+                           "DATETIME(:ts, 'unixepoch'), :sensor_id, :temperature",
+                           stmt, &err)
+               && stmt.bind(":ts", timestamp, &err)
+               && stmt.bind(":sensor_id", (int) record.channel, &err)
+               && stmt.bind(":temperature", record.sensor.tempC, &err)
+               && stmt.execute(&err))
+                return true;
+            break;
+
+        case TELEMETRY_EFFECTOR_TRANSITION:
+            if(db_.prepare("INSERT INTO effectorlog(seq, date_create, effector_id, newstate) "
+                           "SELECT MAX(COALESCE((SELECT MAX(seq) FROM temperature), 0), "
+                           "COALESCE((SELECT MAX(seq) FROM effectorlog), 0)) + 1, "
+                           "DATETIME(:ts, 'unixepoch'), :effectorId, :newState",
+                           stmt, &err)
+               && stmt.bind(":ts", timestamp, &err)
+               && stmt.bind(":effectorId", (int) record.channel, &err)
+               && stmt.bind(":newState", (int) record.effector.state, &err)
+               && stmt.execute(&err))
+                return true;
+            break;
+
+        default:
+            return true;        // Nothing to persist
+    }
+
+    logWarning("TelemetryLogger: failed to persist record of type %d on channel %d: %s", record.type, record.channel,
+               err.message().c_str());
+    return false;
+}
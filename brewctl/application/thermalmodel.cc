@@ -0,0 +1,222 @@
+/*
+    thermalmodel.cc: online identification of a vessel's thermal behaviour.  Models the vessel as a first-order plant,
+
+        dT/dt = a * (Tamb - T) + bh * uh + bc * uc
+
+    where uh and uc are the heater and cooler duty cycles (0..1), and estimates the parameters [a, bh, bc] by recursive
+    least squares with exponential forgetting.  Rates are expressed per hour, to keep the estimator well-conditioned.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/thermalmodel.h"
+#include <cmath>
+
+
+static const double
+    SECS_PER_HOUR               = 3600.0,
+    INITIAL_COVARIANCE          = 100.0,    // Initial diagonal of P: large, i.e. "no confidence" in the initial estimate
+    MAX_COVARIANCE_TRACE        = 1.0e4,    // Stop forgetting when trace(P) exceeds this, to prevent covariance wind-up
+    MIN_COUPLING                = 1.0e-3;   // Min plausible value of <a> (1/h), i.e. a time constant of ~40 days
+
+static const uint32_t
+    MIN_SAMPLES                 = 30;       // Number of updates required before the model is considered usable
+
+
+// ctor
+//
+ThermalModel::ThermalModel(const double forgetting, const double sampleInterval) noexcept
+    : forgetting_(forgetting),
+      sampleInterval_(sampleInterval)
+{
+    reset();
+}
+
+
+// reset() - discard all learned parameters.
+//
+void ThermalModel::reset() noexcept
+{
+    for(int i = 0; i < 3; ++i)
+    {
+        state_.theta[i] = 0.0;
+        for(int j = 0; j < 3; ++j)
+            state_.P[i][j] = (i == j) ? INITIAL_COVARIANCE : 0.0;
+    }
+
+    state_.nsamples = 0;
+    intervalStart_ = -1.0;
+}
+
+
+// observe() - feed one observation into the model.  <now> is a monotonic time in seconds.  Call this on every control
+// loop iteration: the heater/cooler duty cycles, and the mean vessel and ambient temperatures, are integrated over each
+// sample interval, and a single O(1) RLS update is performed at the end of each interval.
+//
+void ThermalModel::observe(const double now, const double tempC, const double ambientC, const bool heating,
+                           const bool cooling) noexcept
+{
+    if(intervalStart_ < 0.0)
+    {
+        intervalStart_ = lastObserved_ = now;
+        startTemp_ = tempC;
+        heatingTime_ = coolingTime_ = tempIntegral_ = ambientIntegral_ = 0.0;
+        return;
+    }
+
+    const double dt = now - lastObserved_;
+    lastObserved_ = now;
+
+    if(dt > sampleInterval_)
+    {
+        // Observations were interrupted (e.g. by a sensor fault); the accumulated interval is unusable.
+        intervalStart_ = -1.0;
+        observe(now, tempC, ambientC, heating, cooling);
+        return;
+    }
+
+    if(heating)
+        heatingTime_ += dt;
+
+    if(cooling)
+        coolingTime_ += dt;
+
+    tempIntegral_ += tempC * dt;
+    ambientIntegral_ += ambientC * dt;
+
+    const double interval = now - intervalStart_;
+    if(interval >= sampleInterval_)
+    {
+        const double phi[3] = {(ambientIntegral_ - tempIntegral_) / interval,
+                               heatingTime_ / interval,
+                               coolingTime_ / interval};
+
+        update(phi, (tempC - startTemp_) * SECS_PER_HOUR / interval);
+
+        intervalStart_ = now;
+        startTemp_ = tempC;
+        heatingTime_ = coolingTime_ = tempIntegral_ = ambientIntegral_ = 0.0;
+    }
+}
+
+
+// update() - single recursive-least-squares step with forgetting factor, for regressor <phi> and observation <y>:
+//
+//      k = P.phi / (lambda + phi'.P.phi)
+//      theta += k * (y - phi'.theta)
+//      P = (P - k.phi'.P) / lambda
+//
+// Forgetting is suspended while the covariance is large (i.e. while the input is not exciting the plant), so that P
+// does not grow without bound during long periods of steady-state operation.
+//
+void ThermalModel::update(const double phi[3], const double y) noexcept
+{
+    double Pphi[3], denom = 0.0, err = y;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        Pphi[i] = 0.0;
+        for(int j = 0; j < 3; ++j)
+            Pphi[i] += state_.P[i][j] * phi[j];
+
+        err -= phi[i] * state_.theta[i];
+    }
+
+    const double trace = state_.P[0][0] + state_.P[1][1] + state_.P[2][2],
+                 lambda = (trace < MAX_COVARIANCE_TRACE) ? forgetting_ : 1.0;
+
+    for(int i = 0; i < 3; ++i)
+        denom += phi[i] * Pphi[i];
+
+    denom += lambda;
+
+    for(int i = 0; i < 3; ++i)
+        state_.theta[i] += (Pphi[i] / denom) * err;
+
+    // P is symmetric, so phi'.P == (P.phi)'
+    for(int i = 0; i < 3; ++i)
+        for(int j = 0; j < 3; ++j)
+            state_.P[i][j] = (state_.P[i][j] - ((Pphi[i] * Pphi[j]) / denom)) / lambda;
+
+    ++state_.nsamples;
+}
+
+
+// isValid() - return true if the model has seen enough data, and its parameters are physically plausible, to be used
+// for prediction.
+//
+bool ThermalModel::isValid() const noexcept
+{
+    return (state_.nsamples >= MIN_SAMPLES) && (state_.theta[0] > MIN_COUPLING) && (state_.theta[1] >= 0.0)
+           && (state_.theta[2] <= 0.0);
+}
+
+
+// timeConstant() - return the vessel's thermal time constant (1/a), in seconds; or 0 if the model is not valid.
+//
+double ThermalModel::timeConstant() const noexcept
+{
+    return isValid() ? SECS_PER_HOUR / state_.theta[0] : 0.0;
+}
+
+
+// predict() - return the vessel temperature predicted <horizon> seconds from now, given the current temperature and
+// constant duty cycles <uh> and <uc>.  Uses the exact solution of the first-order model,
+//
+//      T(t) = Teq + (T0 - Teq) * exp(-a * t),  where Teq = Tamb + (bh * uh + bc * uc) / a
+//
+double ThermalModel::predict(const double tempC, const double ambientC, const double uh, const double uc,
+                             const double horizon) const noexcept
+{
+    const double a = state_.theta[0],
+                 Teq = ambientC + (((state_.theta[1] * uh) + (state_.theta[2] * uc)) / a);
+
+    return Teq + ((tempC - Teq) * ::exp(-a * horizon / SECS_PER_HOUR));
+}
+
+
+// dutyFor() - return the heater (if <heating>) or cooler duty cycle, in the range [0, 1], which the model predicts
+// will bring the vessel exactly to <targetC> after <horizon> seconds.  The controller uses this as an upper bound on
+// its output, which makes it back off before the vessel overshoots rather than after.
+//
+double ThermalModel::dutyFor(const double tempC, const double ambientC, const double targetC, const double horizon,
+                             const bool heating) const noexcept
+{
+    const double a = state_.theta[0],
+                 b = heating ? state_.theta[1] : state_.theta[2],
+                 e = ::exp(-a * horizon / SECS_PER_HOUR);
+
+    if(::fabs(b) < 1.0e-9)
+        return 1.0;         // Effector has no measurable effect; don't constrain it
+
+    const double u = (a * (targetC - ambientC - ((tempC - ambientC) * e))) / (b * (1.0 - e));
+
+    return (u < 0.0) ? 0.0 : ((u > 1.0) ? 1.0 : u);
+}
+
+
+// timeTo() - forecast the time, in seconds, for the vessel to reach <targetC> from <tempC> with the heater (if below
+// target) or cooler (if above) running continuously.  Returns 0 if the vessel is already at the target, and -1 if the
+// model is not valid or predicts that the target is unreachable.
+//
+double ThermalModel::timeTo(const double tempC, const double ambientC, const double targetC) const noexcept
+{
+    if(!isValid())
+        return -1.0;
+
+    if(tempC == targetC)
+        return 0.0;
+
+    const bool heating = tempC < targetC;
+    const double a = state_.theta[0],
+                 Teq = ambientC + ((heating ? state_.theta[1] : state_.theta[2]) / a),
+                 ratio = (targetC - Teq) / (tempC - Teq);
+
+    // The target must lie between the current temperature and the equilibrium temperature
+    if((ratio <= 0.0) || (ratio >= 1.0))
+        return -1.0;
+
+    return -::log(ratio) * SECS_PER_HOUR / a;
+}
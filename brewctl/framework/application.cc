@@ -7,6 +7,7 @@
 */
 
 #include "include/framework/application.h"
+#include "include/framework/handoff.h"
 #include "include/framework/log.h"
 #include "include/framework/registry.h"
 #include "include/util/net.h"
@@ -15,6 +16,7 @@
 #include "include/util/thread.h"
 #include "include/util/validator.h"
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
@@ -27,9 +29,12 @@
 
 extern "C"
 {
+#include <fcntl.h>          // ::fcntl()
+#include <limits.h>         // PATH_MAX
 #include <signal.h>         // ::sigaction()
+#include <error.h>          // ::error()
 #include <strings.h>        // ::bzero()
-#include <unistd.h>         // ::sleep()
+#include <unistd.h>         // ::sleep(), ::execv(), ::readlink()
 }
 
 using std::ifstream;
@@ -37,6 +42,7 @@ using std::ostringstream;
 using std::queue;
 using std::string;
 using std::thread;
+using std::vector;
 namespace Validator = Util::Validator;
 
 
@@ -53,6 +59,9 @@ static ConfigData_t defaultConfig =
 {
     {"adc.ref_voltage",             StringValue("5.012")},
     {"adc.isource_ua",              StringValue("146")},                    // ADC current-source current in microamps
+    {"alarm.history_len",           StringValue("20")},                     // Cleared alarms reported by the API
+    {"alarm.poll_interval_ms",      StringValue("500")},                    // Alarm-rule evaluation interval
+    {"alarm.reload_interval_s",     StringValue("60")},                     // Interval between alarm-rule reloads
     {"application.daemonise",       StringValue("0")},
     {"application.pid_file",        StringValue("/home/swallace/cjbc/brewctl/brewctl.pid")},   // FIXME - should be under /var/run/
     {"application.short_name",      StringValue("brewctl")},
@@ -61,14 +70,44 @@ static ConfigData_t defaultConfig =
     {"log.method",                  StringValue("syslog")},
     {"log.level",                   StringValue("debug")},
     {"sensor.average_len",          StringValue("1000")},                   // Sensor-reading moving-avg len
-    {"sensor.log_interval_s",       StringValue("10")},                     // Interval between sensor readings
+    {"sensor.log_interval_s",       StringValue("10")},                     // Max interval between logged readings
+    {"sensor.max_sample_interval_ms",StringValue("2000")},                  // Max interval between ADC reads
+    {"sensor.min_log_interval_s",   StringValue("5")},                      // Min interval between logged readings
+    {"sensor.min_sample_interval_ms",StringValue("10")},                    // Min interval between ADC reads
+    {"sensor.publish_interval_ms",  StringValue("1000")},                   // Interval between telemetry samples
+    {"sensor.resolution_c",         StringValue("0.05")},                   // Temp change resolved by adaptive rates
+    {"model.forgetting",            StringValue("0.999")},                  // Thermal-model RLS forgetting factor
+    {"model.horizon_s",             StringValue("300")},                    // Predictive-switching look-ahead
+    {"model.sample_interval_s",     StringValue("60")},                     // Interval between thermal-model updates
+    {"power.budget_w",              StringValue("0")},                      // Brewhouse power budget; 0 = unlimited
+    {"power.stagger_ms",            StringValue("1000")},                   // Min interval between effector switch-ons
+    {"service.compress_min_bytes",  StringValue("1024")},                   // Min size of compressed HTTP responses
+    {"service.connection_limit",    StringValue("32")},                     // Max concurrent HTTP connections
+    {"service.connection_timeout_s",StringValue("30")},                     // Idle HTTP connection timeout
+    {"service.max_upload_bytes",    StringValue("16777216")},               // Max size of an API request body
     {"service.port",                StringValue("1900")},                   // App web service interface port
+    {"service.static_dir",          StringValue("/home/swallace/cjbc/brewctl/dashboard")},  // FIXME - should be in /usr/share/brewctl
+    {"service.static_max_age_s",    StringValue("86400")},                  // Cache lifetime of static assets
+    {"service.stream_keepalive_s",  StringValue("15")},                     // Max idle time on an event stream
+    {"service.stream_poll_interval_ms",StringValue("250")},                 // Event-stream poll interval
+    {"service.thread_pool_size",    StringValue("2")},                      // HTTP daemon worker threads
+    {"service.unix_socket",         StringValue("/home/swallace/cjbc/brewctl/brewctl.sock")},   // FIXME - should be under /run/brewctl
+    {"service.unix_socket_group",   StringValue("")},                       // Group permitted to use the socket
+    {"session.control_mode",        StringValue("pid")},                    // Temp control: "pid" or "bangbang"
     {"session.dead_zone",           StringValue("0.5C")},                   // "Dead zone" for session temp control
+    {"session.pwm_min_on_s",        StringValue("20")},                     // Min effector on/off time per window
+    {"session.pwm_window_s",        StringValue("300")},                    // Time-proportioning window length
+    {"session.snapshot_interval_ms",StringValue("500")},                    // Interval between state snapshots
     {"session.switch_interval_s",   StringValue("60")},
     {"spi.dev",                     StringValue("/dev/spidev0.0")},
     {"spi.mode",                    StringValue("0")},
     {"spi.max_clock",               StringValue("500000")},
+    {"state.checkpoint_interval_s", StringValue("10")},                     // Interval between state checkpoints
+    {"state.file",                  StringValue("/home/swallace/cjbc/brewctl/brewctl.state")},  // FIXME - should be under /var/lib/brewctl
+    {"state.max_age_s",             StringValue("300")},                    // Max age of checkpoint to restore
     {"system.avahi_service_name",   StringValue("brewctl")},
+    {"telemetry.logger_interval_ms",StringValue("250")},                    // Telemetry logger poll interval
+    {"telemetry.ring_size",         StringValue("4096")},                   // Telemetry bus capacity, in records
 };
 
 
@@ -78,11 +117,27 @@ Application::Application(int argc, char **argv, Error * const err) noexcept
     : avahiService_(nullptr),
       httpService_(nullptr),
       systemId_(0),
-      stop_(false)
+      stop_(false),
+      upgrade_(false)
 {
     gApp = this;
     appName_ = argc ? argv[0] : DEFAULT_APP_NAME;
 
+    // Record the path of the running binary and the command-line arguments, so that the application can re-exec itself
+    // during an upgrade.  The path must be read now: once the binary is replaced, /proc/self/exe names a deleted file.
+    char exePath[PATH_MAX];
+    const ssize_t len = ::readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+
+    exePath_ = (len > 0) ? string(exePath, len) : appName_;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!::strcmp(argv[i], "--handoff"))
+            ++i;            // Don't pass a handoff from a previous upgrade on to the next one
+        else
+            args_.push_back(argv[i]);
+    }
+
     Util::Random::seed();
 
     config_.add(defaultConfig);             // add default values to config
@@ -96,9 +151,9 @@ Application::Application(int argc, char **argv, Error * const err) noexcept
 }
 
 
-// installQuitHandler() - install a handler for the SIGQUIT signal.
+// installSignalHandlers() - install handlers for the SIGQUIT (stop) and SIGUSR2 (upgrade) signals.
 //
-bool Application::installQuitHandler(Error * const err) noexcept
+bool Application::installSignalHandlers(Error * const err) noexcept
 {
     struct sigaction sa;
 
@@ -111,7 +166,13 @@ bool Application::installQuitHandler(Error * const err) noexcept
         return false;
     }
 
-    logDebug("Installed handler for SIGQUIT");
+    if(::sigaction(SIGUSR2, &sa, NULL))
+    {
+        formatError(err, SIGHANDLER_INSTALL_FAILED, "SIGUSR2", ::strerror(errno), errno);
+        return false;
+    }
+
+    logDebug("Installed handlers for SIGQUIT and SIGUSR2");
     return true;
 }
 
@@ -125,6 +186,12 @@ void Application::signalHandler(int signum) noexcept
         logInfo("Received SIGQUIT; stopping");
         stop();
     }
+    else if(signum == SIGUSR2)
+    {
+        logInfo("Received SIGUSR2; upgrading");
+        upgrade_ = true;
+        stop();
+    }
     else
         logInfo("Ignoring spurious signal %d", signum);
 }
@@ -138,7 +205,7 @@ bool Application::parseArgs(int argc, char **argv, Error * const err) noexcept
     for(int i = 1; i < argc; ++i)
         args.push(argv[i]);
 
-    // Handle argument-less command-line forms "<app> stop" and "<app> status"
+    // Handle argument-less command-line forms "<app> stop", "<app> upgrade" and "<app> status"
     if(args.size() == 1)
     {
         if(args.back() == "stop")
@@ -146,10 +213,22 @@ bool Application::parseArgs(int argc, char **argv, Error * const err) noexcept
             stop_ = true;       // Prevent this instance of the application from starting up
             return sendQuitSignal(err);
         }
+        else if(args.back() == "upgrade")
+        {
+            stop_ = true;
+            return sendSignal(SIGUSR2, err);
+        }
         else if(args.back() == "status")
         {
             stop_ = true;
-            return isRunning(err);
+            if(!isRunning(err))
+                return false;
+
+            Error statusErr;
+            if(!printStatus(&statusErr))
+                ::error(0, 0, "Unable to query status: %s", statusErr.message().c_str());
+
+            return true;
         }
     }
 
@@ -188,6 +267,27 @@ bool Application::parseArgs(int argc, char **argv, Error * const err) noexcept
         }
         else if(arg == "-D")
             config_.addLine("application.daemonise=1");
+        else if(arg == "--handoff")
+        {
+            // Internal: this process was exec'ed by a previous instance of the application, which left its state in
+            // the named shared-memory segment.  If the state can't be read, start from scratch.
+            if(args.empty())
+            {
+                err->format(MISSING_ARGVAL, arg.c_str());
+                return false;
+            }
+
+            Error handoffErr;
+            handoff_.reset(new HandoffData_t);
+
+            if(!Handoff::read(args.front(), *handoff_, &handoffErr))
+            {
+                logWarning("Ignoring handoff from previous instance: %s", handoffErr.message().c_str());
+                handoff_.reset();
+            }
+
+            args.pop();
+        }
         else
         {
             err->format(UNKNOWN_ARG, arg.c_str());
@@ -228,8 +328,9 @@ bool Application::run(Error * const err) noexcept
         }
     }
 
-    // Daemonise, if specified in config
-    if(config_.strToBool("application.daemonise") && !Util::Sys::daemonise(err))
+    // Daemonise, if specified in config.  A process exec'ed by a previous instance during an upgrade is already a daemon
+    // (if configured to be one), and must keep its PID.
+    if((handoff_ == nullptr) && config_.strToBool("application.daemonise") && !Util::Sys::daemonise(err))
         return false;
 
     // Drop privileges, if specified in config
@@ -241,8 +342,10 @@ bool Application::run(Error * const err) noexcept
        !Util::Sys::writePidFile(config_.get<string>("application.pid_file"), err))
         return false;
 
-    if(!Registry::init(config_, err) ||             // Initialise registry
-       !sessionManager_.init(err))                  // Initialise session manager
+    if(!Registry::init(config_, err, handoff_.get()) ||     // Initialise registry
+       !telemetryLogger_.init(err) ||                       // Subscribe telemetry logger before any producer starts
+       !alarmEngine_.init(err) ||                           // Likewise the alarm engine
+       !sessionManager_.init(err))                          // Initialise session manager
         return false;
 
     systemId_ = getSystemId();
@@ -259,15 +362,20 @@ bool Application::run(Error * const err) noexcept
     if(err->code())
         return false;
 
-    httpService_ = new HttpService(port);
+    httpService_ = new HttpService(port, (handoff_ != nullptr) ? handoff_->httpFd : -1);
 
-    // Register SIGQUIT handler
-    if(!installQuitHandler(err))
+    // Register SIGQUIT and SIGUSR2 handlers
+    if(!installSignalHandlers(err))
         return false;
 
+    if(handoff_ != nullptr)
+        logInfo("Resumed control from previous instance");
+
     thread(&HttpService::run, httpService_).detach();
     thread(&AvahiService::run, avahiService_).detach();
     thread(&SessionManager::run, &sessionManager_).detach();
+    thread(&TelemetryLogger::run, &telemetryLogger_).detach();
+    thread(&AlarmEngine::run, &alarmEngine_).detach();
 
     Util::Thread::setName(Registry::instance().config()("application.short_name") + ": main");
 
@@ -275,9 +383,15 @@ bool Application::run(Error * const err) noexcept
     while(!stop_)
         ::sleep(1);
 
-    // Signal child threads to stop
+    // Signal child threads to stop.  When upgrading, keep the HTTP service's listening socket for the new instance, so
+    // that no connection attempt is refused during the upgrade.
+    int httpListenFd = -1;
+
     if(httpService_ != nullptr)
     {
+        if(upgrade_)
+            httpListenFd = httpService_->quiesce();
+
         logInfo("Stopping HTTP service");
         httpService_->stop();
     }
@@ -289,18 +403,43 @@ bool Application::run(Error * const err) noexcept
     }
 
     logInfo("Stopping session manager");
-    sessionManager_.stop();
+    if(upgrade_)
+        sessionManager_.handOff();      // Leave the effectors as they are
+    else
+        sessionManager_.stop();
+
+    logInfo("Stopping alarm engine");
+    alarmEngine_.stop();
 
     logInfo("Stopping button manager");
     Registry::instance().buttonManager().stop();
 
     // Wait for child threads to stop
-    while(httpService_->isRunning() || avahiService_->isRunning() || sessionManager_.isRunning())
+    while(httpService_->isRunning() || avahiService_->isRunning() || sessionManager_.isRunning()
+          || alarmEngine_.isRunning())
     {
         logInfo("Waiting for child threads to stop");
         ::sleep(1);
     }
 
+    // Stop the telemetry logger last, so that it persists any records published by the other threads as they stopped
+    logInfo("Stopping telemetry logger");
+    telemetryLogger_.stop();
+
+    while(telemetryLogger_.isRunning())
+    {
+        logInfo("Waiting for telemetry logger to stop");
+        ::sleep(1);
+    }
+
+    // execUpgrade() only returns if the new instance could not be started.  In that case, switch off the effectors,
+    // which the session manager left on, and exit.
+    if(upgrade_ && !execUpgrade(httpListenFd, err))
+    {
+        logError("Upgrade failed: %s; stopping", err->message().c_str());
+        Registry::instance().sr().write(0);
+    }
+
     // Remove PID file
     ::unlink(config_.get<string>("application.pid_file").c_str());
 
@@ -308,6 +447,60 @@ bool Application::run(Error * const err) noexcept
 }
 
 
+// execUpgrade() - hand control to a new instance of the application: write the state it needs to resume control into
+// a shared-memory segment, allow the HTTP listening socket (<httpFd>) and the SPI device to survive an exec, and exec
+// the application binary - which may since have been replaced - with the original arguments plus "--handoff <segment>".
+// Only returns on failure, with <err> set.
+//
+bool Application::execUpgrade(const int httpFd, Error * const err) noexcept
+{
+    auto& registry = Registry::instance();
+    HandoffData_t data;
+
+    ::bzero(&data, sizeof(data));
+    data.httpFd = httpFd;
+    data.spiFd = registry.spi().fd();
+    data.srValue = registry.sr().read();
+    data.state = sessionManager_.handoffState();
+
+    const string name = Handoff::segmentName();
+    if(!Handoff::write(name, data, err))
+        return false;
+
+    for(auto fd : {data.httpFd, data.spiFd})
+    {
+        if(fd == -1)
+            continue;
+
+        const int flags = ::fcntl(fd, F_GETFD);
+        if((flags == -1) || (::fcntl(fd, F_SETFD, flags & ~FD_CLOEXEC) == -1))
+        {
+            formatErrorWithErrno(err, SYSCALL_FAILED, "fcntl()");
+            Handoff::remove(name);
+            return false;
+        }
+    }
+
+    vector<string> args(1, exePath_);
+    args.insert(args.end(), args_.begin(), args_.end());
+    args.push_back("--handoff");
+    args.push_back(name);
+
+    vector<char *> argv;
+    for(auto& arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    logInfo("Executing %s to complete upgrade", exePath_.c_str());
+    ::execv(exePath_.c_str(), argv.data());
+
+    formatErrorWithErrno(err, SYSCALL_FAILED, "execv()");
+    Handoff::remove(name);
+
+    return false;
+}
+
+
 // stop() - stop application
 //
 void Application::stop() noexcept
@@ -375,6 +568,51 @@ bool Application::isRunning(Error * const err) noexcept
 }
 
 
+// printStatus() - query the running instance of the application, through the API on its Unix-domain socket, for the
+// state of its sessions, and print the response body to stdout.  Does nothing if no socket is configured.
+//
+bool Application::printStatus(Error * const err) noexcept
+{
+    const string path = config_.get<string>("service.unix_socket");
+    if(path.empty())
+        return true;
+
+    const int fd = Util::Net::connectUnix(path, err);
+    if(fd == -1)
+        return false;
+
+    // HTTP/1.0, so that the server closes the connection after responding
+    static const char request[] = "GET /sessions HTTP/1.0\r\nHost: localhost\r\nAccept: text/json\r\n\r\n";
+    string response;
+    char buffer[4096];
+    ssize_t len;
+
+    if(::write(fd, request, sizeof(request) - 1) != (ssize_t) (sizeof(request) - 1))
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "write()");
+        ::close(fd);
+        return false;
+    }
+
+    while((len = ::read(fd, buffer, sizeof(buffer))) > 0)
+        response.append(buffer, len);
+
+    ::close(fd);
+
+    if(len == -1)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "read()");
+        return false;
+    }
+
+    const size_t body = response.find("\r\n\r\n");
+    if(body != string::npos)
+        ::printf("%s\n", response.c_str() + body + 4);
+
+    return true;
+}
+
+
 // getSystemId() - get a unique identifier for this system (hardware).  This will be either the hardware (MAC) address
 // of the first Ethernet adaptor, or a 48-bit random number.
 //
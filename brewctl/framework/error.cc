@@ -43,6 +43,13 @@ static map<ErrorCode_t, string> errorMessages =
                                         "the service"},
     {CONFIG_KEY_MISSING,                "A required key, '%s', is not present in the configuration"},
     {SWITCH_USER_INSUFFICIENT_PRIV,     "Insufficient privilege to switch to user %s"},
+    {SESSION_NOT_ACTIVE,                "Session %d is not active"},
+    {SESSION_FINAL_STAGE,               "Session %d is in its final stage"},
+    {INVALID_SESSION_COMMAND,           "Invalid session command %d"},
+    {SESSION_MANAGER_STOPPING,          "The session manager is stopping"},
+    {INVALID_HANDOFF,                   "Handoff segment '%s' is missing or invalid"},
+    {SOCKET_PATH_TOO_LONG,              "Socket path '%s' is too long"},
+    {NO_SUCH_GROUP,                     "Group '%s' does not exist"},
     {DB_OPEN_FAILED,                    "Failed to create or open database file '%s': %s (%d)"},
     {DB_TOO_FEW_COLUMNS,                "Query returned too few columns"},
     {DB_SQLITE_ERROR,                   "SQLite error: %s (%d)"},
@@ -0,0 +1,130 @@
+/*
+    handoff.cc: state passed from a running instance of the application to its replacement during a binary upgrade.  The
+    old instance writes the state into a POSIX shared-memory segment and execs the new binary, naming the segment on
+    the command line; the new instance reads the segment, removes it, and resumes control without touching the outputs.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/handoff.h"
+#include "include/util/string.h"
+#include <cstring>
+
+extern "C"
+{
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+using std::string;
+
+
+static const uint32_t
+    HANDOFF_MAGIC   = 0x42434844,       // "BCHD"
+    HANDOFF_VERSION = 1;
+
+
+namespace Handoff
+{
+
+// segmentName() - return the name of the shared-memory segment used for a handoff from this process.
+//
+string segmentName() noexcept
+{
+    return string("/brewctl-handoff-") + Util::String::numberToString(::getpid());
+}
+
+
+// write() - stamp <data> with the magic number and layout version, and copy it into a new shared-memory segment named
+// <name>.  The segment is created exclusively and is readable only by the current user.
+//
+bool write(const string& name, HandoffData_t& data, Error * const err) noexcept
+{
+    data.magic = HANDOFF_MAGIC;
+    data.version = HANDOFF_VERSION;
+
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if(fd == -1)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "shm_open()");
+        return false;
+    }
+
+    if(::ftruncate(fd, sizeof(data)))
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "ftruncate()");
+        ::close(fd);
+        remove(name);
+        return false;
+    }
+
+    void * const p = ::mmap(NULL, sizeof(data), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(p == MAP_FAILED)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "mmap()");
+        remove(name);
+        return false;
+    }
+
+    ::memcpy(p, &data, sizeof(data));
+    ::munmap(p, sizeof(data));
+
+    return true;
+}
+
+
+// read() - copy the contents of the shared-memory segment named <name> into <data>, and remove the segment.  Fails if
+// the segment does not exist, or was written by a version of the application with a different handoff layout.
+//
+bool read(const string& name, HandoffData_t& data, Error * const err) noexcept
+{
+    const int fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if(fd == -1)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "shm_open()");
+        return false;
+    }
+
+    struct stat st;
+    void *p = MAP_FAILED;
+
+    if(!::fstat(fd, &st) && ((size_t) st.st_size == sizeof(data)))
+        p = ::mmap(NULL, sizeof(data), PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+    remove(name);
+
+    if(p == MAP_FAILED)
+    {
+        formatError(err, INVALID_HANDOFF, name.c_str());
+        return false;
+    }
+
+    ::memcpy(&data, p, sizeof(data));
+    ::munmap(p, sizeof(data));
+
+    if((data.magic != HANDOFF_MAGIC) || (data.version != HANDOFF_VERSION) || (data.spiFd < 0)
+       || (data.state.nsessions > STATE_MAX_SESSIONS))
+    {
+        formatError(err, INVALID_HANDOFF, name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+// remove() - remove the shared-memory segment named <name>.
+//
+void remove(const string& name) noexcept
+{
+    ::shm_unlink(name.c_str());
+}
+
+} // namespace Handoff
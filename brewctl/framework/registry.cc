@@ -8,25 +8,35 @@
 
 #include "include/framework/registry.h"
 #include "include/framework/log.h"
+#include "include/util/validator.h"
 #include <memory>
 #include <thread>
 
 using std::thread;
+namespace Validator = Util::Validator;
+
+
+static const int
+    DEFAULT_TELEMETRY_RING_SIZE = 4096,     // Default capacity of the telemetry bus, in records
+    DB_BUSY_TIMEOUT_MS          = 2000;     // Max time to wait for another connection to release the database
 
 
 Registry * Registry::instance_ = nullptr;
 
 
 // private ctor - initialise the various members in a well-defined order, as there are dependencies.  Attempt to open
-// the database file specified in config.
+// the database file specified in config.  If <handoff> is non-null, the application is taking over from a previous
+// instance, and the SPI device opened by that instance is used.
 //
-Registry::Registry(Config& config, Error * const err) noexcept
-    : config_(config),
+Registry::Registry(Config& config, Error * const err, const HandoffData_t *handoff) noexcept
+    : handoff_(handoff),
+      config_(config),
       gpio_(GPIOPort::instance(err)),
-      spi_(gpio_, config_, err),
+      spi_(gpio_, config_, err, (handoff != nullptr) ? handoff->spiFd : -1),
       sr_(gpio_, err),
       adc_(gpio_, config_, err),
-      lcd_(gpio_, err)
+      lcd_(gpio_, err),
+      telemetry_(config_.get("telemetry.ring_size", DEFAULT_TELEMETRY_RING_SIZE, Validator::gt0))
 {
     if(err->code())
         return;
@@ -37,17 +47,27 @@ Registry::Registry(Config& config, Error * const err) noexcept
         formatError(err, DB_OPEN_FAILED, config_("database").c_str(), err->message().c_str(), err->code());
         return;
     }
+
+    // Use write-ahead logging, so that readers holding a long-lived read transaction (e.g. API batch requests, which
+    // read from a consistent snapshot of the database) neither block nor are blocked by writers
+    Error pragmaErr;
+    if(!db_.exec("PRAGMA journal_mode=WAL", &pragmaErr))
+        logWarning("Failed to enable write-ahead logging: %s", pragmaErr.message().c_str());
+
+    // Wait, rather than fail, if another connection (e.g. an API import, on its own connection) holds the write lock
+    if(!db_.exec("PRAGMA busy_timeout=" + std::to_string(DB_BUSY_TIMEOUT_MS), &pragmaErr))
+        logWarning("Failed to set database busy timeout: %s", pragmaErr.message().c_str());
 }
 
 
 // init() - functions as a one-off public ctor to initialise the singleton.  Subsequent access to the object is via the
-// instance() method.
+// instance() method.  <handoff>, if non-null, must remain valid for the lifetime of the application.
 //
-bool Registry::init(Config& config, Error * const err) noexcept
+bool Registry::init(Config& config, Error * const err, const HandoffData_t *handoff) noexcept
 {
     if(instance_ == nullptr)
     {
-        instance_ = new Registry(config, err);
+        instance_ = new Registry(config, err, handoff);
         if(instance_ == nullptr)
         {
             formatError(err, MALLOC_FAILED);
@@ -67,6 +87,14 @@ bool Registry::init(Config& config, Error * const err) noexcept
 
         thread(&ButtonManager::run, instance_->buttonManager_).detach();
 
+        // When taking over from a previous instance, leave the outputs and the display exactly as that instance left
+        // them; otherwise force all outputs off and initialise the display.
+        if(handoff != nullptr)
+        {
+            instance_->sr().adopt(handoff->srValue);
+            return true;
+        }
+
         auto ret = instance_->sr().init(err);
 
         if(ret)
@@ -0,0 +1,208 @@
+/*
+    telemetry.cc: in-process telemetry bus.  Producers (sensors, effectors, sessions) publish fixed-size records into a
+    shared lock-free ring; any number of subscribers consume the records, each from its own cursor and at its own pace.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/telemetry.h"
+#include <chrono>
+#include <cstring>          // ::memcpy()
+
+using std::atomic_thread_fence;
+using std::memory_order_acq_rel;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+namespace chrono = std::chrono;
+
+
+// ctor - allocate the ring.  <capacity> is rounded up to the next power of two.  This is the only allocation the bus
+// ever performs.
+//
+TelemetryBus::TelemetryBus(const size_t capacity) noexcept
+    : capacity_(1),
+      head_(0),
+      dropped_(0)
+{
+    while(capacity_ < capacity)
+        capacity_ <<= 1;
+
+    mask_ = capacity_ - 1;
+    slots_.reset(new Slot_t[capacity_]);
+
+    for(size_t i = 0; i < capacity_; ++i)
+        slots_[i].seq.store(0, memory_order_relaxed);
+}
+
+
+// publish() - write <record> into the next free slot in the ring.  Never blocks and never allocates.  If the slot is
+// still being written by a producer from the previous lap of the ring (which can only happen if that producer has
+// stalled for an entire lap), the record is dropped and false is returned.
+//
+bool TelemetryBus::publish(TelemetryRecord_t& record) noexcept
+{
+    if(!record.timestamp)
+        record.timestamp = now();
+
+    const uint64_t pos = head_.fetch_add(1, memory_order_acq_rel),
+                   writing = (2 * pos) + 1;
+    Slot_t& slot = slots_[pos & mask_];
+
+    uint64_t seq = slot.seq.load(memory_order_acquire);
+    do
+    {
+        if((seq & 1) || (seq > writing))
+        {
+            dropped_.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+    } while(!slot.seq.compare_exchange_weak(seq, writing, memory_order_acq_rel, memory_order_acquire));
+
+    atomic_thread_fence(memory_order_release);
+
+    uint64_t words[WORDS_PER_RECORD];
+    ::memcpy(words, &record, sizeof(words));
+
+    for(size_t i = 0; i < WORDS_PER_RECORD; ++i)
+        slot.data[i].store(words[i], memory_order_relaxed);
+
+    slot.seq.store(writing + 1, memory_order_release);
+
+    return true;
+}
+
+
+// publishSensorSample() - publish a filtered temperature reading from the sensor on <channel>.  If <persist> is true,
+// the telemetry logger will write the reading to the temperature log.
+//
+bool TelemetryBus::publishSensorSample(const int channel, const int sessionId, const double tempC, const bool persist)
+    noexcept
+{
+    TelemetryRecord_t r = {};
+
+    r.type = TELEMETRY_SENSOR_SAMPLE;
+    r.flags = persist ? TELEMETRY_FLAG_PERSIST : 0;
+    r.channel = channel;
+    r.sessionId = sessionId;
+    r.sensor.tempC = tempC;
+
+    return publish(r);
+}
+
+
+// publishEffectorTransition() - publish a change of state of the effector on <channel>.  Transitions are always
+// persisted to the effector log.
+//
+bool TelemetryBus::publishEffectorTransition(const int channel, const bool state, const double powerW) noexcept
+{
+    TelemetryRecord_t r = {};
+
+    r.type = TELEMETRY_EFFECTOR_TRANSITION;
+    r.flags = TELEMETRY_FLAG_PERSIST;
+    r.channel = channel;
+    r.effector.state = state ? 1 : 0;
+    r.effector.powerW = powerW;
+
+    return publish(r);
+}
+
+
+// publishControlState() - publish a change in the temperature-control state of session <sessionId>.
+//
+bool TelemetryBus::publishControlState(const int sessionId, const int state, const double targetC,
+                                       const double currentC) noexcept
+{
+    TelemetryRecord_t r = {};
+
+    r.type = TELEMETRY_CONTROL_STATE;
+    r.channel = -1;
+    r.sessionId = sessionId;
+    r.control.state = state;
+    r.control.targetC = targetC;
+    r.control.currentC = currentC;
+
+    return publish(r);
+}
+
+
+// now() - return the current wall-clock time, in milliseconds since the epoch.
+//
+int64_t TelemetryBus::now() noexcept
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+// ctor - start consuming from the current head of the ring, i.e. subscribers see only records published after they
+// subscribe.
+//
+TelemetrySubscriber::TelemetrySubscriber(TelemetryBus& bus) noexcept
+    : bus_(bus),
+      cursor_(bus.head()),
+      dropped_(0)
+{
+}
+
+
+// next() - copy the next record into <record> and advance the cursor.  Returns false if no complete record is
+// available.  If the subscriber has fallen more than a full lap behind the producers, the records it missed are counted
+// in dropped() and the cursor skips forward to the oldest record still in the ring.
+//
+bool TelemetrySubscriber::next(TelemetryRecord_t& record) noexcept
+{
+    for(;;)
+    {
+        const uint64_t head = bus_.head();
+        if(cursor_ >= head)
+            return false;
+
+        if((head - cursor_) > bus_.capacity_)
+        {
+            dropped_ += head - cursor_ - bus_.capacity_;
+            cursor_ = head - bus_.capacity_;
+        }
+
+        TelemetryBus::Slot_t& slot = bus_.slots_[cursor_ & bus_.mask_];
+        const uint64_t expected = 2 * (cursor_ + 1),
+                       seq1 = slot.seq.load(memory_order_acquire);
+
+        if(seq1 < expected)
+            return false;           // Slot claimed, but the producer has not finished writing it yet
+
+        if(seq1 == expected)
+        {
+            uint64_t words[TelemetryBus::WORDS_PER_RECORD];
+
+            for(size_t i = 0; i < TelemetryBus::WORDS_PER_RECORD; ++i)
+                words[i] = slot.data[i].load(memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_acquire);
+
+            if(slot.seq.load(memory_order_relaxed) == expected)
+            {
+                ::memcpy(&record, words, sizeof(record));
+                ++cursor_;
+                return true;
+            }
+        }
+
+        // The slot has been overwritten by a producer on a later lap of the ring; skip it.
+        ++dropped_;
+        ++cursor_;
+    }
+}
+
+
+// seek() - move the cursor to position <pos>, so that the next record returned is the one published at that position.
+// A position beyond the head of the ring is clamped to the head; one which has since been overwritten is skipped, and
+// counted as dropped, by next().
+//
+void TelemetrySubscriber::seek(const uint64_t pos) noexcept
+{
+    const uint64_t head = bus_.head();
+
+    cursor_ = (pos > head) ? head : pos;
+}
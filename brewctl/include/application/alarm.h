@@ -0,0 +1,109 @@
+#ifndef APPLICATION_ALARM_H_INC
+#define APPLICATION_ALARM_H_INC
+/*
+    alarm.h: alarm rules and alarm events, and a store through which the alarm engine publishes immutable snapshots of
+    the current alarm state to readers (the display, the web service).
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/util/rcuptr.h"
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// The quantity which an alarm rule monitors
+typedef enum AlarmMetric
+{
+    ALARM_METRIC_NONE = 0,
+    ALARM_METRIC_TEMP,                      // Temperature reported by a sensor (target: sensor channel)
+    ALARM_METRIC_DEVIATION,                 // Vessel temperature minus target temperature (target: session id)
+    ALARM_METRIC_DUTY,                      // Fraction of time an effector is on (target: effector channel)
+    ALARM_METRIC_STALE                      // Seconds since a sensor last reported a reading (target: sensor channel)
+} AlarmMetric_t;
+
+// The aggregate, over the rule's window, which is compared with the rule's threshold
+typedef enum AlarmAggregate
+{
+    ALARM_AGG_LAST = 0,                     // Most recent value
+    ALARM_AGG_MEAN,
+    ALARM_AGG_MIN,
+    ALARM_AGG_MAX,
+    ALARM_AGG_VARIANCE
+} AlarmAggregate_t;
+
+typedef enum AlarmOperator
+{
+    ALARM_OP_INVALID = 0,
+    ALARM_OP_LT,
+    ALARM_OP_LE,
+    ALARM_OP_GT,
+    ALARM_OP_GE
+} AlarmOperator_t;
+
+
+typedef struct AlarmRule
+{
+    int                 id;
+    std::string         name;
+    AlarmMetric_t       metric;
+    int                 target;             // Sensor channel, session id or effector channel, depending on <metric>
+    AlarmAggregate_t    aggregate;
+    AlarmOperator_t     op;
+    double              threshold;
+    int                 window;             // Window length, in seconds; 0 = evaluate each sample as it arrives
+} AlarmRule_t;
+
+
+typedef struct Alarm
+{
+    uint64_t            id;                 // Id of the alarm's row in the alarm table; 0 if it was not recorded
+    int                 ruleId;
+    std::string         ruleName;
+    double              value;              // Value of the aggregate when the alarm was raised
+    time_t              raised;
+    time_t              cleared;            // 0 if the alarm is still active
+} Alarm_t;
+
+
+typedef struct AlarmSet
+{
+    uint64_t                    version;
+    time_t                      timestamp;
+    std::vector<Alarm_t>        active;
+    std::vector<Alarm_t>        recent;     // Recently-cleared alarms, most recent first
+} AlarmSet_t;
+
+typedef Util::RCUPtr<AlarmSet_t>::sptr_t AlarmSet_sptr_t;
+
+
+class AlarmStore
+{
+public:
+                                AlarmStore() noexcept;
+                                AlarmStore(const AlarmStore& rhs) = delete;
+                                AlarmStore(AlarmStore&& rhs) = delete;
+
+    AlarmStore&                 operator=(const AlarmStore& rhs) = delete;
+    AlarmStore&                 operator=(AlarmStore&& rhs) = delete;
+
+    void                        publish(AlarmSet_t * const alarms) noexcept;
+    AlarmSet_sptr_t             current() const noexcept;
+    uint64_t                    version() const noexcept { return version_; };
+
+    static AlarmMetric_t        metricFromName(const std::string& name) noexcept;
+    static AlarmAggregate_t     aggregateFromName(const std::string& name) noexcept;
+    static AlarmOperator_t      operatorFromName(const std::string& name) noexcept;
+
+private:
+    Util::RCUPtr<AlarmSet_t>    current_;
+    std::atomic<uint64_t>       version_;
+};
+
+#endif // APPLICATION_ALARM_H_INC
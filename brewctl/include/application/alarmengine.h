@@ -0,0 +1,83 @@
+#ifndef APPLICATION_ALARMENGINE_H_INC
+#define APPLICATION_ALARMENGINE_H_INC
+/*
+    alarmengine.h: evaluates the alarm rules stored in the database against the live telemetry stream.  Each rule keeps
+    a bucketed sliding-window aggregate of its metric, updated incrementally as records arrive on the telemetry bus, so
+    evaluating a rule never touches the database.  Alarms are raised and cleared as rules' conditions change; alarm
+    events are written to the database and published, via the registry's AlarmStore, to the display and web service.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/alarm.h"
+#include "include/framework/error.h"
+#include "include/framework/telemetry.h"
+#include "include/framework/thread.h"
+#include "include/util/windowedaggregate.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+
+class AlarmEngine : public Thread
+{
+public:
+                                AlarmEngine() noexcept;
+                                AlarmEngine(const AlarmEngine& rhs) = delete;
+                                AlarmEngine(AlarmEngine&& rhs) = delete;
+
+    AlarmEngine&                operator=(const AlarmEngine& rhs) = delete;
+    AlarmEngine&                operator=(AlarmEngine&& rhs) = delete;
+
+    bool                        init(Error * const err = nullptr) noexcept;
+    bool                        run() noexcept override;
+
+private:
+    typedef struct RuleState
+    {
+        AlarmRule_t             rule;
+        Util::WindowedAggregate agg;
+        bool                    active;
+        Alarm_t                 alarm;
+    } RuleState_t;
+
+    typedef struct EffectorState
+    {
+        bool                    on;
+        double                  since;      // Time up to which the effector's state has been fed to the duty rules
+    } EffectorState_t;
+
+    bool                        loadRules(Error * const err = nullptr) noexcept;
+    void                        updateTargets() noexcept;
+    void                        observe(const TelemetryRecord_t& record) noexcept;
+    void                        feedDuty(const int channel, const double now) noexcept;
+    void                        evaluate(const double now) noexcept;
+    bool                        value(const RuleState_t& state, const double now, double& val) const noexcept;
+    void                        raise(RuleState_t& state, const double val, const double now) noexcept;
+    void                        clear(RuleState_t& state, const double now) noexcept;
+    void                        publish(const double now) noexcept;
+
+    static bool                 sameDefinition(const AlarmRule_t& lhs, const AlarmRule_t& rhs) noexcept;
+    static bool                 compare(const double val, const AlarmOperator_t op, const double threshold) noexcept;
+
+    std::unique_ptr<TelemetrySubscriber>
+                                subscriber_;
+    std::vector<RuleState_t>    rules_;
+    std::map<int, double>       lastSample_;        // Sensor channel -> time of most recent sample
+    std::map<int, EffectorState_t>
+                                effectors_;         // Effector channel -> state
+    std::map<int, double>       targets_;           // Session id -> target temperature (C), for active sessions
+    std::deque<Alarm_t>         recent_;
+    double                      startTime_;
+    double                      lastReload_;
+    bool                        changed_;
+    int                         pollInterval_;
+    int                         reloadInterval_;
+    size_t                      historyLen_;
+};
+
+#endif // APPLICATION_ALARMENGINE_H_INC
@@ -43,6 +43,7 @@ public:
 private:
     void                    displayDefault() noexcept;
     void                    displayTopMenu() noexcept;
+    void                    displayAlarms(const time_t now) noexcept;
 
     static void             buttonCallback(const ButtonId_t buttonId, const ButtonState_t state, void *arg) noexcept;
     void                    buttonEvent(const ButtonId_t buttonId, const ButtonState_t state) noexcept;
@@ -56,6 +57,7 @@ private:
     time_t                  displayUpdateInterval_;
     time_t                  sessionDwellTime_;
     DisplayMode_t           currentMode_;
+    bool                    alarmShown_;
     static DispHandlerMap_t handlers_;
 };
 
@@ -0,0 +1,92 @@
+#ifndef APPLICATION_PIDCONTROLLER_H_INC
+#define APPLICATION_PIDCONTROLLER_H_INC
+/*
+    pidcontroller.h: PID controller for vessel temperature, and a relay-feedback autotuner which learns the controller's
+    gains.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+
+typedef struct PIDGains
+{
+    double          kp;             // Proportional gain, per degree C
+    double          ki;             // Integral gain, per degree C per second
+    double          kd;             // Derivative gain, seconds per degree C
+} PIDGains_t;
+
+
+typedef enum AutotuneState
+{
+    AUTOTUNE_IDLE = 0,
+    AUTOTUNE_RUNNING,
+    AUTOTUNE_COMPLETE,
+    AUTOTUNE_FAILED
+} AutotuneState_t;
+
+
+class PIDController
+{
+public:
+                    PIDController(const PIDGains_t& gains = {0.0, 0.0, 0.0}) noexcept;
+
+    double          update(const double setpoint, const double measurement, const double dt, double lo = -1.0,
+                           double hi = 1.0) noexcept;
+    void            reset() noexcept;
+
+    const PIDGains_t& gains() const noexcept { return gains_; };
+    void            setGains(const PIDGains_t& gains) noexcept { gains_ = gains; };
+    double          output() const noexcept { return output_; };
+    double          integrator() const noexcept { return integral_; };
+    void            setIntegrator(const double integral) noexcept;
+
+private:
+    PIDGains_t      gains_;
+    double          integral_;          // Integral term, already scaled by ki
+    double          derivative_;        // Filtered rate of change of the measurement, degrees C per second
+    double          lastMeasurement_;
+    bool            hasLastMeasurement_;
+    double          output_;
+};
+
+
+class RelayAutotuner
+{
+public:
+                    RelayAutotuner() noexcept;
+
+    void            start(const double hysteresis, const double maxDuration, const int cycles) noexcept;
+    void            abort() noexcept;
+    double          update(const double setpoint, const double measurement, const double now) noexcept;
+
+    AutotuneState_t state() const noexcept { return state_; };
+    bool            isRunning() const noexcept { return state_ == AUTOTUNE_RUNNING; };
+    const PIDGains_t& gains() const noexcept { return gains_; };
+    double          ultimateGain() const noexcept { return Ku_; };
+    double          ultimatePeriod() const noexcept { return Tu_; };
+
+private:
+    void            cycleComplete(const double now, const double measurement) noexcept;
+
+    static const int MAX_CYCLES = 16;
+
+    AutotuneState_t state_;
+    double          hysteresis_;
+    double          maxDuration_;
+    int             cyclesRequired_;
+    double          startTime_;
+    double          output_;
+    double          lastFallTime_;      // Time at which the relay last switched from heating to cooling
+    double          cycleMax_;
+    double          cycleMin_;
+    int             ncycles_;
+    double          periods_[MAX_CYCLES];
+    double          amplitudes_[MAX_CYCLES];
+    double          Ku_;
+    double          Tu_;
+    PIDGains_t      gains_;
+};
+
+#endif // APPLICATION_PIDCONTROLLER_H_INC
@@ -0,0 +1,62 @@
+#ifndef APPLICATION_POWERSCHEDULER_H_INC
+#define APPLICATION_POWERSCHEDULER_H_INC
+/*
+    powerscheduler.h: brewhouse-wide scheduler for effector switch-on requests.  Keeps the total power drawn by all
+    active effectors within a configured budget, and staggers switch-ons.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/config.h"
+#include "include/peripherals/defaulteffector.h"
+#include <vector>
+
+
+class PowerScheduler
+{
+public:
+                            PowerScheduler() noexcept;
+                            PowerScheduler(const PowerScheduler& rhs) = delete;
+                            PowerScheduler(PowerScheduler&& rhs) = delete;
+
+    PowerScheduler&         operator=(const PowerScheduler& rhs) = delete;
+    PowerScheduler&         operator=(PowerScheduler&& rhs) = delete;
+
+    void                    init(Config& config) noexcept;
+
+    void                    request(DefaultEffector& effector, const int sessionId, const double priority) noexcept;
+    bool                    release(DefaultEffector& effector, Error * const err = nullptr) noexcept;
+    void                    schedule() noexcept;
+
+    bool                    isWaiting(const DefaultEffector& effector) const noexcept;
+    double                  load() const noexcept { return load_; };
+    double                  budget() const noexcept { return budget_; };
+
+private:
+    typedef struct Request
+    {
+        DefaultEffector *   effector;
+        int                 sessionId;
+        double              priority;
+        double              requested;      // Monotonic time at which the request was first made
+        bool                granted;
+    } Request_t;
+
+    bool                    exceedsBudget(const DefaultEffector& effector) const noexcept;
+    std::vector<Request_t>::iterator
+                            find(const DefaultEffector& effector) noexcept;
+    std::vector<Request_t>::const_iterator
+                            find(const DefaultEffector& effector) const noexcept;
+
+    std::vector<Request_t>  requests_;
+    double                  budget_;
+    double                  load_;
+    double                  stagger_;
+    double                  aging_;
+    double                  starvation_;
+    double                  lastSwitchOn_;
+};
+
+#endif // APPLICATION_POWERSCHEDULER_H_INC
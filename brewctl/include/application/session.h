@@ -8,10 +8,13 @@
     Part of brewctl
 */
 
+#include "include/application/pidcontroller.h"
 #include "include/application/temperature.h"
+#include "include/application/thermalmodel.h"
 #include "include/framework/error.h"
 #include "include/peripherals/defaulteffector.h"
 #include "include/peripherals/defaulttempsensor.h"
+#include <cstdint>
 #include <ctime>        // ::time()
 #include <map>
 #include <memory>
@@ -38,6 +41,12 @@ typedef enum SessionTempControlState
     FAST_HEAT
 } SessionTempControlState_t;
 
+typedef enum SessionControlMode
+{
+    CONTROL_BANGBANG = 0,               // On/off control around a dead zone
+    CONTROL_PID                         // PID control with time-proportioned effector output
+} SessionControlMode_t;
+
 typedef enum SessionType
 {
     NONE = 0,
@@ -46,6 +55,21 @@ typedef enum SessionType
     SERVE
 } SessionType_t;
 
+// Control state of a session, as checkpointed for warm restarts
+typedef struct SessionState
+{
+    int32_t                     id;
+    uint8_t                     heater;         // Effector states: 0 = off, 1 = on
+    uint8_t                     cooler;
+    uint8_t                     reserved[2];
+    double                      integrator;     // PID integral term
+    double                      controlOutput;
+    double                      windowDuty;     // Duty cycle latched for the current time-proportioning window
+    double                      windowElapsed;  // Seconds since the start of the current window; <0 if none
+    TempSensorState_t           sensor;
+    ThermalModelState_t         model;
+} SessionState_t;
+
 
 class Session
 {
@@ -53,7 +77,8 @@ public:
                                 Session(const session_id_t id, Error * const err = nullptr) noexcept;
     virtual                     ~Session() = default;
 
-    Temperature                 targetTemp() noexcept;
+    session_id_t                id() const noexcept { return id_; };
+    Temperature                 targetTemp() const noexcept;
     Temperature                 currentTemp() noexcept;
     bool                        vesselTempSensorInRange() const noexcept;
     bool                        isNotStartedYet() const noexcept;
@@ -67,10 +92,41 @@ public:
     SessionTempControlState_t   tempControlState() const noexcept { return tempControlState_; };
     SessionType_t               type() const noexcept { return type_; };
     bool                        markComplete(Error * const err) noexcept;
+    bool                        setTargetOverride(const Temperature& target, Error * const err = nullptr) noexcept;
+    bool                        clearTargetOverride(Error * const err = nullptr) noexcept;
+    bool                        hasTargetOverride() const noexcept { return targetOverridden_; };
+    bool                        hold(Error * const err = nullptr) noexcept;
+    bool                        release(Error * const err = nullptr) noexcept;
+    bool                        isHeld() const noexcept { return holdStart_ != 0; };
+    bool                        skipStage(Error * const err = nullptr) noexcept;
+    bool                        startAutotune(Error * const err = nullptr) noexcept;
+    bool                        isAutotuning() const noexcept { return autotuner_.isRunning(); };
+    SessionControlMode_t        controlMode() const noexcept { return controlMode_; };
+    double                      controlOutput() const noexcept { return controlOutput_; };
+    void                        setAmbientTemp(const Temperature& ambient) noexcept { ambientTemp_ = ambient; };
+    const ThermalModel&         model() const noexcept { return model_; };
+    double                      timeToTarget() const noexcept;
+    bool                        heaterState() const noexcept { return effectorHeater_->state(); };
+    bool                        coolerState() const noexcept { return effectorCooler_->state(); };
+    bool                        isWaitingForPower() const noexcept;
+    Temperature                 lastTemp() const noexcept { return lastTemp_; };
+    void                        saveState(SessionState_t& state) noexcept;
+    bool                        restoreState(const SessionState_t& state, const double age) noexcept;
 
 private:
     bool                        updateEffectors(Error * const err = nullptr) noexcept;
+    bool                        updateEffectorsPID(Error * const err = nullptr) noexcept;
+    bool                        setEffectors(const bool heat, const bool cool) noexcept;
+    bool                        switchOn(DefaultEffector& effector) noexcept;
+    bool                        switchOff(DefaultEffector& effector) noexcept;
+    bool                        coastsToTarget(const Temperature& t, const Temperature& target, const bool heating)
+                                    const noexcept;
+    bool                        loadGains(Error * const err) noexcept;
+    bool                        saveGains(const PIDGains_t& gains, Error * const err = nullptr) noexcept;
     bool                        deactivateEffectors() noexcept;
+    time_t                      profileTime() const noexcept;
+    bool                        saveProgress(const time_t startTs, const time_t holdStart,
+                                             const Temperature * const targetOverride, Error * const err) noexcept;
 
     const session_id_t          id_;
     int                         gyle_id_;
@@ -82,12 +138,29 @@ private:
     time_t                      effectorUpdateInterval_;
     time_t                      lastEffectorUpdate_;
     SessionStages_t             stages_;
+    Temperature                 lastTemp_;
     DefaultTempSensor_uptr_t    tempSensorVessel_;
     DefaultEffector_uptr_t      effectorHeater_;
     DefaultEffector_uptr_t      effectorCooler_;
     SessionTempControlState_t   tempControlState_;
     SessionType_t               type_;
     bool                        complete_;
+    bool                        targetOverridden_;
+    Temperature                 targetOverride_;
+    time_t                      holdStart_;
+    SessionControlMode_t        controlMode_;
+    PIDController               pid_;
+    RelayAutotuner              autotuner_;
+    double                      pidInterval_;
+    double                      lastPidUpdate_;
+    double                      pwmWindow_;
+    double                      pwmMinOn_;
+    double                      windowStart_;
+    double                      windowDuty_;
+    double                      controlOutput_;
+    Temperature                 ambientTemp_;
+    ThermalModel                model_;
+    double                      modelHorizon_;
 };
 
 #endif // APPLICATION_SESSION_H_INC
@@ -0,0 +1,65 @@
+#ifndef APPLICATION_SESSIONCOMMAND_H_INC
+#define APPLICATION_SESSIONCOMMAND_H_INC
+/*
+    sessioncommand.h: commands sent to the session manager from other threads (e.g. the web service, the button
+    manager).  Commands are queued, lock-free, and executed by the session manager at the start of its next tick; each
+    caller receives a future which becomes ready once its command has been executed.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/session.h"
+#include "include/framework/error.h"
+#include "include/util/mpscqueue.h"
+#include <future>
+#include <string_view>
+
+
+typedef enum SessionCommandType
+{
+    SESSION_CMD_NONE = 0,
+    SESSION_CMD_SET_TARGET,                 // Override the session's target temperature with <value> (deg C)
+    SESSION_CMD_CLEAR_TARGET,               // Remove any target-temperature override
+    SESSION_CMD_HOLD,                       // Freeze progress through the session's profile
+    SESSION_CMD_RELEASE,                    // Resume progress through the session's profile
+    SESSION_CMD_SKIP_STAGE,                 // End the current profile stage immediately
+    SESSION_CMD_MARK_COMPLETE,              // Mark the session as complete
+    SESSION_CMD_AUTOTUNE                    // Learn PID gains for the session's vessel
+} SessionCommandType_t;
+
+
+typedef struct SessionCommand
+{
+    SessionCommandType_t    type;
+    session_id_t            sessionId;
+    double                  value;
+    std::promise<Error>     result;
+} SessionCommand_t;
+
+
+class SessionCommandQueue
+{
+public:
+                            SessionCommandQueue() noexcept;
+                            SessionCommandQueue(const SessionCommandQueue& rhs) = delete;
+                            SessionCommandQueue(SessionCommandQueue&& rhs) = delete;
+
+    SessionCommandQueue&    operator=(const SessionCommandQueue& rhs) = delete;
+    SessionCommandQueue&    operator=(SessionCommandQueue&& rhs) = delete;
+
+    std::future<Error>      submit(const SessionCommandType_t type, const session_id_t sessionId,
+                                   const double value = 0.0) noexcept;
+    bool                    pop(SessionCommand_t& cmd) noexcept { return queue_.pop(cmd); };
+
+    static const char *     name(const SessionCommandType_t type) noexcept;
+    static SessionCommandType_t
+                            fromName(const std::string_view name) noexcept;
+
+private:
+    Util::MPSCQueue<SessionCommand_t>
+                            queue_;
+};
+
+#endif // APPLICATION_SESSIONCOMMAND_H_INC
@@ -10,10 +10,14 @@
 
 #include "include/application/session.h"
 #include "include/application/display.h"
+#include "include/application/sessioncommand.h"
+#include "include/application/sessionsnapshot.h"
+#include "include/application/statefile.h"
 #include "include/framework/error.h"
 #include "include/framework/registry.h"
 #include "include/framework/thread.h"
 #include "include/peripherals/defaulttempsensor.h"
+#include <chrono>
 #include <memory>
 #include <map>
 
@@ -33,16 +37,37 @@ public:
 
     Temperature                 ambientTemp() noexcept;
     const SessionMap_t&         sessions() noexcept;
+    SessionSnapshotSet_sptr_t   snapshot() const noexcept;
 
     bool                        init(Error * const err = nullptr) noexcept;
     bool                        run() noexcept override;
+    void                        handOff() noexcept;
+    const StateData_t&          handoffState() const noexcept { return handoffState_; };
 
 private:
     bool                        updateSessionList(Error * const err = nullptr) noexcept;
+    void                        publishSnapshot() noexcept;
+    void                        processCommands() noexcept;
+    bool                        executeCommand(const SessionCommand_t& cmd, Error * const err) noexcept;
+    void                        rejectCommands() noexcept;
+    void                        captureState(StateData_t& data) noexcept;
+    void                        checkpoint() noexcept;
+    void                        restore(const StateData_t& data) noexcept;
 
     SessionMap_t                sessions_;
     DefaultTempSensor_uptr_t    tempSensorAmbient_;
+    Temperature                 lastAmbientTemp_;
     Display *                   display_;
+    std::chrono::milliseconds   snapshotInterval_;
+    std::chrono::steady_clock::time_point
+                                lastSnapshot_;
+    StateFile                   stateFile_;
+    std::chrono::seconds        checkpointInterval_;
+    std::chrono::steady_clock::time_point
+                                lastCheckpoint_;
+    int                         maxCheckpointAge_;
+    volatile bool               handoff_;
+    StateData_t                 handoffState_;
 };
 
 #endif // APPLICATION_SESSIONMANAGER_H_INC
@@ -0,0 +1,85 @@
+#ifndef APPLICATION_SESSIONSNAPSHOT_H_INC
+#define APPLICATION_SESSIONSNAPSHOT_H_INC
+/*
+    sessionsnapshot.h: immutable, versioned snapshots of session state.  Snapshots are published by the session manager
+    and consumed by readers (the display, the web service) which must not touch the hardware.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/session.h"
+#include "include/application/temperature.h"
+#include "include/util/rcuptr.h"
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+typedef struct SessionSnapshot
+{
+    session_id_t                id;
+    int                         gyleId;
+    std::string                 gyleName;
+    SessionType_t               type;
+    bool                        active;
+    bool                        complete;
+    Temperature                 targetTemp;
+    bool                        targetOverridden;
+    bool                        held;
+    Temperature                 currentTemp;
+    bool                        sensorInRange;
+    SessionTempControlState_t   tempControlState;
+    time_t                      remainingTime;
+    double                      controlOutput;
+    bool                        autotuning;
+    double                      timeToTarget;           // Forecast time to reach target, in seconds; -1 if unknown
+    bool                        modelValid;
+    uint32_t                    modelSamples;
+    double                      modelTimeConstant;      // Thermal time constant, in seconds
+    double                      modelHeatRate;          // Heating rate at full power, in deg C per hour
+    double                      modelCoolRate;          // Cooling rate at full power, in deg C per hour
+    double                      modelCoupling;          // Coupling to ambient temperature, per hour
+    bool                        heaterState;
+    bool                        coolerState;
+    bool                        powerWaiting;           // An effector is waiting for the power scheduler
+} SessionSnapshot_t;
+
+typedef struct SessionSnapshotSet
+{
+    uint64_t                        version;
+    time_t                          timestamp;
+    Temperature                     ambientTemp;
+    double                          powerLoad;          // Power drawn by active effectors, in watts
+    double                          powerBudget;        // Brewhouse power budget, in watts; 0 = unlimited
+    std::vector<SessionSnapshot_t>  sessions;
+} SessionSnapshotSet_t;
+
+typedef Util::RCUPtr<SessionSnapshotSet_t>::sptr_t SessionSnapshotSet_sptr_t;
+
+
+class SessionSnapshotStore
+{
+public:
+                                SessionSnapshotStore() noexcept;
+                                SessionSnapshotStore(const SessionSnapshotStore& rhs) = delete;
+                                SessionSnapshotStore(SessionSnapshotStore&& rhs) = delete;
+
+    SessionSnapshotStore&       operator=(const SessionSnapshotStore& rhs) = delete;
+    SessionSnapshotStore&       operator=(SessionSnapshotStore&& rhs) = delete;
+
+    void                        publish(SessionSnapshotSet_t * const snapshot) noexcept;
+    SessionSnapshotSet_sptr_t   current() const noexcept;
+    uint64_t                    version() const noexcept { return version_; };
+
+private:
+    Util::RCUPtr<SessionSnapshotSet_t>
+                                current_;
+    std::atomic<uint64_t>       version_;
+};
+
+#endif // APPLICATION_SESSIONSNAPSHOT_H_INC
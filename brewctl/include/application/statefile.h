@@ -0,0 +1,80 @@
+#ifndef APPLICATION_STATEFILE_H_INC
+#define APPLICATION_STATEFILE_H_INC
+/*
+    statefile.h: memory-mapped checkpoint of the control state (sensor filters, PID integrators, thermal models,
+    effector states), from which the session manager restores itself after a restart.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/session.h"
+#include "include/framework/error.h"
+#include "include/peripherals/defaulttempsensor.h"
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+
+static const uint32_t
+    STATE_MAX_SESSIONS  = 16;                   // Max number of sessions recorded in a checkpoint
+
+
+typedef struct StateData
+{
+    int64_t                 timestamp;          // Wall-clock time of the checkpoint, in seconds since the epoch
+    TempSensorState_t       ambient;
+    uint32_t                nsessions;
+    uint32_t                reserved;
+    SessionState_t          sessions[STATE_MAX_SESSIONS];
+} StateData_t;
+
+static_assert(std::is_trivially_copyable<StateData_t>::value, "StateData_t must be trivially copyable");
+
+
+class StateFile
+{
+public:
+                            StateFile() noexcept;
+                            StateFile(const StateFile& rhs) = delete;
+                            StateFile(StateFile&& rhs) = delete;
+                            ~StateFile() noexcept;
+
+    StateFile&              operator=(const StateFile& rhs) = delete;
+    StateFile&              operator=(StateFile&& rhs) = delete;
+
+    bool                    open(const std::string& path, Error * const err = nullptr) noexcept;
+    void                    close() noexcept;
+    bool                    isOpen() const noexcept { return map_ != nullptr; };
+
+    bool                    save(const StateData_t& data) noexcept;
+    bool                    load(StateData_t& data) const noexcept;
+
+private:
+    // The file holds two slots, written alternately.  A checkpoint interrupted part-way through (e.g. by a power
+    // failure) leaves a slot whose checksum does not match, and the other slot - the previous checkpoint - is used.
+    typedef struct Slot
+    {
+        uint32_t            magic;
+        uint32_t            version;
+        uint64_t            generation;         // Incremented on each save; the valid slot with the highest wins
+        uint32_t            checksum;           // FNV-1a hash of <generation> and <data>
+        uint32_t            reserved;
+        StateData_t         data;
+    } Slot_t;
+
+    typedef struct Layout
+    {
+        Slot_t              slots[2];
+    } Layout_t;
+
+    static uint32_t         checksum(const Slot_t& slot) noexcept;
+    bool                    isValid(const Slot_t& slot) const noexcept;
+
+    int                     fd_;
+    Layout_t *              map_;
+    uint64_t                generation_;
+};
+
+#endif // APPLICATION_STATEFILE_H_INC
@@ -0,0 +1,44 @@
+#ifndef APPLICATION_TELEMETRYLOGGER_H_INC
+#define APPLICATION_TELEMETRYLOGGER_H_INC
+/*
+    telemetrylogger.h: subscribes to the telemetry bus, and writes persistent records (temperature samples, effector
+    transitions) to the database.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/error.h"
+#include "include/framework/telemetry.h"
+#include "include/framework/thread.h"
+#include "include/sqlite/sqlite.h"
+#include <cstdint>
+#include <memory>
+
+
+class TelemetryLogger : public Thread
+{
+public:
+                                TelemetryLogger() noexcept;
+                                TelemetryLogger(const TelemetryLogger& rhs) = delete;
+                                TelemetryLogger(TelemetryLogger&& rhs) = delete;
+
+    TelemetryLogger&            operator=(const TelemetryLogger& rhs) = delete;
+    TelemetryLogger&            operator=(TelemetryLogger&& rhs) = delete;
+
+    bool                        init(Error * const err = nullptr) noexcept;
+    bool                        run() noexcept override;
+
+private:
+    int                         drain() noexcept;
+    bool                        write(const TelemetryRecord_t& record) noexcept;
+
+    SQLite                      db_;
+    std::unique_ptr<TelemetrySubscriber>
+                                subscriber_;
+    int                         pollInterval_;
+    uint64_t                    lastDropped_;
+};
+
+#endif // APPLICATION_TELEMETRYLOGGER_H_INC
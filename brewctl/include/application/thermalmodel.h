@@ -0,0 +1,69 @@
+#ifndef APPLICATION_THERMALMODEL_H_INC
+#define APPLICATION_THERMALMODEL_H_INC
+/*
+    thermalmodel.h: online identification of a vessel's thermal behaviour.  Models the vessel as a first-order plant,
+
+        dT/dt = a * (Tamb - T) + bh * uh + bc * uc
+
+    where uh and uc are the heater and cooler duty cycles (0..1), and estimates the parameters [a, bh, bc] by recursive
+    least squares with exponential forgetting.  Rates are expressed per hour, to keep the estimator well-conditioned.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <cstdint>
+
+
+typedef struct ThermalModelState
+{
+    double          theta[3];           // Parameter estimates [a (1/h), bh (C/h), bc (C/h)]
+    double          P[3][3];            // Estimate covariance
+    uint32_t        nsamples;           // Number of updates applied
+} ThermalModelState_t;
+
+
+class ThermalModel
+{
+public:
+                    ThermalModel(const double forgetting = 0.999, const double sampleInterval = 60.0) noexcept;
+
+    void            reset() noexcept;
+    void            observe(const double now, const double tempC, const double ambientC, const bool heating,
+                            const bool cooling) noexcept;
+
+    bool            isValid() const noexcept;
+    double          coupling() const noexcept { return state_.theta[0]; };
+    double          heatRate() const noexcept { return state_.theta[1]; };
+    double          coolRate() const noexcept { return state_.theta[2]; };
+    double          timeConstant() const noexcept;
+    uint32_t        samples() const noexcept { return state_.nsamples; };
+
+    double          predict(const double tempC, const double ambientC, const double uh, const double uc,
+                            const double horizon) const noexcept;
+    double          dutyFor(const double tempC, const double ambientC, const double targetC, const double horizon,
+                            const bool heating) const noexcept;
+    double          timeTo(const double tempC, const double ambientC, const double targetC) const noexcept;
+
+    const ThermalModelState_t& state() const noexcept { return state_; };
+    void            setState(const ThermalModelState_t& state) noexcept { state_ = state; };
+
+private:
+    void            update(const double phi[3], const double y) noexcept;
+
+    ThermalModelState_t state_;
+    double          forgetting_;
+    double          sampleInterval_;
+
+    // Accumulators for the current sample interval
+    double          intervalStart_;
+    double          lastObserved_;
+    double          startTemp_;
+    double          heatingTime_;
+    double          coolingTime_;
+    double          tempIntegral_;
+    double          ambientIntegral_;
+};
+
+#endif // APPLICATION_THERMALMODEL_H_INC
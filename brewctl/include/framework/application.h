@@ -8,15 +8,19 @@
     Part of brewctl
 */
 
+#include "include/application/alarmengine.h"
 #include "include/application/sessionmanager.h"
+#include "include/application/telemetrylogger.h"
 #include "include/framework/config.h"
 #include "include/framework/error.h"
+#include "include/framework/handoff.h"
 #include "include/peripherals/buttonmanager.h"
 #include "include/service/avahiservice.h"
 #include "include/service/httpservice.h"
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 
 class Application
@@ -50,17 +54,26 @@ private:
     bool                        sendSignal(const int signum, Error * const err = nullptr) noexcept;
     bool                        sendQuitSignal(Error * const err = nullptr) noexcept;
     bool                        isRunning(Error * const err = nullptr) noexcept;
-    bool                        installQuitHandler(Error * const err) noexcept;
+    bool                        printStatus(Error * const err = nullptr) noexcept;
+    bool                        installSignalHandlers(Error * const err) noexcept;
     void                        signalHandler(int signum) noexcept;
+    bool                        execUpgrade(const int httpFd, Error * const err) noexcept;
     uint64_t                    getSystemId() noexcept;
 
     Config                      config_;
     std::string                 appName_;
+    std::string                 exePath_;
+    std::vector<std::string>    args_;
+    std::unique_ptr<HandoffData_t>
+                                handoff_;
     AvahiService *              avahiService_;
     SessionManager              sessionManager_;
+    TelemetryLogger             telemetryLogger_;
+    AlarmEngine                 alarmEngine_;
     HttpService *               httpService_;
     uint64_t                    systemId_;
     volatile bool               stop_;
+    volatile bool               upgrade_;
 };
 
 #endif // FRAMEWORK_APPLICATION_H_INC
@@ -32,6 +32,13 @@ typedef enum
     CORRUPT_PIDFILE                 = 0x0010,
     CONFIG_KEY_MISSING              = 0x0011,
     SWITCH_USER_INSUFFICIENT_PRIV   = 0x0012,
+    SESSION_NOT_ACTIVE              = 0x0013,
+    SESSION_FINAL_STAGE             = 0x0014,
+    INVALID_SESSION_COMMAND         = 0x0015,
+    SESSION_MANAGER_STOPPING        = 0x0016,
+    INVALID_HANDOFF                 = 0x0017,
+    SOCKET_PATH_TOO_LONG            = 0x0018,
+    NO_SUCH_GROUP                   = 0x0019,
     DB_OPEN_FAILED                  = 0x1100,
     DB_TOO_FEW_COLUMNS              = 0x1101,
     DB_SQLITE_ERROR                 = 0x1102,
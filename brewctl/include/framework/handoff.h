@@ -0,0 +1,43 @@
+#ifndef FRAMEWORK_HANDOFF_H_INC
+#define FRAMEWORK_HANDOFF_H_INC
+/*
+    handoff.h: state passed from a running instance of the application to its replacement during a binary upgrade.  The
+    old instance writes the state into a POSIX shared-memory segment and execs the new binary, naming the segment on
+    the command line; the new instance reads the segment, removes it, and resumes control without touching the outputs.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/application/statefile.h"
+#include "include/framework/error.h"
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+
+typedef struct HandoffData
+{
+    uint32_t                magic;
+    uint32_t                version;
+    int32_t                 httpFd;             // Listening socket of the HTTP service, or -1
+    int32_t                 spiFd;              // Open SPI device
+    uint16_t                srValue;            // Value currently latched in the shift register
+    uint16_t                reserved[3];
+    StateData_t             state;              // Control state of the sessions and the ambient sensor
+} HandoffData_t;
+
+static_assert(std::is_trivially_copyable<HandoffData_t>::value, "HandoffData_t must be trivially copyable");
+
+
+namespace Handoff
+{
+    std::string             segmentName() noexcept;
+
+    bool                    write(const std::string& name, HandoffData_t& data, Error * const err = nullptr) noexcept;
+    bool                    read(const std::string& name, HandoffData_t& data, Error * const err = nullptr) noexcept;
+    void                    remove(const std::string& name) noexcept;
+} // namespace Handoff
+
+#endif // FRAMEWORK_HANDOFF_H_INC
@@ -8,8 +8,14 @@
     Part of brewctl
 */
 
+#include "include/application/alarm.h"
+#include "include/application/powerscheduler.h"
+#include "include/application/sessioncommand.h"
+#include "include/application/sessionsnapshot.h"
 #include "include/framework/config.h"
 #include "include/framework/error.h"
+#include "include/framework/handoff.h"
+#include "include/framework/telemetry.h"
 #include "include/peripherals/adc.h"
 #include "include/peripherals/buttonmanager.h"
 #include "include/peripherals/gpioport.h"
@@ -22,7 +28,7 @@
 class Registry
 {
 public:
-    static bool         init(Config& config, Error * const err) noexcept;
+    static bool         init(Config& config, Error * const err, const HandoffData_t *handoff = nullptr) noexcept;
 
     static Registry&    instance()      noexcept { return *instance_; };
 
@@ -34,12 +40,19 @@ public:
     SPIPort&            spi()           noexcept { return spi_;             };
     ShiftReg&           sr()            noexcept { return sr_;              };
     ButtonManager&      buttonManager() noexcept { return *buttonManager_;  };
+    SessionSnapshotStore& snapshots()   noexcept { return snapshots_;       };
+    TelemetryBus&       telemetry()     noexcept { return telemetry_;       };
+    SessionCommandQueue& sessionCommands() noexcept { return sessionCommands_; };
+    PowerScheduler&     powerScheduler() noexcept { return powerScheduler_; };
+    AlarmStore&         alarms()        noexcept { return alarms_;          };
+    const HandoffData_t *handoff() const noexcept { return handoff_;     };
 
 private:
-                        Registry(Config& config, Error * const err) noexcept;
+                        Registry(Config& config, Error * const err, const HandoffData_t *handoff) noexcept;
 
     static Registry *   instance_;
 
+    const HandoffData_t *handoff_;
     SQLite              db_;
     Config&             config_;
     GPIOPort&           gpio_;
@@ -48,6 +61,11 @@ private:
     ADC                 adc_;
     LCD                 lcd_;
     ButtonManager *     buttonManager_;
+    SessionSnapshotStore snapshots_;
+    TelemetryBus        telemetry_;
+    SessionCommandQueue sessionCommands_;
+    PowerScheduler      powerScheduler_;
+    AlarmStore          alarms_;
 };
 
 #endif // FRAMEWORK_REGISTRY_H_INC
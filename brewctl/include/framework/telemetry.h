@@ -0,0 +1,132 @@
+#ifndef FRAMEWORK_TELEMETRY_H_INC
+#define FRAMEWORK_TELEMETRY_H_INC
+/*
+    telemetry.h: in-process telemetry bus.  Producers (sensors, effectors, sessions) publish fixed-size records into a
+    shared lock-free ring; any number of subscribers consume the records, each from its own cursor and at its own pace.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+
+typedef enum TelemetryRecordType
+{
+    TELEMETRY_NONE = 0,
+    TELEMETRY_SENSOR_SAMPLE,                // A temperature-sensor reading
+    TELEMETRY_EFFECTOR_TRANSITION,          // An effector switching on or off
+    TELEMETRY_CONTROL_STATE                 // A change in a session's temperature-control state
+} TelemetryRecordType_t;
+
+
+// Record flags
+static const uint8_t
+    TELEMETRY_FLAG_PERSIST  = 0x01;         // The record should be written to the database by the telemetry logger
+
+
+typedef struct TelemetryRecord
+{
+    uint8_t                 type;           // One of the TelemetryRecordType_t values
+    uint8_t                 flags;          // Combination of TELEMETRY_FLAG_* values
+    int16_t                 channel;        // Sensor or effector channel; -1 if not applicable
+    int32_t                 sessionId;      // Session id; 0 if not applicable
+    int64_t                 timestamp;      // Wall-clock time at which the record was produced, in ms since the epoch
+    union
+    {
+        struct
+        {
+            double          tempC;          // Filtered temperature, in degrees Celsius
+            double          reserved[2];
+        } sensor;
+
+        struct
+        {
+            int32_t         state;          // New effector state: 0 = off, 1 = on
+            int32_t         reserved;
+            double          powerW;         // Effector power consumption in watts
+            double          reserved2;
+        } effector;
+
+        struct
+        {
+            int32_t         state;          // New SessionTempControlState_t value
+            int32_t         reserved;
+            double          targetC;        // Target temperature, in degrees Celsius
+            double          currentC;       // Current temperature, in degrees Celsius
+        } control;
+    };
+} TelemetryRecord_t;
+
+static_assert(std::is_trivially_copyable<TelemetryRecord_t>::value, "TelemetryRecord_t must be trivially copyable");
+static_assert((sizeof(TelemetryRecord_t) % sizeof(uint64_t)) == 0, "TelemetryRecord_t must be a whole number of words");
+
+
+class TelemetryBus
+{
+friend class TelemetrySubscriber;
+
+public:
+                                TelemetryBus(const size_t capacity) noexcept;
+                                TelemetryBus(const TelemetryBus& rhs) = delete;
+                                TelemetryBus(TelemetryBus&& rhs) = delete;
+
+    TelemetryBus&               operator=(const TelemetryBus& rhs) = delete;
+    TelemetryBus&               operator=(TelemetryBus&& rhs) = delete;
+
+    bool                        publish(TelemetryRecord_t& record) noexcept;
+    bool                        publishSensorSample(const int channel, const int sessionId, const double tempC,
+                                                    const bool persist) noexcept;
+    bool                        publishEffectorTransition(const int channel, const bool state, const double powerW)
+                                    noexcept;
+    bool                        publishControlState(const int sessionId, const int state, const double targetC,
+                                                    const double currentC) noexcept;
+
+    size_t                      capacity() const noexcept { return capacity_; };
+    uint64_t                    head() const noexcept { return head_.load(std::memory_order_acquire); };
+    uint64_t                    dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); };
+
+    static int64_t              now() noexcept;
+
+private:
+    static const size_t         WORDS_PER_RECORD = sizeof(TelemetryRecord_t) / sizeof(uint64_t);
+
+    // A slot's sequence number is 2 * (pos + 1) once the record at position <pos> is complete, and odd while a record
+    // is being written into the slot.  Record data is held as atomic words so that readers racing with a writer see
+    // torn - but well-defined - data, which they then discard.
+    typedef struct Slot
+    {
+        std::atomic<uint64_t>   seq;
+        std::atomic<uint64_t>   data[WORDS_PER_RECORD];
+    } Slot_t;
+
+    size_t                      capacity_;
+    size_t                      mask_;
+    std::unique_ptr<Slot_t[]>   slots_;
+    std::atomic<uint64_t>       head_;
+    std::atomic<uint64_t>       dropped_;
+};
+
+
+class TelemetrySubscriber
+{
+public:
+                                TelemetrySubscriber(TelemetryBus& bus) noexcept;
+
+    bool                        next(TelemetryRecord_t& record) noexcept;
+    void                        seek(const uint64_t pos) noexcept;
+    uint64_t                    dropped() const noexcept { return dropped_; };
+    uint64_t                    cursor() const noexcept { return cursor_; };
+
+private:
+    TelemetryBus&               bus_;
+    uint64_t                    cursor_;
+    uint64_t                    dropped_;
+};
+
+#endif // FRAMEWORK_TELEMETRY_H_INC
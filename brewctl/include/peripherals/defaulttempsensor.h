@@ -13,10 +13,21 @@
 #include "include/application/temperature.h"
 #include "include/framework/error.h"
 #include "include/framework/log.h"
+#include <cstdint>
 #include <memory>
 #include <string>
 
 
+// Filter state of a temperature sensor, as checkpointed for warm restarts
+typedef struct TempSensorState
+{
+    int32_t                     channel;
+    int32_t                     nsamples;       // Number of samples contributing to the moving average
+    double                      tempC;          // Moving-average temperature, in degrees Celsius
+    double                      rate;           // Filtered rate of change of temperature, in degrees C/s
+} TempSensorState_t;
+
+
 class DefaultTempSensor
 {
 public:
@@ -32,6 +43,9 @@ public:
 
     virtual Temperature         sense(Error * const err = nullptr) noexcept;
     virtual bool                inRange() noexcept { return false; };
+    virtual void                setSetpoint(const Temperature& setpoint) noexcept { (void) setpoint; };
+    virtual bool                getState(TempSensorState_t& state) noexcept { (void) state; return false; };
+    virtual bool                setState(const TempSensorState_t& state) noexcept { (void) state; return false; };
     virtual std::string         name() const noexcept { return name_; };
     int                         channel() const noexcept { return channel_; };
 
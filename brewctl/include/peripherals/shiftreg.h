@@ -21,6 +21,7 @@ public:
                             ShiftReg(GPIOPort& gpio, Error * const err = nullptr) noexcept;
 
     bool                    init(Error * const err = nullptr) noexcept;
+    void                    adopt(const uint16_t val) noexcept;
     bool                    write(uint16_t val, Error * const err = nullptr) noexcept;
     uint16_t                read() const noexcept { return currentVal_; };
 
@@ -26,7 +26,8 @@ extern "C"
 class SPIPort
 {
 public:
-                            SPIPort(GPIOPort& gpio, Config& config, Error * const err = nullptr) noexcept;
+                            SPIPort(GPIOPort& gpio, Config& config, Error * const err = nullptr,
+                                    const int inheritedFd = -1) noexcept;
     virtual                 ~SPIPort() noexcept;
 
     bool                    setMode(const uint8_t mode, Error * const err = nullptr) noexcept;
@@ -39,6 +40,7 @@ public:
                                                Error * const err = nullptr) noexcept;
 
     bool                    ready() const noexcept { return ready_; };
+    int                     fd() const noexcept { return fd_; };
 
 protected:
     bool                    doIoctl(const unsigned long type, void *val, Error * const err = nullptr) noexcept;
@@ -13,6 +13,7 @@
 #include "include/framework/error.h"
 #include "include/peripherals/defaulttempsensor.h"
 #include "include/peripherals/thermistor.h"
+#include <cstdint>
 #include <ctime>
 #include <memory>
 #include <mutex>
@@ -22,8 +23,8 @@
 class TempSensor : public DefaultTempSensor
 {
 public:
-                                    TempSensor(const int thermistor_id, const int channel, Error * const err = nullptr)
-                                        noexcept;
+                                    TempSensor(const int thermistor_id, const int channel, const int sessionId = 0,
+                                               Error * const err = nullptr) noexcept;
     virtual                         ~TempSensor() noexcept;
 
                                     TempSensor(const TempSensor& rhs) = delete;
@@ -34,6 +35,11 @@ public:
 
     virtual Temperature             sense(Error * const err = nullptr) noexcept override;
     virtual bool                    inRange() noexcept override;
+    virtual void                    setSetpoint(const Temperature& setpoint) noexcept override;
+    virtual bool                    getState(TempSensorState_t& state) noexcept override;
+    virtual bool                    setState(const TempSensorState_t& state) noexcept override;
+    double                          sampleInterval() const noexcept { return sampleInterval_; };
+    double                          rate() const noexcept { return rate_; };
 
     static DefaultTempSensor_uptr_t getSessionVesselTempSensor(const int sessionId, Error * const err = nullptr)
                                         noexcept;
@@ -44,9 +50,11 @@ protected:
                                                   Error * const err = nullptr) noexcept;
     double                          readRaw(Error * const err = nullptr) noexcept;
     void                            move(TempSensor& rhs) noexcept;
-    void                            writeTempLog();
+    void                            publishSample() noexcept;
+    void                            adaptSampleInterval() noexcept;
 
     Thermistor *                    thermistor_;
+    int                             sessionId_;
     int                             avglen_;
     int                             nsamples_;
     double                          Idrive_;
@@ -55,6 +63,16 @@ protected:
     Temperature                     rangeMax_;
     time_t                          lastLogWriteTime_;
     int                             logInterval_;
+    int64_t                         lastPublishTime_;
+    int                             publishInterval_;
+    Temperature                     setpoint_;
+    double                          rate_;                  // Filtered rate of change of temperature, in deg C/s
+    double                          lastSampleTime_;        // Monotonic time of the last ADC read
+    double                          sampleInterval_;        // Current interval between ADC reads, in seconds
+    double                          minSampleInterval_;
+    double                          maxSampleInterval_;
+    double                          resolution_;            // Temperature change worth resolving, in deg C
+    int                             minLogInterval_;
     std::mutex                      lock_;
 };
 
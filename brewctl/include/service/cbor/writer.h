@@ -0,0 +1,50 @@
+#ifndef INCLUDE_SERVICE_CBOR_WRITER_H_INC
+#define INCLUDE_SERVICE_CBOR_WRITER_H_INC
+/*
+    writer.h: streaming CBOR (RFC 7049) writer.  Objects and arrays are written as indefinite-length maps and arrays, so
+    nothing already written is revisited, and the output buffer may be drained between calls.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/serializer.h"
+#include <cstdint>
+#include <string>
+
+
+class CborWriter : public Serializer
+{
+public:
+                            CborWriter(std::string& out) noexcept : Serializer(out) {};
+                            CborWriter(const CborWriter& rhs) = delete;
+                            CborWriter(CborWriter&& rhs) = delete;
+
+    CborWriter&             operator=(const CborWriter& rhs) = delete;
+    CborWriter&             operator=(CborWriter&& rhs) = delete;
+
+    using Serializer::beginObject;
+    using Serializer::beginArray;
+    using Serializer::value;
+
+    Serializer&             beginObject() noexcept override;
+    Serializer&             endObject() noexcept override;
+    Serializer&             beginArray() noexcept override;
+    Serializer&             endArray() noexcept override;
+
+    Serializer&             key(const SerialKey& key) noexcept override;
+
+    Serializer&             value(const bool val) noexcept override;
+    Serializer&             value(const long long val) noexcept override;
+    Serializer&             value(const unsigned long long val) noexcept override;
+    Serializer&             value(const double val) noexcept override;
+    Serializer&             value(const char *str, const size_t len) noexcept override;
+    Serializer&             null() noexcept override;
+    Serializer&             encodedValue(const char *data, const size_t len) noexcept override;
+
+private:
+    void                    head(const uint8_t major, const uint64_t val) noexcept;
+};
+
+#endif // INCLUDE_SERVICE_CBOR_WRITER_H_INC
@@ -0,0 +1,74 @@
+#ifndef SERVICE_COMPRESSOR_H_INC
+#define SERVICE_COMPRESSOR_H_INC
+/*
+    compressor.h: HTTP content-coding (gzip, deflate) of response bodies, using zlib.  A Compressor encodes a body
+    incrementally, flushing after each block so that a streamed response can be decoded as it arrives.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/responsestream.h"
+#include <cstddef>
+#include <string>
+
+extern "C"
+{
+#include <zlib.h>
+}
+
+
+typedef enum ContentEncoding
+{
+    ENCODING_IDENTITY = 0,
+    ENCODING_GZIP,
+    ENCODING_DEFLATE,
+    NUM_ENCODINGS
+} ContentEncoding_t;
+
+
+class Compressor
+{
+public:
+                            Compressor(const ContentEncoding_t encoding) noexcept;
+                            Compressor(const Compressor& rhs) = delete;
+                            Compressor(Compressor&& rhs) = delete;
+    virtual                 ~Compressor() noexcept;
+
+    Compressor&             operator=(const Compressor& rhs) = delete;
+    Compressor&             operator=(Compressor&& rhs) = delete;
+
+    bool                    write(const char *data, const size_t len, std::string& out, const bool finish) noexcept;
+
+    static bool             compress(const ContentEncoding_t encoding, const std::string& in, std::string& out)
+                                noexcept;
+    static ContentEncoding_t
+                            negotiate(const char *acceptEncoding) noexcept;
+    static const char *     name(const ContentEncoding_t encoding) noexcept;
+
+private:
+    z_stream                zs_;
+    bool                    ok_;
+};
+
+
+// CompressedStream - compresses the output of another ResponseStream, a block at a time.
+//
+class CompressedStream : public ResponseStream
+{
+public:
+                            CompressedStream(const ResponseStream_sptr_t& source, const ContentEncoding_t encoding)
+                                noexcept;
+
+    ssize_t                 read(char *buf, const size_t max) noexcept override;
+
+private:
+    ResponseStream_sptr_t   source_;
+    Compressor              compressor_;
+    std::string             buffer_;
+    size_t                  offset_;
+    bool                    finished_;
+};
+
+#endif // SERVICE_COMPRESSOR_H_INC
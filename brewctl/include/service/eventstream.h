@@ -0,0 +1,65 @@
+#ifndef SERVICE_EVENTSTREAM_H_INC
+#define SERVICE_EVENTSTREAM_H_INC
+/*
+    eventstream.h: a Server-Sent Events stream of telemetry records (sensor samples, effector transitions, control-state
+    changes), served to one client of the /stream endpoint.  Each stream consumes the telemetry bus through its own
+    subscriber, optionally filtered by session and rate-limited, and is identified by the bus position of each record so
+    that a reconnecting client can resume where it left off.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/telemetry.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+extern "C"
+{
+#include <sys/types.h>      // ssize_t
+}
+
+
+struct MHD_Connection;
+
+class EventStream
+{
+public:
+                                EventStream(TelemetryBus& bus, struct MHD_Connection *connection, const int sessionId,
+                                            const std::set<int>& effectorChannels, const int minIntervalMs,
+                                            const int keepaliveIntervalMs, const int64_t lastEventId) noexcept;
+                                EventStream(const EventStream& rhs) = delete;
+                                EventStream(EventStream&& rhs) = delete;
+
+    EventStream&                operator=(const EventStream& rhs) = delete;
+    EventStream&                operator=(EventStream&& rhs) = delete;
+
+    ssize_t                     read(char *buf, const size_t max) noexcept;
+    struct MHD_Connection *     connection() const noexcept { return connection_; };
+
+private:
+    void                        fill() noexcept;
+    bool                        accept(const TelemetryRecord_t& record) noexcept;
+    void                        format(const TelemetryRecord_t& record, const uint64_t id) noexcept;
+
+    TelemetrySubscriber         subscriber_;
+    struct MHD_Connection *     connection_;
+    int                         sessionId_;             // Session to which events are restricted; 0 = all sessions
+    std::set<int>               effectorChannels_;      // Channels of the effectors of session <sessionId_>
+    int                         minIntervalMs_;         // Min interval between sample events per sensor; 0 = no limit
+    int                         keepaliveIntervalMs_;
+    std::map<int, int64_t>      lastSample_;            // Sensor channel -> timestamp of last sample event sent
+    uint64_t                    reportedDrops_;
+    int64_t                     lastWrite_;
+    std::string                 buffer_;
+    size_t                      offset_;
+};
+
+typedef std::shared_ptr<EventStream> EventStream_sptr_t;
+
+#endif // SERVICE_EVENTSTREAM_H_INC
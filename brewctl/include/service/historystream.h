@@ -0,0 +1,102 @@
+#ifndef SERVICE_HISTORYSTREAM_H_INC
+#define SERVICE_HISTORYSTREAM_H_INC
+/*
+    historystream.h: streams the downsampled temperature history of a session directly from a cursor over the
+    temperature log.  Rows are reduced to at most a fixed number of points as they are read, so neither the result set
+    nor the response is ever held in memory in full.  The response may alternatively be encoded in the compact
+    application/x-brewctl-ts format (see timeseries.h).
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/error.h"
+#include "include/service/responsestream.h"
+#include "include/service/serializer.h"
+#include "include/service/timeseriesencoder.h"
+#include "include/sqlite/sqlite.h"
+#include "include/sqlite/sqlitestmt.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+typedef enum HistoryMode
+{
+    HISTORY_MINMAX = 0,                 // Per-bucket [min, max]
+    HISTORY_AVG,                        // Per-bucket mean
+    HISTORY_LTTB,                       // Largest-Triangle-Three-Buckets: one representative sample per bucket
+    HISTORY_INVALID
+} HistoryMode_t;
+
+
+class HistoryStream : public ResponseStream
+{
+public:
+                                HistoryStream(const int sessionId, const int channel, const int64_t from,
+                                              const int64_t to, const int points, const HistoryMode_t mode,
+                                              const SerialFormat_t format = SERIAL_JSON, const bool compact = false)
+                                    noexcept;
+                                HistoryStream(const HistoryStream& rhs) = delete;
+                                HistoryStream(HistoryStream&& rhs) = delete;
+
+    HistoryStream&              operator=(const HistoryStream& rhs) = delete;
+    HistoryStream&              operator=(HistoryStream&& rhs) = delete;
+
+    bool                        init(SQLite& db, Error * const err = nullptr) noexcept;
+    ssize_t                     read(char *buf, const size_t max) noexcept override;
+    const char *                contentType() const noexcept;
+
+    static HistoryMode_t        modeFromName(const std::string_view name) noexcept;
+    static const char *         modeName(const HistoryMode_t mode) noexcept;
+
+private:
+    typedef struct Point
+    {
+        int64_t                 t;
+        double                  v;
+    } Point_t;
+
+    void                        fill() noexcept;
+    bool                        nextRow(Point_t& p) noexcept;
+    void                        add(const Point_t& p) noexcept;
+    void                        finish() noexcept;
+    void                        writeBucket() noexcept;
+    void                        writePoint(const Point_t& p) noexcept;
+    void                        selectPoint(const Point_t& next) noexcept;
+
+    int                         sessionId_;
+    int                         channel_;
+    int64_t                     from_;
+    int64_t                     to_;
+    HistoryMode_t               mode_;
+    int64_t                     interval_;          // Width of each bucket, in seconds
+    int64_t                     nbuckets_;
+    SQLiteStmt                  stmt_;
+    std::string                 buffer_;
+    SerialFormat_t              format_;
+    Serializer_uptr_t           writer_;
+    bool                        compact_;           // Encode as application/x-brewctl-ts, rather than using <writer_>
+    TimeSeriesEncoder           encoder_;
+    size_t                      offset_;
+    bool                        started_;
+    bool                        done_;
+    bool                        failed_;
+
+    // Bucket state (HISTORY_MINMAX, HISTORY_AVG)
+    int64_t                     bucket_;            // Index of the bucket currently being accumulated
+    int64_t                     count_;
+    double                      min_;
+    double                      max_;
+    double                      sum_;
+
+    // LTTB state
+    Point_t                     selected_;          // The most recently selected point
+    int64_t                     nextBucket_;        // Index of the bucket whose points are in <next_>
+    std::vector<Point_t>        pending_;           // Points of the bucket awaiting selection
+    std::vector<Point_t>        next_;              // Points of the following (non-empty) bucket
+};
+
+#endif // SERVICE_HISTORYSTREAM_H_INC
@@ -8,25 +8,40 @@
     Part of brewctl
 */
 
+#include "include/application/alarm.h"
+#include "include/application/sessionsnapshot.h"
+#include "include/service/importer.h"
+#include "include/service/responsecache.h"
+#include "include/service/responsestream.h"
+#include "include/service/router.h"
+#include "include/service/serializer.h"
+#include "include/sqlite/sqlite.h"
 #include "include/util/url.h"
-#include <map>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
 class HttpRequestHandler
 {
+friend struct HttpRoutes;
+
 public:
     typedef enum
     {
         HTTP_OK                     = 200,
+        HTTP_NOT_MODIFIED           = 304,
         HTTP_BAD_REQUEST            = 400,
         HTTP_UNAUTHORIZED           = 401,
         HTTP_FORBIDDEN              = 403,
         HTTP_NOT_FOUND              = 404,
         HTTP_METHOD_NOT_ALLOWED     = 405,
         HTTP_NOT_ACCEPTABLE         = 406,
-        HTTP_INTERNAL_SERVER_ERROR  = 500
+        HTTP_CONFLICT               = 409,
+        HTTP_PAYLOAD_TOO_LARGE      = 413,
+        HTTP_INTERNAL_SERVER_ERROR  = 500,
+        HTTP_SERVICE_UNAVAILABLE    = 503
     } HttpStatus_t;
 
     typedef enum
@@ -39,33 +54,78 @@ public:
         HTTP_INVALID
     } HttpMethod_t;
 
+    // Masks identifying the methods accepted by a route
+    static constexpr uint8_t    METHOD_HEAD     = 1 << HTTP_HEAD,
+                                METHOD_GET      = 1 << HTTP_GET,
+                                METHOD_POST     = 1 << HTTP_POST,
+                                METHOD_PUT      = 1 << HTTP_PUT,
+                                METHOD_DELETE   = 1 << HTTP_DELETE;
+
     typedef bool (HttpRequestHandler::*ApiCallHandler_t)(void);
-    typedef std::map<std::string, ApiCallHandler_t> ApiHandlerMap_t;
-    typedef std::map<std::string, HttpMethod_t> HttpMethodMap_t;
+    typedef Router::Route<ApiCallHandler_t> Route_t;
 
-                                HttpRequestHandler(const std::string& method, const std::string& uri) noexcept;
+                                HttpRequestHandler(const std::string& method, Util::URL& url,
+                                                   const char *accept = nullptr, Importer *upload = nullptr)
+                                    noexcept;
     virtual                     ~HttpRequestHandler() = default;
 
     bool                        handleRequest() noexcept;
     HttpStatus_t                statusCode() const noexcept { return statusCode_; };
     size_t                      responseLength() const noexcept { return responseBody_.length(); };
     std::string                 responseBody() const noexcept { return responseBody_; };
+    HttpResponse_sptr_t         response() noexcept;
 
 private:
+                                HttpRequestHandler(const HttpRequestHandler& batch, Util::URL& url, SQLite& db)
+                                    noexcept;
+
     bool                        missingArg(const std::string& arg) noexcept;
     bool                        missingArg(const std::vector<std::string>& arg) noexcept;
     bool                        notFound() noexcept;
+    bool                        callAlarms() noexcept;
+    bool                        callBatch() noexcept;
+    bool                        callChanges() noexcept;
+    bool                        callImport() noexcept;
     bool                        callOption() noexcept;
+    bool                        callSessions() noexcept;
+    bool                        callSessionCommand() noexcept;
+    bool                        callSessionHistory() noexcept;
     bool                        methodNotAllowed() noexcept;
 
+    bool                        intArg(const std::string& name, long long& val) noexcept;
+    bool                        sessionIdArg(session_id_t& id) noexcept;
+    bool                        accepts(const char *type) const noexcept;
+
+    static HttpMethod_t         methodFromString(const std::string& method) noexcept;
+    bool                        respond(const HttpStatus_t status, const SerialKey& key, const std::string& value)
+                                    noexcept;
+    Serializer_uptr_t           serializer(std::string& out) const noexcept;
+    SQLite&                     db() const noexcept { return *db_; };
+    AlarmSet_sptr_t             alarms() const noexcept;
+    SessionSnapshotSet_sptr_t   snapshot() const noexcept;
+    SerialFormat_t              negotiateFormat() const noexcept;
+
+    static void                 serializeAlarms(const AlarmSet_t& alarms, Serializer& w) noexcept;
+    static void                 serializeSessions(const SessionSnapshotSet_t& snapshot, Serializer& w) noexcept;
+
     HttpMethod_t                method_;
     std::string                 methodStr_;
-    std::string                 uri_;
-    Util::URL                   url_;
+    std::string                 accept_;
+    SerialFormat_t              format_;
+    Util::URL&                  url_;
+    std::string_view            path_;
+    Router::Params              params_;
     HttpStatus_t                statusCode_;
     std::string                 responseBody_;
-    static ApiHandlerMap_t      handlers_;
-    static HttpMethodMap_t      methods_;
+    HttpResponse_sptr_t         cachedResponse_;
+    ResponseStream_sptr_t       stream_;
+    const char *                contentType_;
+    SQLite *                    db_;
+    Importer *                  upload_;            // If set, the importer to which the request body was passed
+    AlarmSet_sptr_t             alarms_;            // If set, the alarm set from which all responses are built
+    SessionSnapshotSet_sptr_t   snapshot_;          // If set, the session snapshot from which all responses are built
+    bool                        inBatch_;           // True if this is a sub-request of a /batch request
+    static ResponseCache        cache_;
 };
 
 #endif // INCLUDE_SERVICE_HTTPREQUESTHANDLER_H_INC
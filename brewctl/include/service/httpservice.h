@@ -11,7 +11,16 @@
 #include "include/framework/error.h"
 #include "include/framework/log.h"
 #include "include/framework/thread.h"
+#include "include/service/compressor.h"
+#include "include/service/eventstream.h"
 #include "include/service/httprequesthandler.h"
+#include "include/service/importer.h"
+#include "include/service/staticassets.h"
+#include "include/util/url.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 extern "C"
 {
@@ -22,30 +31,83 @@ extern "C"
 class HttpService : public Thread
 {
 public:
-                            HttpService(const unsigned short port) noexcept;
+                            HttpService(const unsigned short port, const int listenFd = -1) noexcept;
                             HttpService(const HttpService&) = delete;
 
     HttpService&            operator=(const HttpService&) = delete;
 
     bool                    run() noexcept override;
+    int                     quiesce() noexcept;
 
 private:
+    typedef struct ResponseContext
+    {
+        HttpResponse_sptr_t     response;       // Holds a reference to the response, and therefore to <body>
+        const std::string *     body;           // The (possibly compressed) body; unused if <stream> is set
+        ResponseStream_sptr_t   stream;         // The (possibly compressed) response stream, if any
+    } ResponseContext_t;
+
+    typedef struct UploadContext
+    {
+        std::unique_ptr<Importer>   importer;   // Parses the request body, writing it to the database as it arrives
+        size_t                      received;   // Number of bytes of the request body received so far
+        bool                        refused;    // A response refusing the request has already been queued
+    } UploadContext_t;
+
+    typedef struct StreamContext
+    {
+        HttpService *       service;
+        EventStream_sptr_t  stream;
+    } StreamContext_t;
+
     int                     handleConnection(struct MHD_Connection *connection, const char *url, const char *method,
                                              const char *version, const char *upload_data, size_t *upload_data_size,
                                              void **con_cls) noexcept;
-    void *                  logUri(const char *uri) noexcept;
-    void                    requestCompleted(struct MHD_Connection *connection, void **con_cls,
-                                             enum MHD_RequestTerminationCode code) noexcept;
+    MHD_Daemon *            startDaemon(const unsigned short port, const int listenFd, const int threadPoolSize)
+                                noexcept;
+    void                    startUnixDaemon() noexcept;
+    bool                    peerAuthorised(struct MHD_Connection *connection) const noexcept;
+    int                     handleStream(struct MHD_Connection *connection, Util::URL& url) noexcept;
+    int                     handleUpload(struct MHD_Connection *connection, UploadContext_t *upload,
+                                         const char *upload_data, size_t *upload_data_size) noexcept;
+    int                     handleAsset(struct MHD_Connection *connection, const StaticAssets::Asset_t& asset) noexcept;
+    ssize_t                 readStream(const EventStream_sptr_t& stream, char *buf, size_t max) noexcept;
+    void                    resumeStreams() noexcept;
 
     static int              callbackHandleConnection(void *cls, struct MHD_Connection *connection, const char *url,
                                                      const char *method, const char *version, const char *upload_data,
                                                      size_t *upload_data_size, void **con_cls) noexcept;
-    static void *           callbackLogUri(void *cls, const char *uri) noexcept;
+    static int              callbackAddArg(void *cls, enum MHD_ValueKind kind, const char *key, const char *value)
+                                noexcept;
     static void             callbackRequestCompleted(void *cls, struct MHD_Connection *connection, void **con_cls,
                                                      enum MHD_RequestTerminationCode code) noexcept;
+    static ssize_t          callbackReadResponse(void *cls, uint64_t pos, char *buf, size_t max) noexcept;
+    static void             callbackFreeResponse(void *cls) noexcept;
+    static ssize_t          callbackReadStream(void *cls, uint64_t pos, char *buf, size_t max) noexcept;
+    static void             callbackFreeStream(void *cls) noexcept;
+    static int              queueStatus(struct MHD_Connection *connection, const unsigned int status,
+                                        const char *body, const size_t len) noexcept;
+    static bool             etagMatches(const char *header, const std::string& etag) noexcept;
 
     const unsigned short    port_;
+    int                     listenFd_;
+    int                     threadPoolSize_;
+    int                     connectionLimit_;
+    int                     connectionTimeout_;
+    int                     streamPollInterval_;
+    int                     streamKeepalive_;
+    int                     compressMinBytes_;
+    int                     maxUploadBytes_;
+    int                     staticMaxAge_;
+    StaticAssets            assets_;
+    std::string             unixSocketPath_;
+    gid_t                   unixSocketGid_;     // Group permitted to use the Unix socket; (gid_t) -1 if none
     MHD_Daemon *            daemon_;
+    MHD_Daemon *            unixDaemon_;
+    std::mutex              streamLock_;
+    std::vector<EventStream_sptr_t>
+                            suspendedStreams_;  // Streams whose connections are suspended, awaiting resumption
+    bool                    stopping_;
 };
 
 #endif // SERVICE_HTTPSERVICE_H_INC
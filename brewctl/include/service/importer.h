@@ -0,0 +1,205 @@
+#ifndef SERVICE_IMPORTER_H_INC
+#define SERVICE_IMPORTER_H_INC
+/*
+    importer.h: imports JSON documents uploaded to the API (e.g. a library of profiles, or historical temperature
+    data) into the database.  The document is parsed as it arrives, and each record is written as soon as it has been
+    read, in batched transactions, so an import of any size runs in constant memory.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/error.h"
+#include "include/service/json/reader.h"
+#include "include/sqlite/sqlite.h"
+#include "include/sqlite/sqlitestmt.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+typedef enum ScalarType
+{
+    SCALAR_STRING,
+    SCALAR_INTEGER,
+    SCALAR_NUMBER,
+    SCALAR_BOOLEAN,
+    SCALAR_NULL
+} ScalarType_t;
+
+
+typedef struct Scalar
+{
+    ScalarType_t        type;
+    std::string_view    str;
+    long long           integer;
+    double              number;
+    bool                boolean;
+
+    bool                getInt(long long& val) const noexcept;
+    bool                getDouble(double& val) const noexcept;
+} Scalar_t;
+
+
+class Importer : public JsonHandler
+{
+public:
+    static const int        BATCH_SIZE = 500;       // Max number of rows written per transaction, within one chunk
+
+    virtual                 ~Importer() noexcept;
+
+                            Importer(const Importer& rhs) = delete;
+                            Importer(Importer&& rhs) = delete;
+
+    Importer&               operator=(const Importer& rhs) = delete;
+    Importer&               operator=(Importer&& rhs) = delete;
+
+    static Importer *       create(const std::string_view path) noexcept;
+
+    bool                    begin(Error * const err = nullptr) noexcept;
+    bool                    feed(const char *data, const size_t len) noexcept;
+    bool                    finish() noexcept;
+
+    bool                    failed() const noexcept { return !error_.empty(); };
+    const std::string&      error() const noexcept { return error_; };
+    size_t                  offset() const noexcept { return reader_.offset(); };
+    size_t                  imported() const noexcept { return committed_; };
+
+    bool                    beginObject() noexcept override;
+    bool                    endObject() noexcept override;
+    bool                    beginArray() noexcept override;
+    bool                    endArray() noexcept override;
+    bool                    key(const std::string_view key) noexcept override;
+    bool                    str(const std::string_view val) noexcept override;
+    bool                    integer(const long long val) noexcept override;
+    bool                    number(const double val) noexcept override;
+    bool                    boolean(const bool val) noexcept override;
+    bool                    null() noexcept override;
+
+protected:
+                            Importer() noexcept;
+
+    virtual bool            prepare(SQLite& db, Error * const err) noexcept = 0;
+    virtual bool            enter(const bool object) noexcept = 0;
+    virtual bool            leave(const bool object) noexcept = 0;
+    virtual bool            scalar(const Scalar_t& val) noexcept = 0;
+
+    bool                    skip() noexcept;
+    bool                    write(SQLiteStmt& stmt) noexcept;
+    bool                    recordDone() noexcept;
+    bool                    fail(const std::string& error) noexcept;
+
+    SQLite                  db_;
+    int                     depth_;             // Number of containers enclosing the current value
+    std::string             key_;               // Key of the current member of the enclosing object
+
+private:
+    bool                    endContainer(const bool object) noexcept;
+    bool                    value(const Scalar_t& val) noexcept;
+    bool                    commit() noexcept;
+    void                    rollback() noexcept;
+
+    JsonReader              reader_;
+    int                     skipDepth_;         // If >= 0, the depth of a container being skipped
+    bool                    inTransaction_;
+    int                     batchRows_;         // Number of rows written in the current transaction
+    size_t                  records_;           // Number of records written, including those not yet committed
+    size_t                  committed_;         // Number of records committed
+    std::string             error_;
+};
+
+
+// ProfileImporter - imports an array of temperature profiles, e.g.
+//
+//     [{"id": 3, "name": "Lager", "type": "ferment",
+//       "stages": [{"duration_hours": 240, "temperature": 10.0}, {"temperature": 2.0}]}, ...]
+//
+// If "id" is specified, the profile replaces any existing profile with that id.  A stage with no duration is held
+// indefinitely, so must be the last stage of its profile.
+//
+class ProfileImporter : public Importer
+{
+public:
+    static const size_t     MAX_STAGES = 64;        // Max number of stages in a profile
+
+                            ProfileImporter() noexcept;
+
+protected:
+    bool                    prepare(SQLite& db, Error * const err) noexcept override;
+    bool                    enter(const bool object) noexcept override;
+    bool                    leave(const bool object) noexcept override;
+    bool                    scalar(const Scalar_t& val) noexcept override;
+
+private:
+    typedef struct Stage
+    {
+        long long           durationHours;      // -1 if the stage is held indefinitely
+        double              temperature;
+        bool                hasTemperature;
+    } Stage_t;
+
+    bool                    writeProfile() noexcept;
+
+    SQLiteStmt              insertProfile_;
+    SQLiteStmt              replaceProfile_;
+    SQLiteStmt              deleteStages_;
+    SQLiteStmt              insertStage_;
+
+    long long               id_;                // Id of the current profile, or 0 if not specified
+    std::string             name_;
+    std::string             type_;
+    bool                    inStages_;
+    std::vector<Stage_t>    stages_;
+};
+
+
+// TemperatureImporter - imports an array of temperature samples into the temperature log, e.g.
+//
+//     [{"timestamp": 1514764800, "sensor": 1, "temperature": 18.25}, ...]
+//
+// "timestamp" is in seconds since the epoch.  Samples which duplicate an existing sample (i.e. from the same sensor, at
+// the same time) are skipped, so an import may safely be repeated.
+//
+class TemperatureImporter : public Importer
+{
+public:
+                            TemperatureImporter() noexcept;
+
+protected:
+    bool                    prepare(SQLite& db, Error * const err) noexcept override;
+    bool                    enter(const bool object) noexcept override;
+    bool                    leave(const bool object) noexcept override;
+    bool                    scalar(const Scalar_t& val) noexcept override;
+
+private:
+    SQLiteStmt              insert_;
+
+    long long               timestamp_;
+    long long               sensor_;
+    double                  temperature_;
+    unsigned int            fields_;            // Mask of the fields of the current sample which have been read
+};
+
+
+// OptionImporter - sets the options named by the keys of an object to the corresponding (scalar) values, e.g.
+//
+//     {"units": "C", "display.brightness": 80}
+//
+class OptionImporter : public Importer
+{
+public:
+                            OptionImporter() noexcept;
+
+protected:
+    bool                    prepare(SQLite& db, Error * const err) noexcept override;
+    bool                    enter(const bool object) noexcept override;
+    bool                    leave(const bool object) noexcept override;
+    bool                    scalar(const Scalar_t& val) noexcept override;
+
+private:
+    SQLiteStmt              replace_;
+};
+
+#endif // SERVICE_IMPORTER_H_INC
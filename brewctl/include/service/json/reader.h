@@ -0,0 +1,102 @@
+#ifndef SERVICE_JSON_READER_H_INC
+#define SERVICE_JSON_READER_H_INC
+/*
+    reader.h: push (SAX-style) JSON parser.  The document is fed to the parser in arbitrarily-sized chunks, e.g. as the
+    body of an HTTP request arrives, and is reported to a handler as a sequence of events; no document tree is built,
+    so the memory used is independent of the size of the document.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+// JsonHandler - interface to be implemented by the receiver of the events generated by a JsonReader.  Each method
+// returns false to abort parsing.
+//
+class JsonHandler
+{
+public:
+    virtual                 ~JsonHandler() = default;
+
+    virtual bool            beginObject() noexcept = 0;
+    virtual bool            endObject() noexcept = 0;
+    virtual bool            beginArray() noexcept = 0;
+    virtual bool            endArray() noexcept = 0;
+    virtual bool            key(const std::string_view key) noexcept = 0;
+    virtual bool            str(const std::string_view val) noexcept = 0;
+    virtual bool            integer(const long long val) noexcept = 0;
+    virtual bool            number(const double val) noexcept = 0;
+    virtual bool            boolean(const bool val) noexcept = 0;
+    virtual bool            null() noexcept = 0;
+};
+
+
+class JsonReader
+{
+public:
+    static const int        MAX_DEPTH = 16;             // Max nesting depth of objects and arrays
+    static const size_t     MAX_TOKEN_LENGTH = 4096;    // Max length of a key, string value or number
+
+                            JsonReader(JsonHandler& handler) noexcept;
+                            JsonReader(const JsonReader& rhs) = delete;
+                            JsonReader(JsonReader&& rhs) = delete;
+
+    JsonReader&             operator=(const JsonReader& rhs) = delete;
+    JsonReader&             operator=(JsonReader&& rhs) = delete;
+
+    bool                    feed(const char *data, const size_t len) noexcept;
+    bool                    finish() noexcept;
+
+    bool                    failed() const noexcept { return error_ != nullptr; };
+    const char *            error() const noexcept { return error_; };
+    size_t                  offset() const noexcept { return offset_; };
+
+private:
+    typedef enum
+    {
+        STATE_VALUE,                // Expecting a value
+        STATE_ARRAY_START,          // Expecting a value or ']'
+        STATE_OBJECT_START,         // Expecting a key or '}'
+        STATE_KEY,                  // Expecting a key
+        STATE_COLON,                // Expecting ':'
+        STATE_NEXT,                 // Expecting ',' or the end of the current container
+        STATE_STRING,               // Within a string
+        STATE_ESCAPE,               // Within a string, following '\'
+        STATE_UNICODE,              // Within a string, within a \u escape sequence
+        STATE_NUMBER,               // Within a number
+        STATE_LITERAL,              // Within true, false or null
+        STATE_DONE                  // The document is complete
+    } State_t;
+
+    bool                    consume(const char c) noexcept;
+    bool                    beginValue(const char c) noexcept;
+    bool                    beginContainer(const bool object) noexcept;
+    bool                    endContainer(const bool object) noexcept;
+    bool                    endString() noexcept;
+    bool                    endNumber() noexcept;
+    bool                    endLiteral() noexcept;
+    bool                    valueDone(const bool ok) noexcept;
+    bool                    append(const char c) noexcept;
+    bool                    appendCodePoint(const unsigned int cp) noexcept;
+    bool                    flushSurrogate() noexcept;
+    bool                    fail(const char * const error) noexcept;
+
+    JsonHandler&            handler_;
+    State_t                 state_;
+    std::string             token_;             // Key, string value or number being read
+    bool                    isKey_;             // True if <token_> is a key
+    unsigned int            codePoint_;         // Code point being read from a \u escape sequence
+    int                     codePointDigits_;   // Number of hex digits of <codePoint_> read so far
+    unsigned int            highSurrogate_;     // Leading half of a surrogate pair, awaiting the trailing half, or 0
+    int                     depth_;
+    bool                    inObject_[MAX_DEPTH + 1];   // Whether each open container is an object
+    size_t                  offset_;            // Offset in the document of the next char to be read
+    const char *            error_;
+};
+
+#endif // SERVICE_JSON_READER_H_INC
@@ -0,0 +1,61 @@
+#ifndef INCLUDE_SERVICE_JSON_WRITER_H_INC
+#define INCLUDE_SERVICE_JSON_WRITER_H_INC
+/*
+    writer.h: streaming JSON writer.  Formats JSON directly into a caller-owned output buffer, without building a
+    document tree; the buffer can be reused between documents, or drained between calls when a document is produced
+    incrementally (e.g. by a chunked-response callback).
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/serializer.h"
+#include <string>
+
+
+class JsonWriter : public Serializer
+{
+public:
+    static const int        MAX_DEPTH = 16;     // Max nesting depth of objects and arrays
+
+                            JsonWriter(std::string& out) noexcept;
+                            JsonWriter(const JsonWriter& rhs) = delete;
+                            JsonWriter(JsonWriter&& rhs) = delete;
+
+    JsonWriter&             operator=(const JsonWriter& rhs) = delete;
+    JsonWriter&             operator=(JsonWriter&& rhs) = delete;
+
+    using Serializer::beginObject;
+    using Serializer::beginArray;
+    using Serializer::value;
+
+    Serializer&             beginObject() noexcept override;
+    Serializer&             endObject() noexcept override;
+    Serializer&             beginArray() noexcept override;
+    Serializer&             endArray() noexcept override;
+
+    Serializer&             key(const SerialKey& key) noexcept override;
+
+    Serializer&             value(const bool val) noexcept override;
+    Serializer&             value(const long long val) noexcept override;
+    Serializer&             value(const unsigned long long val) noexcept override;
+    Serializer&             value(const double val) noexcept override;
+    Serializer&             value(const char *str, const size_t len) noexcept override;
+    Serializer&             null() noexcept override;
+    Serializer&             encodedValue(const char *data, const size_t len) noexcept override;
+
+    int                     depth() const noexcept { return depth_; };
+
+private:
+    void                    separate() noexcept;
+    void                    open(const char c) noexcept;
+    void                    close(const char c) noexcept;
+    void                    writeString(const char *str, const size_t len) noexcept;
+
+    int                     depth_;
+    bool                    afterKey_;
+    bool                    hasMembers_[MAX_DEPTH + 1];     // Whether each open container has had a member written
+};
+
+#endif // INCLUDE_SERVICE_JSON_WRITER_H_INC
@@ -0,0 +1,70 @@
+#ifndef INCLUDE_SERVICE_MSGPACK_WRITER_H_INC
+#define INCLUDE_SERVICE_MSGPACK_WRITER_H_INC
+/*
+    writer.h: streaming MessagePack writer.  MessagePack maps and arrays are prefixed with their member counts, which
+    are not known until the container is closed, so each container's header is reserved when it is opened and filled in
+    when it is closed.  The output buffer must therefore not be drained part-way through a document.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/serializer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+class MsgPackWriter : public Serializer
+{
+public:
+    static const int        MAX_DEPTH = 16;     // Max nesting depth of objects and arrays
+
+                            MsgPackWriter(std::string& out) noexcept;
+                            MsgPackWriter(const MsgPackWriter& rhs) = delete;
+                            MsgPackWriter(MsgPackWriter&& rhs) = delete;
+
+    MsgPackWriter&          operator=(const MsgPackWriter& rhs) = delete;
+    MsgPackWriter&          operator=(MsgPackWriter&& rhs) = delete;
+
+    using Serializer::beginObject;
+    using Serializer::beginArray;
+    using Serializer::value;
+
+    Serializer&             beginObject() noexcept override;
+    Serializer&             endObject() noexcept override;
+    Serializer&             beginArray() noexcept override;
+    Serializer&             endArray() noexcept override;
+
+    Serializer&             key(const SerialKey& key) noexcept override;
+
+    Serializer&             value(const bool val) noexcept override;
+    Serializer&             value(const long long val) noexcept override;
+    Serializer&             value(const unsigned long long val) noexcept override;
+    Serializer&             value(const double val) noexcept override;
+    Serializer&             value(const char *str, const size_t len) noexcept override;
+    Serializer&             null() noexcept override;
+    Serializer&             encodedValue(const char *data, const size_t len) noexcept override;
+
+    bool                    streamable() const noexcept override { return false; };
+
+private:
+    typedef struct Container
+    {
+        size_t              offset;             // Offset of the container's header in the output buffer
+        uint32_t            count;              // Number of members (arrays) or key/value pairs (maps) written
+    } Container_t;
+
+    void                    member() noexcept;
+    void                    open(const uint8_t type) noexcept;
+    void                    close(const uint8_t fixType) noexcept;
+    void                    writeBE(const uint64_t val, int nbytes) noexcept;
+    void                    writeString(const char *str, const size_t len) noexcept;
+
+    int                     depth_;
+    bool                    afterKey_;
+    Container_t             containers_[MAX_DEPTH + 1];
+};
+
+#endif // INCLUDE_SERVICE_MSGPACK_WRITER_H_INC
@@ -0,0 +1,73 @@
+#ifndef SERVICE_RESPONSECACHE_H_INC
+#define SERVICE_RESPONSECACHE_H_INC
+/*
+    responsecache.h: cache of serialised API responses, keyed by route and representation (e.g. serialisation format),
+    and by the version of the data from which each response was built.  Responses are immutable and reference-counted,
+    so they can be served concurrently, and outlive their eviction from the cache, without being copied.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/compressor.h"
+#include "include/service/responsestream.h"
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+
+typedef struct HttpResponse
+{
+    int                     status;
+    std::string             body;
+    std::string             etag;               // Quoted entity tag; empty if the response is not cacheable
+    const char *            contentType = "text/json";
+    ResponseStream_sptr_t   stream;             // If set, generates the body in place of <body>; never cached
+
+    const std::string&      encodedBody(const ContentEncoding_t encoding) const noexcept;
+
+    mutable std::once_flag  encodeOnce[NUM_ENCODINGS];
+    mutable std::string     encodedBodies[NUM_ENCODINGS];   // Compressed copies of <body>, each built on first use
+} HttpResponse_t;
+
+typedef std::shared_ptr<const HttpResponse_t> HttpResponse_sptr_t;
+
+
+class ResponseCache
+{
+public:
+    typedef std::function<void(HttpResponse_t&)> Builder_t;
+
+                            ResponseCache() noexcept;
+                            ResponseCache(const ResponseCache& rhs) = delete;
+                            ResponseCache(ResponseCache&& rhs) = delete;
+
+    ResponseCache&          operator=(const ResponseCache& rhs) = delete;
+    ResponseCache&          operator=(ResponseCache&& rhs) = delete;
+
+    HttpResponse_sptr_t     get(const std::string& key, const int variant, const uint64_t version,
+                                const Builder_t& build) noexcept;
+
+private:
+    typedef struct Entry
+    {
+        uint64_t            version;
+        std::shared_future<HttpResponse_sptr_t>
+                            response;
+    } Entry_t;
+
+    std::string             etag(const int variant, const uint64_t version) const noexcept;
+
+    std::mutex              lock_;
+    std::map<std::pair<std::string, int>, Entry_t>
+                            entries_;
+    uint64_t                instanceId_;
+};
+
+#endif // SERVICE_RESPONSECACHE_H_INC
@@ -0,0 +1,33 @@
+#ifndef SERVICE_RESPONSESTREAM_H_INC
+#define SERVICE_RESPONSESTREAM_H_INC
+/*
+    responsestream.h: interface to a response body which is generated incrementally, as the client reads it, rather
+    than being built in full before it is sent.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <cstddef>
+#include <memory>
+
+extern "C"
+{
+#include <sys/types.h>      // ssize_t
+}
+
+
+class ResponseStream
+{
+public:
+    virtual                     ~ResponseStream() = default;
+
+    // read() - copy up to <max> bytes of the body into <buf>.  Returns the number of bytes copied; 0 at the end of the
+    // body; or -1 if the body cannot be completed.
+    virtual ssize_t             read(char *buf, const size_t max) noexcept = 0;
+};
+
+typedef std::shared_ptr<ResponseStream> ResponseStream_sptr_t;
+
+#endif // SERVICE_RESPONSESTREAM_H_INC
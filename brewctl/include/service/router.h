@@ -0,0 +1,308 @@
+#ifndef SERVICE_ROUTER_H_INC
+#define SERVICE_ROUTER_H_INC
+/*
+    router.h: compile-time HTTP route table.  Route patterns, e.g. "/session/{id:int}/history", are compiled by a
+    constexpr ctor into a trie over path segments, so that matching a request path is a single walk along the path,
+    with no allocation, however many routes there are.  Patterns consist of literal segments and typed parameter
+    segments ("{name:int}" or "{name:str}"); when both match a segment, literal segments take precedence.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+
+void invalidRoute() noexcept;
+
+
+namespace Router
+{
+
+typedef enum ParamType
+{
+    PARAM_NONE = 0,
+    PARAM_INT,                                  // Optionally-signed decimal integer
+    PARAM_STR                                   // Any non-empty segment
+} ParamType_t;
+
+
+static const size_t
+    MAX_PARAMS  = 4;                            // Max number of parameters in a route pattern
+
+
+// Route - a route pattern, the HTTP methods it accepts (a bitmask, interpreted by the caller), and its handler.
+//
+template<typename H>
+struct Route
+{
+    const char *            pattern;
+    uint8_t                 methods;
+    H                       handler;
+};
+
+
+// Params - the parameter values captured when a path matched a route.  Values refer to the matched path, which must
+// outlive the Params object.
+//
+class Params
+{
+template<typename H, size_t N, size_t MAX_NODES> friend class Trie;
+
+public:
+    constexpr               Params() noexcept : count_(0), names_{}, values_{}, ints_{} {};
+
+    size_t                  count() const noexcept { return count_; };
+    bool                    exists(const std::string_view name) const noexcept { return find(name) != -1; };
+    std::string_view        str(const std::string_view name) const noexcept;
+    long long               getInt(const std::string_view name) const noexcept;
+
+private:
+    int                     find(const std::string_view name) const noexcept;
+
+    size_t                  count_;
+    std::string_view        names_[MAX_PARAMS];
+    std::string_view        values_[MAX_PARAMS];
+    long long               ints_[MAX_PARAMS];
+};
+
+
+// Trie - a trie over the path segments of N routes, built at compile time.  MAX_NODES must be at least the number of
+// distinct route prefixes (counted in segments), plus one for the root.
+//
+template<typename H, size_t N, size_t MAX_NODES = 64>
+class Trie
+{
+public:
+    constexpr               Trie(const Route<H> (&routes)[N]) noexcept;
+
+    const Route<H> *        match(const std::string_view path, Params& params) const noexcept;
+
+private:
+    typedef struct Node
+    {
+        uint16_t            firstEdge = 0;      // Index into <edges_> of the node's first literal child edge
+        uint16_t            nedges = 0;         // Number of literal child edges
+        int16_t             paramChild = -1;    // Child reached by a parameter segment, or -1
+        ParamType_t         paramType = PARAM_NONE;
+        std::string_view    paramName;
+        int16_t             route = -1;         // Index of the route ending at this node, or -1
+    } Node_t;
+
+    typedef struct Edge
+    {
+        uint16_t            parent = 0;
+        uint16_t            child = 0;
+        std::string_view    segment;
+    } Edge_t;
+
+    static constexpr bool   nextSegment(const std::string_view path, size_t& pos, std::string_view& segment) noexcept;
+    static constexpr bool   parseInt(const std::string_view str, long long& val) noexcept;
+
+    Route<H>                routes_[N];
+    Node_t                  nodes_[MAX_NODES];
+    Edge_t                  edges_[MAX_NODES];
+    size_t                  nnodes_;
+    size_t                  nedges_;
+};
+
+
+// nextSegment() - extract into <segment> the path segment which starts at or after <pos>, skipping the '/' separator,
+// and advance <pos> past it.  Returns false at the end of the path.
+//
+template<typename H, size_t N, size_t MAX_NODES>
+constexpr bool Trie<H, N, MAX_NODES>::nextSegment(const std::string_view path, size_t& pos,
+                                                  std::string_view& segment) noexcept
+{
+    while((pos < path.length()) && (path[pos] == '/'))
+        ++pos;
+
+    if(pos >= path.length())
+        return false;
+
+    size_t end = pos;
+    while((end < path.length()) && (path[end] != '/'))
+        ++end;
+
+    segment = path.substr(pos, end - pos);
+    pos = end;
+
+    return true;
+}
+
+
+// parseInt() - parse <str> as an optionally-signed decimal integer.  Returns false if <str> is not such an integer, or
+// is out of range.
+//
+template<typename H, size_t N, size_t MAX_NODES>
+constexpr bool Trie<H, N, MAX_NODES>::parseInt(const std::string_view str, long long& val) noexcept
+{
+    size_t i = 0;
+    bool negative = false;
+
+    if(!str.empty() && ((str[0] == '-') || (str[0] == '+')))
+    {
+        negative = (str[0] == '-');
+        ++i;
+    }
+
+    if(i >= str.length())
+        return false;
+
+    unsigned long long v = 0;
+    for(; i < str.length(); ++i)
+    {
+        if((str[i] < '0') || (str[i] > '9') || (v > ((unsigned long long) INT64_MAX - 9) / 10))
+            return false;
+
+        v = (v * 10) + (str[i] - '0');
+    }
+
+    val = negative ? -(long long) v : (long long) v;
+    return true;
+}
+
+
+// ctor - build the trie.  A malformed pattern, two routes with the same pattern, parameters of different types or
+// names at the same position, or too many nodes, is a compile-time error.
+//
+template<typename H, size_t N, size_t MAX_NODES>
+constexpr Trie<H, N, MAX_NODES>::Trie(const Route<H> (&routes)[N]) noexcept
+    : routes_{}, nodes_{}, edges_{}, nnodes_(1), nedges_(0)
+{
+    for(size_t r = 0; r < N; ++r)
+    {
+        routes_[r] = routes[r];
+
+        const std::string_view pattern(routes[r].pattern);
+        std::string_view segment;
+        size_t pos = 0, node = 0, nparams = 0;
+
+        while(nextSegment(pattern, pos, segment))
+        {
+            if(segment[0] == '{')
+            {
+                // Parameter segment: "{name:type}"
+                const size_t colon = segment.find(':');
+                if((segment.back() != '}') || (colon == std::string_view::npos) || (++nparams > MAX_PARAMS))
+                    invalidRoute();
+
+                const std::string_view name = segment.substr(1, colon - 1),
+                                       typeName = segment.substr(colon + 1, segment.length() - colon - 2);
+                const ParamType_t type = (typeName == "int") ? PARAM_INT : (typeName == "str") ? PARAM_STR : PARAM_NONE;
+
+                if(name.empty() || (type == PARAM_NONE))
+                    invalidRoute();
+
+                if(nodes_[node].paramChild == -1)
+                {
+                    if(nnodes_ >= MAX_NODES)
+                        invalidRoute();
+
+                    nodes_[node].paramChild = nnodes_++;
+                    nodes_[node].paramType = type;
+                    nodes_[node].paramName = name;
+                }
+                else if((nodes_[node].paramType != type) || (nodes_[node].paramName != name))
+                    invalidRoute();
+
+                node = nodes_[node].paramChild;
+            }
+            else
+            {
+                size_t e = 0;
+                while((e < nedges_) && ((edges_[e].parent != node) || (edges_[e].segment != segment)))
+                    ++e;
+
+                if(e == nedges_)
+                {
+                    if(nnodes_ >= MAX_NODES)
+                        invalidRoute();
+
+                    edges_[nedges_].parent = node;
+                    edges_[nedges_].child = nnodes_++;
+                    edges_[nedges_].segment = segment;
+                    ++nedges_;
+                }
+
+                node = edges_[e].child;
+            }
+        }
+
+        if(nodes_[node].route != -1)
+            invalidRoute();
+
+        nodes_[node].route = r;
+    }
+
+    // Group each node's edges together, so that a node's literal children can be found from its <firstEdge>/<nedges>
+    for(size_t i = 1; i < nedges_; ++i)
+        for(size_t j = i; (j > 0) && (edges_[j - 1].parent > edges_[j].parent); --j)
+        {
+            const Edge_t tmp = edges_[j];
+            edges_[j] = edges_[j - 1];
+            edges_[j - 1] = tmp;
+        }
+
+    for(size_t e = 0; e < nedges_; ++e)
+    {
+        Node_t& parent = nodes_[edges_[e].parent];
+
+        if(!parent.nedges)
+            parent.firstEdge = e;
+
+        ++parent.nedges;
+    }
+}
+
+
+// match() - find the route matching <path>, and capture its parameters into <params>.  Returns nullptr if no route
+// matches.
+//
+template<typename H, size_t N, size_t MAX_NODES>
+const Route<H> *Trie<H, N, MAX_NODES>::match(const std::string_view path, Params& params) const noexcept
+{
+    std::string_view segment;
+    size_t pos = 0, node = 0;
+
+    params.count_ = 0;
+
+    while(nextSegment(path, pos, segment))
+    {
+        const Node_t& n = nodes_[node];
+        size_t e = n.firstEdge;
+        const size_t end = n.firstEdge + n.nedges;
+
+        while((e < end) && (edges_[e].segment != segment))
+            ++e;
+
+        if(e < end)
+        {
+            node = edges_[e].child;
+            continue;
+        }
+
+        if(n.paramChild == -1)
+            return nullptr;
+
+        long long val = 0;
+        if((n.paramType == PARAM_INT) && !parseInt(segment, val))
+            return nullptr;
+
+        params.names_[params.count_] = n.paramName;
+        params.values_[params.count_] = segment;
+        params.ints_[params.count_] = val;
+        ++params.count_;
+
+        node = n.paramChild;
+    }
+
+    return (nodes_[node].route != -1) ? &routes_[nodes_[node].route] : nullptr;
+}
+
+} // namespace Router
+
+#endif // SERVICE_ROUTER_H_INC
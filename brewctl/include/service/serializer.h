@@ -0,0 +1,111 @@
+#ifndef SERVICE_SERIALIZER_H_INC
+#define SERVICE_SERIALIZER_H_INC
+/*
+    serializer.h: interface to the streaming writers which format API responses.  Handlers describe a response as a
+    sequence of objects, arrays, keys and values; the writer chosen by content negotiation formats it as JSON, CBOR or
+    MessagePack, directly into a caller-owned output buffer.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+
+void invalidSerialKey() noexcept;
+
+
+typedef enum SerialFormat
+{
+    SERIAL_JSON = 0,
+    SERIAL_CBOR,
+    SERIAL_MSGPACK,
+    SERIAL_NUM_FORMATS
+} SerialFormat_t;
+
+
+// SerialKey - an object key.  Keys are string literals consisting only of characters which need no escaping in any
+// format; they are validated by the constexpr ctor (a key which fails validation is a compile-time error wherever the
+// key is a constant expression) and written verbatim.
+//
+class SerialKey
+{
+public:
+    template<size_t N>
+    constexpr               SerialKey(const char (&str)[N]) noexcept
+                                : str_(str), len_(N - 1)
+                            {
+                                for(size_t i = 0; i < len_; ++i)
+                                    if((str[i] < 0x20) || (str[i] == '"') || (str[i] == '\\'))
+                                        invalidSerialKey();
+                            }
+
+    const char *            str() const noexcept { return str_; };
+    size_t                  length() const noexcept { return len_; };
+
+private:
+    const char *            str_;
+    size_t                  len_;
+};
+
+
+class Serializer;
+typedef std::unique_ptr<Serializer> Serializer_uptr_t;
+
+
+class Serializer
+{
+public:
+    virtual                 ~Serializer() = default;
+
+    static Serializer_uptr_t
+                            create(const SerialFormat_t format, std::string& out) noexcept;
+    static const char *     contentType(const SerialFormat_t format) noexcept;
+    static SerialFormat_t   formatFromContentType(const std::string& type) noexcept;
+
+    virtual Serializer&     beginObject() noexcept = 0;
+    Serializer&             beginObject(const SerialKey& key) noexcept { return this->key(key).beginObject(); };
+    virtual Serializer&     endObject() noexcept = 0;
+    virtual Serializer&     beginArray() noexcept = 0;
+    Serializer&             beginArray(const SerialKey& key) noexcept { return this->key(key).beginArray(); };
+    virtual Serializer&     endArray() noexcept = 0;
+
+    virtual Serializer&     key(const SerialKey& key) noexcept = 0;
+
+    virtual Serializer&     value(const bool val) noexcept = 0;
+    Serializer&             value(const int val) noexcept               { return value((long long) val); };
+    Serializer&             value(const long val) noexcept              { return value((long long) val); };
+    virtual Serializer&     value(const long long val) noexcept = 0;
+    Serializer&             value(const unsigned int val) noexcept      { return value((unsigned long long) val); };
+    Serializer&             value(const unsigned long val) noexcept     { return value((unsigned long long) val); };
+    virtual Serializer&     value(const unsigned long long val) noexcept = 0;
+    virtual Serializer&     value(const double val) noexcept = 0;
+    Serializer&             value(const char *val) noexcept;
+    Serializer&             value(const std::string& val) noexcept      { return value(val.data(), val.length()); };
+    virtual Serializer&     value(const char *str, const size_t len) noexcept = 0;
+    virtual Serializer&     null() noexcept = 0;
+
+    // encodedValue() - write a single complete value which has already been encoded, by a writer of the same format,
+    // as <len> bytes at <data>; e.g. a sub-response embedded in a batch response.
+    virtual Serializer&     encodedValue(const char *data, const size_t len) noexcept = 0;
+
+    template<typename T>
+    Serializer&             field(const SerialKey& key, const T& val) noexcept { return this->key(key).value(val); }
+    Serializer&             nullField(const SerialKey& key) noexcept { return this->key(key).null(); };
+
+    // streamable() - return true if the output buffer may be drained part-way through a document.  Writers which
+    // patch earlier output when a container is closed return false.
+    virtual bool            streamable() const noexcept { return true; };
+
+    std::string&            out() noexcept { return out_; };
+
+protected:
+                            Serializer(std::string& out) noexcept : out_(out) {};
+
+    std::string&            out_;
+};
+
+#endif // SERVICE_SERIALIZER_H_INC
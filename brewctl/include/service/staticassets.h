@@ -0,0 +1,66 @@
+#ifndef SERVICE_STATICASSETS_H_INC
+#define SERVICE_STATICASSETS_H_INC
+/*
+    staticassets.h: manifest of the static files (e.g. the web dashboard) served by the HTTP service.  The manifest is
+    built once, at startup, by scanning a directory tree; each file's entity tag is computed then, so that serving a
+    file requires no more than an open() and a sendfile().
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/framework/error.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+extern "C"
+{
+#include <sys/types.h>
+}
+
+
+class StaticAssets
+{
+public:
+    typedef struct File
+    {
+        std::string         path;           // Path of the file in the filesystem
+        std::string         etag;           // Quoted entity tag, derived from the file's size and contents
+        off_t               size;
+        time_t              mtime;
+    } File_t;
+
+    typedef struct Asset
+    {
+        File_t              file;
+        File_t              gzipFile;       // Pre-compressed sibling, <file.path>.gz; valid only if <hasGzip> is true
+        bool                hasGzip;
+        const char *        contentType;
+    } Asset_t;
+
+                            StaticAssets() noexcept;
+                            StaticAssets(const StaticAssets& rhs) = delete;
+                            StaticAssets(StaticAssets&& rhs) = delete;
+
+    StaticAssets&           operator=(const StaticAssets& rhs) = delete;
+    StaticAssets&           operator=(StaticAssets&& rhs) = delete;
+
+    bool                    load(const std::string& root, const std::string& prefix, Error * const err = nullptr)
+                                noexcept;
+    const Asset_t *         find(const std::string_view path) const noexcept;
+    size_t                  size() const noexcept { return assets_.size(); };
+
+    static const char *     contentType(const std::string_view fileName) noexcept;
+
+private:
+    bool                    scan(const std::string& dir, const std::string& urlPath, Error * const err) noexcept;
+    static bool             describe(const std::string& path, File_t& file) noexcept;
+
+    std::map<std::string, Asset_t, std::less<>>
+                            assets_;        // Assets keyed by URL path
+};
+
+#endif // SERVICE_STATICASSETS_H_INC
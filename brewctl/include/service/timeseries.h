@@ -0,0 +1,274 @@
+#ifndef SERVICE_TIMESERIES_H_INC
+#define SERVICE_TIMESERIES_H_INC
+/*
+    timeseries.h: the application/x-brewctl-ts compact time-series format, and a reference decoder.  This header is
+    self-contained, and restricted to C++11, so that it can also be built into the Android app's native library.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+
+
+    Format
+
+    A stream consists of a header followed by any number of blocks.  All multi-byte integers are little-endian.
+
+        Header:     "BTS" (3 bytes), version (u8, = 1), number of value columns N (u8), reserved (3 bytes, = 0)
+        Block:      point count (u32), then N + 1 columns, each a byte count (u32) followed by that many bytes.  The
+                    first column holds the timestamps of the block's points; the rest hold one value per point each.
+
+    Each block is self-contained, so a decoder can stop, or skip a block, at any block boundary.  Columns are bit-
+    streams, most-significant bit first, padded with zero bits to a whole number of bytes.
+
+    Timestamps (int64) are delta-of-delta encoded.  The first timestamp in a block is stored in 64 bits; each subsequent
+    timestamp is stored as D = (t[i] - t[i-1]) - (t[i-1] - t[i-2]), taking t[-1] = t[0], as:
+
+        '0'                     D = 0
+        '10'   + 7-bit value    D in [-63, 64]
+        '110'  + 9-bit value    D in [-255, 256]
+        '1110' + 12-bit value   D in [-2047, 2048]
+        '1111' + 64-bit value   otherwise
+
+    where an n-bit value is stored as D - 1 + 2^(n - 1) (a 64-bit value is stored as D).
+
+    Values (IEEE-754 doubles) are XOR-compressed.  The first value in a block is stored in 64 bits; each subsequent
+    value is XORed with its predecessor, and the result X stored as:
+
+        '0'                     X = 0
+        '10' + bits             X's meaningful (i.e. non-leading-zero, non-trailing-zero) bits lie within the window
+                                of meaningful bits of the last X stored with control bits '11'; these bits are stored
+        '11' + 5-bit leading-zero count L + 6-bit meaningful-bit count M (64 stored as 0) + M meaningful bits
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+
+namespace TimeSeries
+{
+
+static const char * const
+    CONTENT_TYPE    = "application/x-brewctl-ts";
+
+static const uint8_t
+    MAGIC[3]        = {'B', 'T', 'S'},
+    VERSION         = 1;
+
+static const size_t
+    HEADER_SIZE     = 8,
+    MAX_COLUMNS     = 8;            // Max number of value columns
+
+
+// BitReader - reads a bit-stream, most-significant bit first.  Reading beyond the end of the stream sets an error flag
+// and returns zero bits.
+//
+class BitReader
+{
+public:
+    BitReader() : data_(nullptr), len_(0), pos_(0), error_(false) {}
+    BitReader(const uint8_t *data, const size_t len) : data_(data), len_(len), pos_(0), error_(false) {}
+
+    bool error() const { return error_; }
+
+    uint64_t read(unsigned int nbits)
+    {
+        uint64_t val = 0;
+
+        for(; nbits; --nbits)
+        {
+            if(pos_ >= (len_ * 8))
+            {
+                error_ = true;
+                return 0;
+            }
+
+            val = (val << 1) | ((data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1);
+            ++pos_;
+        }
+
+        return val;
+    }
+
+private:
+    const uint8_t * data_;
+    size_t          len_;
+    size_t          pos_;           // Position, in bits
+    bool            error_;
+};
+
+
+// Decoder - decodes an application/x-brewctl-ts stream held in memory.
+//
+class Decoder
+{
+public:
+    Decoder(const uint8_t *data, const size_t len)
+        : data_(data), len_(len), pos_(0), columns_(0), remaining_(0), first_(true), error_(false), t_(0), delta_(0)
+    {
+        if((len < HEADER_SIZE) || ::memcmp(data, MAGIC, sizeof(MAGIC)) || (data[3] != VERSION)
+           || (data[4] > MAX_COLUMNS))
+        {
+            error_ = true;
+            return;
+        }
+
+        columns_ = data[4];
+        pos_ = HEADER_SIZE;
+    }
+
+    bool error() const { return error_; }
+    size_t columns() const { return columns_; }
+
+    // next() - decode the next point into <t> and <values>, which must have room for columns() values.  Returns false
+    // at the end of the stream, or if the stream is malformed (in which case error() returns true).
+    bool next(int64_t& t, double *values)
+    {
+        if(error_ || (!remaining_ && !nextBlock()))
+            return false;
+
+        if(first_)
+        {
+            t_ = (int64_t) ts_.read(64);
+            delta_ = 0;
+
+            for(size_t i = 0; i < columns_; ++i)
+            {
+                col_[i].prev = col_[i].reader.read(64);
+                col_[i].leading = col_[i].meaningful = 0;
+            }
+
+            first_ = false;
+        }
+        else
+        {
+            delta_ += readDeltaOfDelta();
+            t_ += delta_;
+
+            for(size_t i = 0; i < columns_; ++i)
+                readValue(col_[i]);
+        }
+
+        t = t_;
+        for(size_t i = 0; i < columns_; ++i)
+        {
+            ::memcpy(&values[i], &col_[i].prev, sizeof(double));
+            error_ = error_ || col_[i].reader.error();
+        }
+
+        error_ = error_ || ts_.error();
+        --remaining_;
+
+        return !error_;
+    }
+
+private:
+    typedef struct Column
+    {
+        BitReader       reader;
+        uint64_t        prev;
+        unsigned int    leading;
+        unsigned int    meaningful;
+    } Column_t;
+
+    uint32_t readU32()
+    {
+        const uint32_t v = data_[pos_] | (data_[pos_ + 1] << 8) | (data_[pos_ + 2] << 16)
+                           | ((uint32_t) data_[pos_ + 3] << 24);
+        pos_ += 4;
+        return v;
+    }
+
+    // nextBlock() - position the column readers at the start of the next block.  Returns false at the end of the
+    // stream, or if the block is malformed.
+    bool nextBlock()
+    {
+        while(pos_ < len_)
+        {
+            if((len_ - pos_) < 4)
+                return !(error_ = true);
+
+            remaining_ = readU32();
+
+            for(size_t i = 0; i <= columns_; ++i)
+            {
+                if((len_ - pos_) < 4)
+                    return !(error_ = true);
+
+                const uint32_t n = readU32();
+                if(n > (len_ - pos_))
+                    return !(error_ = true);
+
+                if(i)
+                    col_[i - 1].reader = BitReader(data_ + pos_, n);
+                else
+                    ts_ = BitReader(data_ + pos_, n);
+
+                pos_ += n;
+            }
+
+            first_ = true;
+            if(remaining_)
+                return true;
+        }
+
+        return false;
+    }
+
+    int64_t readDeltaOfDelta()
+    {
+        if(!ts_.read(1))
+            return 0;
+
+        unsigned int nbits = 64;
+        if(!ts_.read(1))
+            nbits = 7;
+        else if(!ts_.read(1))
+            nbits = 9;
+        else if(!ts_.read(1))
+            nbits = 12;
+
+        const uint64_t v = ts_.read(nbits);
+
+        return (nbits == 64) ? (int64_t) v : (int64_t) v + 1 - ((int64_t) 1 << (nbits - 1));
+    }
+
+    void readValue(Column_t& c)
+    {
+        if(!c.reader.read(1))
+            return;
+
+        if(c.reader.read(1))
+        {
+            c.leading = c.reader.read(5);
+            c.meaningful = c.reader.read(6);
+            if(!c.meaningful)
+                c.meaningful = 64;
+        }
+
+        // A '10' value requires a window set by an earlier '11' value in the block
+        if(!c.meaningful || (c.leading + c.meaningful > 64))
+        {
+            error_ = true;
+            return;
+        }
+
+        c.prev ^= c.reader.read(c.meaningful) << (64 - c.leading - c.meaningful);
+    }
+
+    const uint8_t * data_;
+    size_t          len_;
+    size_t          pos_;
+    size_t          columns_;
+    uint32_t        remaining_;     // Points remaining in the current block
+    bool            first_;         // True if the next point is the first in its block
+    bool            error_;
+    BitReader       ts_;
+    Column_t        col_[MAX_COLUMNS];
+    int64_t         t_;
+    int64_t         delta_;
+};
+
+} // namespace TimeSeries
+
+#endif // SERVICE_TIMESERIES_H_INC
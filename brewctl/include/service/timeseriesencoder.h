@@ -0,0 +1,72 @@
+#ifndef SERVICE_TIMESERIESENCODER_H_INC
+#define SERVICE_TIMESERIESENCODER_H_INC
+/*
+    timeseriesencoder.h: encodes time series in the application/x-brewctl-ts format (see timeseries.h).  Points are
+    accumulated into per-column bit-streams, and appended to a caller-owned output buffer a block at a time.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/timeseries.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+class TimeSeriesEncoder
+{
+public:
+    static const size_t         BLOCK_POINTS = 256;     // Number of points in each block (except the last)
+
+                                TimeSeriesEncoder(std::string& out, const size_t columns) noexcept;
+                                TimeSeriesEncoder(const TimeSeriesEncoder& rhs) = delete;
+                                TimeSeriesEncoder(TimeSeriesEncoder&& rhs) = delete;
+
+    TimeSeriesEncoder&          operator=(const TimeSeriesEncoder& rhs) = delete;
+    TimeSeriesEncoder&          operator=(TimeSeriesEncoder&& rhs) = delete;
+
+    void                        header() noexcept;
+    void                        add(const int64_t t, const double *values) noexcept;
+    void                        flush() noexcept;
+
+    size_t                      columns() const noexcept { return columns_; };
+
+private:
+    class BitWriter
+    {
+    public:
+                                BitWriter() noexcept : cur_(0), used_(0) {};
+
+        void                    write(const uint64_t val, unsigned int nbits) noexcept;
+        void                    appendTo(std::string& out) noexcept;
+
+    private:
+        std::string             bytes_;
+        uint8_t                 cur_;               // Partially-filled byte
+        unsigned int            used_;              // Number of bits used in <cur_>
+    };
+
+    typedef struct Column
+    {
+        BitWriter               bits;
+        uint64_t                prev;
+        unsigned int            leading;
+        unsigned int            meaningful;         // 0 if no window of meaningful bits has been stored yet
+    } Column_t;
+
+    void                        writeTimestamp(const int64_t t) noexcept;
+    void                        writeValue(Column_t& c, const double value) noexcept;
+    static void                 appendU32(std::string& out, const uint32_t val) noexcept;
+
+    std::string&                out_;
+    size_t                      columns_;
+    uint32_t                    count_;             // Number of points in the current block
+    BitWriter                   ts_;
+    int64_t                     prevT_;
+    int64_t                     prevDelta_;
+    Column_t                    col_[TimeSeries::MAX_COLUMNS];
+};
+
+#endif // SERVICE_TIMESERIESENCODER_H_INC
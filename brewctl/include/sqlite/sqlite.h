@@ -32,6 +32,10 @@ public:
     bool            isOpen() const noexcept { return db_ != nullptr; };
     bool            prepare(const std::string& sql, SQLiteStmt& stmt, Error * const err = nullptr) noexcept;
     bool            prepareAndStep(const std::string& sql, SQLiteStmt& stmt, Error * const err = nullptr) noexcept;
+    bool            exec(const std::string& sql, Error * const err = nullptr) noexcept;
+    long long       lastInsertId() noexcept;
+    const std::string&
+                    path() const noexcept { return path_; };
 
 private:
     void            fmtErr(Error * const err, const int code) noexcept;
@@ -0,0 +1,90 @@
+#ifndef UTIL_MPSCQUEUE_H_INC
+#define UTIL_MPSCQUEUE_H_INC
+/*
+    mpscqueue.h: unbounded, lock-free, multiple-producer single-consumer queue.  This is Dmitry Vyukov's node-based
+    MPSC queue: a push is a single atomic exchange plus a store, and a pop never touches any shared variable other than
+    the link it reads.  Producers never wait for one another or for the consumer.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <atomic>
+#include <utility>
+
+
+namespace Util
+{
+
+template<typename T> class MPSCQueue
+{
+public:
+                            MPSCQueue() noexcept
+                                : head_(nullptr), tail_(new Node())
+                            {
+                                head_.store(tail_, std::memory_order_relaxed);
+                            };
+
+                            ~MPSCQueue() noexcept
+                            {
+                                T discard;
+                                while(pop(discard))
+                                    ;
+
+                                delete tail_;
+                            };
+
+                            MPSCQueue(const MPSCQueue& rhs) = delete;
+                            MPSCQueue(MPSCQueue&& rhs) = delete;
+
+    MPSCQueue&              operator=(const MPSCQueue& rhs) = delete;
+    MPSCQueue&              operator=(MPSCQueue&& rhs) = delete;
+
+    // push() - append <val> to the queue.  May be called concurrently from any number of threads.
+    //
+    void                    push(T&& val) noexcept
+                            {
+                                Node * const node = new Node(std::move(val));
+                                Node * const prev = head_.exchange(node, std::memory_order_acq_rel);
+
+                                // Between the exchange and this store, the queue is briefly "broken": the consumer
+                                // will see it as empty at <prev> until the link is published.
+                                prev->next.store(node, std::memory_order_release);
+                            };
+
+    // pop() - remove the item at the front of the queue, and move it into <val>.  Returns false if the queue is empty.
+    // Must only be called from the single consumer thread.
+    //
+    bool                    pop(T& val) noexcept
+                            {
+                                Node * const tail = tail_;
+                                Node * const next = tail->next.load(std::memory_order_acquire);
+
+                                if(next == nullptr)
+                                    return false;
+
+                                val = std::move(next->value);
+                                tail_ = next;
+                                delete tail;
+
+                                return true;
+                            };
+
+private:
+    typedef struct Node
+    {
+                            Node() noexcept : next(nullptr), value() {};
+                            Node(T&& val) noexcept : next(nullptr), value(std::move(val)) {};
+
+        std::atomic<Node *> next;
+        T                   value;
+    } Node;
+
+    std::atomic<Node *>     head_;      // Most recently pushed node; shared by producers
+    Node *                  tail_;      // Node preceding the front of the queue; owned by the consumer
+};
+
+} // namespace Util
+
+#endif // UTIL_MPSCQUEUE_H_INC
@@ -12,12 +12,21 @@
 #include <string>
 #include <vector>
 
+extern "C"
+{
+#include <sys/types.h>
+}
+
 
 namespace Util::Net
 {
     std::vector<std::string>    getInterfaceNames() noexcept;
     uint64_t                    getInterfaceHardwareAddress(const std::string& interface) noexcept;
     uint64_t                    getRandomHardwareAddress() noexcept;
+    int                         listenUnix(const std::string& path, const mode_t mode, const int backlog,
+                                           Error * const err = nullptr) noexcept;
+    int                         connectUnix(const std::string& path, Error * const err = nullptr) noexcept;
+    bool                        peerCredentials(const int fd, uid_t& uid, gid_t& gid) noexcept;
 } // namespace Util::Net
 
 #endif // UTIL_NET_H_INC
@@ -0,0 +1,99 @@
+#ifndef UTIL_RCUPTR_H_INC
+#define UTIL_RCUPTR_H_INC
+/*
+    rcuptr.h: a shared_ptr to an immutable object, which a single writer replaces from time to time and any number of
+    readers copy, read-copy-update style.  A read is wait-free: two atomic increments, a load and a decrement, with no
+    lock and no allocation (unlike std::atomic_load() on a shared_ptr, which in libstdc++ takes a mutex from a global
+    pool).  Replaced ptrs are retired, and destroyed by a later update once no reader can still be copying them.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+namespace Util
+{
+
+template<typename T> class RCUPtr
+{
+public:
+    typedef std::shared_ptr<const T> sptr_t;
+
+                            RCUPtr(T * const initial) noexcept
+                                : current_(new Slot{sptr_t(initial)}), readers_(0)
+                            {
+                            };
+
+                            ~RCUPtr() noexcept
+                            {
+                                for(auto slot : retired_)
+                                    delete slot;
+
+                                delete current_.load();
+                            };
+
+                            RCUPtr(const RCUPtr& rhs) = delete;
+                            RCUPtr(RCUPtr&& rhs) = delete;
+
+    RCUPtr&                 operator=(const RCUPtr& rhs) = delete;
+    RCUPtr&                 operator=(RCUPtr&& rhs) = delete;
+
+    // load() - return the current object.  May be called concurrently from any number of threads.  The returned object
+    // remains valid for as long as the caller holds the ptr.
+    //
+    sptr_t                  load() const noexcept
+                            {
+                                // While <readers_> is non-zero, the writer will not destroy any retired slot, so the
+                                // slot loaded here outlives the copy of its ptr.
+                                ++readers_;
+                                sptr_t ret = current_.load()->ptr;
+                                --readers_;
+
+                                return ret;
+                            };
+
+    // store() - take ownership of <obj>, which must not be modified after this call, and make it the current object.
+    // Readers holding the previous object continue to see it, unchanged; it is freed when the last of them lets go.
+    // Must only be called from the single writer thread.
+    //
+    void                    store(T * const obj) noexcept
+                            {
+                                retired_.push_back(current_.exchange(new Slot{sptr_t(obj)}));
+                                reclaim();
+                            };
+
+private:
+    typedef struct Slot
+    {
+        sptr_t              ptr;
+    } Slot;
+
+    // reclaim() - destroy retired slots, if no reader is copying a ptr.  A reader which loaded a retired slot did so
+    // after incrementing <readers_>, so if the count is zero now, that reader has finished with the slot.  Otherwise
+    // the slots are kept until a later update.
+    //
+    void                    reclaim() noexcept
+                            {
+                                if(readers_.load())
+                                    return;
+
+                                for(auto slot : retired_)
+                                    delete slot;
+
+                                retired_.clear();
+                            };
+
+    std::atomic<Slot *>     current_;
+    mutable std::atomic<int>
+                            readers_;   // Number of readers currently copying the ptr from a slot
+    std::vector<Slot *>     retired_;   // Replaced slots, awaiting destruction; owned by the writer
+};
+
+} // namespace Util
+
+#endif // UTIL_RCUPTR_H_INC
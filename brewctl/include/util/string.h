@@ -8,6 +8,7 @@
     Part of brewctl
 */
 
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -16,6 +17,7 @@ namespace Util::String
 {
     bool            isIntStr(const std::string& str, int* intVal = nullptr) noexcept;
     std::string     numberToString(const int& num) noexcept;
+    bool            nextQualityItem(const std::string& list, size_t& pos, std::string& item, double& q) noexcept;
 } // namespace Util::String
 
 #endif // UTIL_STRING_H_INC
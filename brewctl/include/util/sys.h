@@ -17,9 +17,11 @@ namespace Util::Sys
 {
     bool        daemonise(Error * const err = nullptr) noexcept;
     uid_t       getUid(const std::string& username, Error * const err = nullptr) noexcept;
+    gid_t       getGid(const std::string& groupname, Error * const err = nullptr) noexcept;
     bool        setUid(const std::string& username, Error * const err = nullptr) noexcept;
     int         readPidFile(const std::string& filename, Error * const err = nullptr) noexcept;
     bool        writePidFile(const std::string& filename, Error * const err = nullptr) noexcept;
+    double      monotonicTime() noexcept;
 } // namespace Util::Sys
 
 #endif // SYS_H_INC
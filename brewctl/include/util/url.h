@@ -1,15 +1,19 @@
 #ifndef UTIL_URL_H_INC
 #define UTIL_URL_H_INC
 /*
-    url.h: provides class URL, which processes a URL string.
+    url.h: provides class URL, which processes a URL string.  A URL refers to, but does not copy, the string from which
+    it is parsed, so the string must outlive it.  Query arguments are held in a flat array, and are URL-decoded only
+    when looked up, into an arena within the object; parsing a URL therefore allocates no memory.
 
     Stuart Wallace <stuartw@atom.net>, November 2017.
 
     Part of brewctl
 */
 
-#include <map>
+#include <cstddef>
+#include <forward_list>
 #include <string>
+#include <string_view>
 
 
 namespace Util
@@ -18,35 +22,62 @@ namespace Util
 class URL
 {
 public:
-const int NO_PORT_SPECIFIED = -1;
-typedef std::map<std::string, std::string> URLQueryArgMap_t;
+static const int NO_PORT_SPECIFIED = -1;
+static const size_t MAX_ARGS = 16;          // Max number of query args; any further args are ignored
+static const size_t ARENA_SIZE = 256;       // Size of the buffer into which query args are decoded
 
-                        URL() = default;
-                        URL(std::string url) noexcept;
+                        URL() noexcept;
+                        URL(const std::string_view url) noexcept;
+                        URL(const URL& rhs) = delete;
+                        URL(URL&& rhs) = delete;
 
-    std::string         protocol() const noexcept { return protocol_; };
-    std::string         address() const noexcept { return address_; };
+    URL&                operator=(const URL& rhs) = delete;
+    URL&                operator=(URL&& rhs) = delete;
+
+    std::string_view    protocol() const noexcept { return protocol_; };
+    std::string_view    address() const noexcept { return address_; };
     int                 port() const noexcept { return port_; };
-    std::string         path() const noexcept { return path_; };
-    std::string         anchor() const noexcept { return anchor_; };
+    std::string_view    path() const noexcept { return path_; };
+    std::string_view    anchor() const noexcept { return anchor_; };
 
-    URLQueryArgMap_t&   args() noexcept { return args_; };
-    bool                argExists(const std::string& key) const noexcept { return args_.find(key) != args_.end(); };
+    size_t              argCount() const noexcept { return numArgs_; };
+    bool                argExists(const std::string_view key) noexcept { return findArg(key) != nullptr; };
+    std::string_view    arg(const std::string_view key) noexcept;
+    bool                argInt(const std::string_view key, long long& val) noexcept;
+    size_t              argValues(const std::string_view key, std::string_view *values, const size_t max) noexcept;
+    bool                addArg(const std::string_view key, const std::string_view value, const bool decoded = false)
+                            noexcept;
 
-    URL&                parseURL(std::string url) noexcept;
+    URL&                parseURL(const std::string_view url) noexcept;
+    URL&                setPath(const std::string_view path) noexcept;
 
-    static std::string  decode(const std::string& str) noexcept;
+    static size_t       decode(const std::string_view str, char *out) noexcept;
 
 private:
-    std::string         protocol_;
-    std::string         address_;
+    typedef struct Arg
+    {
+        std::string_view    key;
+        std::string_view    value;
+        bool                keyDecoded;
+        bool                valueDecoded;
+    } Arg_t;
+
+    const Arg_t *       findArg(const std::string_view key) noexcept;
+    std::string_view    decoded(std::string_view& str, bool& isDecoded) noexcept;
+
+    std::string_view    protocol_;
+    std::string_view    address_;
     int                 port_;
-    std::string         path_;
-    std::string         anchor_;
-    URLQueryArgMap_t    args_;
+    std::string_view    path_;
+    std::string_view    anchor_;
+    Arg_t               args_[MAX_ARGS];
+    size_t              numArgs_;
+    char                arena_[ARENA_SIZE];
+    size_t              arenaUsed_;
+    std::forward_list<std::string>
+                        overflow_;      // Decoded args which did not fit in the arena
 };
 
 } // namespace Util
 
 #endif // UTIL_URL_H_INC
-
@@ -0,0 +1,75 @@
+#ifndef UTIL_WINDOWEDAGGREGATE_H_INC
+#define UTIL_WINDOWEDAGGREGATE_H_INC
+/*
+    windowedaggregate.h: sliding-window aggregates (mean, min, max, variance) over a stream of weighted samples.  The
+    window is divided into a fixed number of buckets; adding a sample touches only the current bucket, and expired
+    buckets are folded out as the window slides, so the cost per sample is O(1) regardless of the window length.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace Util
+{
+
+class WindowedAggregate
+{
+public:
+                            WindowedAggregate(const double window = 60.0, const size_t nbuckets = DEFAULT_BUCKETS)
+                                noexcept;
+
+    void                    add(const double now, const double value, const double weight = 1.0) noexcept;
+    void                    advance(const double now) noexcept;
+    void                    reset() noexcept;
+
+    double                  window() const noexcept { return window_; };
+    double                  weight() const noexcept { return weight_; };
+    double                  coverage(const double now) const noexcept;
+    bool                    full(const double now) const noexcept { return coverage(now) >= window_; };
+
+    double                  last() const noexcept { return last_; };
+    double                  mean() const noexcept;
+    double                  min() const noexcept { return min_; };
+    double                  max() const noexcept { return max_; };
+    double                  variance() const noexcept;
+
+    static const size_t     DEFAULT_BUCKETS = 60;
+
+private:
+    typedef struct Bucket
+    {
+        double              weight;
+        double              sum;            // Sums are of (value - ref_), to limit cancellation in variance()
+        double              sumSq;
+        double              min;
+        double              max;
+    } Bucket_t;
+
+    void                    clearBucket(Bucket_t& bucket) noexcept;
+    void                    recompute() noexcept;
+
+    double                  window_;
+    double                  bucketLen_;
+    std::vector<Bucket_t>   buckets_;
+    int64_t                 current_;       // Absolute index of the current bucket, i.e. floor(time / bucketLen_)
+    double                  start_;         // Time of the earliest sample still in the window; <0 if empty
+    double                  ref_;
+    double                  last_;
+
+    // Totals over all buckets in the window
+    double                  weight_;
+    double                  sum_;
+    double                  sumSq_;
+    double                  min_;
+    double                  max_;
+};
+
+} // namespace Util
+
+#endif // UTIL_WINDOWEDAGGREGATE_H_INC
@@ -51,18 +51,14 @@ time_t DefaultEffector::lastActiveDuration() const noexcept
 }
 
 
-// logState() - log the effector's current state in the "effectorlog" database table.  Returns true on success, false
-// otherwise.
+// logState() - publish the effector's current state to the telemetry bus; the telemetry logger writes it to the
+// "effectorlog" database table.  Returns true on success, false if the record could not be published.
 //
 bool DefaultEffector::logState(Error * const err) const noexcept
 {
-    SQLiteStmt effectorLog;
+    (void) err;         // Suppress arg-not-used warning
 
-    if(!Registry::instance().db().prepare("INSERT INTO effectorlog(effector_id, newstate) "
-                                          "VALUES(:effectorId, :newState)", effectorLog, err) ||
-       !effectorLog.bind(":effectorId", channel_, err) ||
-       !effectorLog.bind(":newState", state_, err) ||
-       !effectorLog.execute(err))
+    if(!Registry::instance().telemetry().publishEffectorTransition(channel_, state_, powerConsumption_))
     {
         logWarning("Failed to log effector %d transition to state '%s'", channel_, state_ ? "on" : "off");
         return false;
@@ -70,4 +66,3 @@ bool DefaultEffector::logState(Error * const err) const noexcept
 
     return true;
 }
-
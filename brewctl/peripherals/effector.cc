@@ -23,6 +23,11 @@ Effector::Effector(const int channel, const double powerConsumption, const strin
     : DefaultEffector(channel, name, powerConsumption)
 {
     logDebug("instantiating effector on channel %d with power consumption %.3fW", channel, powerConsumption);
+
+    // When taking over from a previous instance of the application, the effector may already be on
+    auto& registry = Registry::instance();
+    if(registry.handoff() != nullptr)
+        state_ = registry.sr().read() & (1 << (EFFECTOR_BIT_OFFSET + channel));
 }
 
 
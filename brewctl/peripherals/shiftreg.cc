@@ -88,6 +88,16 @@ bool ShiftReg::init(Error * const err) noexcept
 }
 
 
+// adopt() - mark the shift register as initialised, and holding <val>, without writing to it.  Used when taking over
+// from a previous instance of the application, which left <val> latched on the outputs.
+//
+void ShiftReg::adopt(const uint16_t val) noexcept
+{
+    currentVal_ = val;
+    ready_ = true;
+}
+
+
 // strobeRegClk() - strobe the RCLK pin of the 74xx595.  This has the effect of transferring to the output pins the last
 // eight bits received in the register.
 //
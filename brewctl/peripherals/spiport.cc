@@ -58,9 +58,10 @@ typedef enum SPIPin
 
 // ctor - note that we can't use Registry members here; instead we must take explicit args for objects which are
 // normally read from the registry.  This is because the SPI port is normally init'ed from within the Registry ctor,
-// hence we wouldn't be able to obtain a registry instance here.
+// hence we wouldn't be able to obtain a registry instance here.  If <inheritedFd> is not -1, it is an SPI device fd
+// inherited from a previous instance of the application (see Handoff), and is used instead of opening the device.
 //
-SPIPort::SPIPort(GPIOPort& gpio, Config& config, Error * const err) noexcept
+SPIPort::SPIPort(GPIOPort& gpio, Config& config, Error * const err, const int inheritedFd) noexcept
     : fd_(0),
       mode_(0),
       bpw_(0),
@@ -71,7 +72,9 @@ SPIPort::SPIPort(GPIOPort& gpio, Config& config, Error * const err) noexcept
         if(!gpio.pin(pin).setMode(PIN_ALT0, err))
             return;
 
-    fd_ = ::open(config.get<string>("spi.dev", SPI_DEFAULT_DEVICE, Validator::notEmpty).c_str(), O_RDWR);
+    fd_ = (inheritedFd != -1) ? inheritedFd
+                              : ::open(config.get<string>("spi.dev", SPI_DEFAULT_DEVICE, Validator::notEmpty).c_str(),
+                                       O_RDWR);
 
     ::bzero(&xfer_, sizeof(xfer_));
 
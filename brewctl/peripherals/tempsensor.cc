@@ -11,7 +11,9 @@
 #include "include/framework/registry.h"
 #include "include/peripherals/tempsensor.h"
 #include "include/sqlite/sqlitestmt.h"
+#include "include/util/sys.h"
 #include "include/util/validator.h"
+#include <cmath>
 #include <string>
 
 using std::lock_guard;
@@ -22,19 +24,38 @@ namespace Validator = Util::Validator;
 
 static const int 
     DEFAULT_MOVING_AVERAGE_LEN  = 1000,     // Default length of moving average for sensor readings
-    DEFAULT_LOG_INTERVAL_S      = 60;       // Default interval between temp-sensor log writes, in seconds
+    DEFAULT_LOG_INTERVAL_S      = 60,       // Default interval between temp-sensor log writes, in seconds
+    DEFAULT_PUBLISH_INTERVAL_MS = 1000,     // Default interval between publications of samples to the telemetry bus
+    DEFAULT_MIN_SAMPLE_INT_MS   = 10,       // Default min interval between ADC reads (i.e. the control-loop period)
+    DEFAULT_MAX_SAMPLE_INT_MS   = 2000,     // Default max interval between ADC reads
+    DEFAULT_MIN_LOG_INTERVAL_S  = 5;        // Default min interval between temp-sensor log writes, in seconds
 
+static const double
+    DEFAULT_RESOLUTION_C        = 0.05,     // Default temperature change which sampling/logging aims to resolve
+    NEAR_SETPOINT_BAND_C        = 1.0,      // Within this distance of the setpoint, sampling speeds up
+    RATE_FILTER_S               = 30.0;     // Time constant of the low-pass filter applied to the rate of change
 
-TempSensor::TempSensor(const int thermistor_id, const int channel, Error * const err) noexcept
+
+TempSensor::TempSensor(const int thermistor_id, const int channel, const int sessionId, Error * const err) noexcept
     : DefaultTempSensor(channel, "TempSensor"),
       thermistor_(nullptr),
+      sessionId_(sessionId),
       avglen_(0),
       nsamples_(0),
       currentTemp_(0.0, TEMP_UNIT_CELSIUS),
       rangeMin_(0.0, TEMP_UNIT_KELVIN),
       rangeMax_(1000.0, TEMP_UNIT_KELVIN),
       lastLogWriteTime_(0),
-      logInterval_(0)
+      logInterval_(0),
+      lastPublishTime_(0),
+      publishInterval_(0),
+      rate_(0.0),
+      lastSampleTime_(-1.0),
+      sampleInterval_(DEFAULT_MIN_SAMPLE_INT_MS / 1000.0),
+      minSampleInterval_(DEFAULT_MIN_SAMPLE_INT_MS / 1000.0),
+      maxSampleInterval_(DEFAULT_MAX_SAMPLE_INT_MS / 1000.0),
+      resolution_(DEFAULT_RESOLUTION_C),
+      minLogInterval_(DEFAULT_MIN_LOG_INTERVAL_S)
 {
     // Initialise: read sensor data from the database
     SQLite& db = Registry::instance().db();
@@ -78,6 +99,20 @@ TempSensor::TempSensor(const int thermistor_id, const int channel, Error * const
 
     avglen_ = config.get("sensor.average_len", DEFAULT_MOVING_AVERAGE_LEN, Validator::gt0);
     logInterval_ = config.get("sensor.log_interval_s", DEFAULT_LOG_INTERVAL_S, Validator::gt0);
+    publishInterval_ = config.get("sensor.publish_interval_ms", DEFAULT_PUBLISH_INTERVAL_MS, Validator::gt0);
+
+    minSampleInterval_ = config.get("sensor.min_sample_interval_ms", DEFAULT_MIN_SAMPLE_INT_MS, Validator::gt0)
+                            / 1000.0;
+    maxSampleInterval_ = config.get("sensor.max_sample_interval_ms", DEFAULT_MAX_SAMPLE_INT_MS, Validator::gt0)
+                            / 1000.0;
+    if(maxSampleInterval_ < minSampleInterval_)
+        maxSampleInterval_ = minSampleInterval_;
+
+    sampleInterval_ = minSampleInterval_;
+    resolution_ = config.get("sensor.resolution_c", DEFAULT_RESOLUTION_C, Validator::gt0);
+    minLogInterval_ = config.get("sensor.min_log_interval_s", DEFAULT_MIN_LOG_INTERVAL_S, Validator::gt0);
+    if(minLogInterval_ > logInterval_)
+        minLogInterval_ = logInterval_;
 }
 
 
@@ -109,6 +144,7 @@ void TempSensor::move(TempSensor& rhs) noexcept
 {
     channel_            = rhs.channel_;
     thermistor_         = rhs.thermistor_;
+    sessionId_          = rhs.sessionId_;
     avglen_             = rhs.avglen_;
     nsamples_           = rhs.nsamples_;
     Idrive_             = rhs.Idrive_;
@@ -118,9 +154,20 @@ void TempSensor::move(TempSensor& rhs) noexcept
     rangeMax_           = rhs.rangeMax_;
     lastLogWriteTime_   = rhs.lastLogWriteTime_;
     logInterval_        = rhs.logInterval_;
+    lastPublishTime_    = rhs.lastPublishTime_;
+    publishInterval_    = rhs.publishInterval_;
+    setpoint_           = rhs.setpoint_;
+    rate_               = rhs.rate_;
+    lastSampleTime_     = rhs.lastSampleTime_;
+    sampleInterval_     = rhs.sampleInterval_;
+    minSampleInterval_  = rhs.minSampleInterval_;
+    maxSampleInterval_  = rhs.maxSampleInterval_;
+    resolution_         = rhs.resolution_;
+    minLogInterval_     = rhs.minLogInterval_;
 
     rhs.channel_            = -1;
     rhs.thermistor_         = nullptr;
+    rhs.sessionId_          = 0;
     rhs.avglen_             = 0;
     rhs.Idrive_             = 0.0;
     rhs.nsamples_           = 0;
@@ -130,6 +177,11 @@ void TempSensor::move(TempSensor& rhs) noexcept
     rhs.rangeMax_           = Temperature(0.0, TEMP_UNIT_KELVIN);
     rhs.lastLogWriteTime_   = 0;
     rhs.logInterval_        = 0;
+    rhs.lastPublishTime_    = 0;
+    rhs.publishInterval_    = 0;
+    rhs.setpoint_           = Temperature();
+    rhs.rate_               = 0.0;
+    rhs.lastSampleTime_     = -1.0;
 }
 
 
@@ -137,27 +189,125 @@ void TempSensor::move(TempSensor& rhs) noexcept
 // moving-average value through <T>.  Return the current moving-average temperature value on success, or a temperature
 // value representing absolute zero on error.
 //
+// The ADC is only read if the current (adaptive) sample interval has elapsed since the last read; otherwise the
+// current moving-average value is returned immediately.  Because reads are not evenly spaced, the weight given to each
+// new sample is scaled by the time elapsed since the previous one: a sample taken after k nominal (minimum) sample
+// intervals has the weight of k consecutive samples, i.e. alpha = 1 - (1 - 1/n)^k.  This keeps the filter's time
+// constant independent of the sample rate.
+//
 Temperature TempSensor::sense(Error * const err) noexcept
 {
     lock_guard<mutex> lock(lock_);
 
+    const double now = Util::Sys::monotonicTime();
+
+    if((lastSampleTime_ >= 0.0) && ((now - lastSampleTime_) < sampleInterval_))
+        return currentTemp_;
+
     const double voltage = readRaw(err);
     if(voltage < 0.0)
-        return Temperature();       
+        return Temperature();
 
     const Temperature sample = thermistor_->T(voltage / Registry::instance().adc().isource());
+    const double dt = (lastSampleTime_ >= 0.0) ? now - lastSampleTime_ : minSampleInterval_,
+                 prevTempCelsius = currentTemp_.C();
+    double alpha;
+
     if(nsamples_ < avglen_)
-        ++nsamples_;
+        alpha = 1.0 / ++nsamples_;
+    else
+        alpha = 1.0 - ::pow(1.0 - (1.0 / avglen_), dt / minSampleInterval_);
 
-    const double tempCelsius = currentTemp_.C() + ((sample.C() - currentTemp_.C()) / nsamples_);
+    const double tempCelsius = prevTempCelsius + ((sample.C() - prevTempCelsius) * alpha);
+
+    if(nsamples_ > 1)
+        rate_ += (((tempCelsius - prevTempCelsius) / dt) - rate_) * (dt / (RATE_FILTER_S + dt));
 
     currentTemp_.set(tempCelsius, TEMP_UNIT_CELSIUS);
-    writeTempLog();
+    lastSampleTime_ = now;
+
+    adaptSampleInterval();
+    publishSample();
 
     return currentTemp_;
 }
 
 
+// setSetpoint() - inform the sensor of the temperature which its vessel is being controlled towards, so that it can
+// sample more quickly as the temperature approaches the setpoint.  A zero temperature indicates "no setpoint".
+//
+void TempSensor::setSetpoint(const Temperature& setpoint) noexcept
+{
+    setpoint_ = setpoint;
+}
+
+
+// getState() - capture the sensor's filter state into <state>, for checkpointing.  Returns false if the filter holds
+// no samples.
+//
+bool TempSensor::getState(TempSensorState_t& state) noexcept
+{
+    lock_guard<mutex> lock(lock_);
+
+    if(!nsamples_)
+        return false;
+
+    state.channel = channel_;
+    state.nsamples = nsamples_;
+    state.tempC = currentTemp_.C();
+    state.rate = rate_;
+
+    return true;
+}
+
+
+// setState() - restore the sensor's filter state from a checkpoint, so that readings are trustworthy immediately rather
+// than after <avglen_> samples.  Returns false, leaving the filter untouched, if <state> belongs to a different channel
+// or is implausible.
+//
+bool TempSensor::setState(const TempSensorState_t& state) noexcept
+{
+    lock_guard<mutex> lock(lock_);
+
+    if((state.channel != channel_) || (state.nsamples <= 0) || !std::isfinite(state.tempC)
+       || !std::isfinite(state.rate))
+        return false;
+
+    const Temperature temp(state.tempC, TEMP_UNIT_CELSIUS);
+    if((temp < rangeMin_) || (temp > rangeMax_))
+        return false;
+
+    nsamples_ = (state.nsamples < avglen_) ? state.nsamples : avglen_;
+    currentTemp_ = temp;
+    rate_ = state.rate;
+    lastSampleTime_ = -1.0;
+
+    return true;
+}
+
+
+// adaptSampleInterval() - choose the interval until the next ADC read from the signal's dynamics.  The interval is
+// the time the (filtered) temperature takes to change by <resolution_> at its current rate, shortened in proportion as
+// the temperature nears the setpoint, and clamped to the configured min/max intervals.  A tank sitting at serving
+// temperature is therefore sampled at the maximum interval, while a crash-cool is sampled at up to the loop rate.
+//
+void TempSensor::adaptSampleInterval() noexcept
+{
+    const double absRate = ::fabs(rate_);
+    double interval = (absRate > 0.0) ? resolution_ / absRate : maxSampleInterval_;
+
+    if(setpoint_)
+    {
+        const double distance = ::fabs(currentTemp_.C() - setpoint_.C());
+        if(distance < NEAR_SETPOINT_BAND_C)
+            interval = std::fmin(interval, minSampleInterval_
+                                           + ((maxSampleInterval_ - minSampleInterval_) * distance / NEAR_SETPOINT_BAND_C));
+    }
+
+    sampleInterval_ = std::fmin(maxSampleInterval_, std::fmax(minSampleInterval_, interval));
+}
+
+
 // inRange() - return bool indicating whether the current sampled temperature is within the sensing range of this
 // object's thermistor.
 //
@@ -190,7 +340,8 @@ DefaultTempSensor_uptr_t TempSensor::getTempSensor(const int sessionId, const st
     else
     {
         logDebug("returning TempSensor for role %s on channel %d", role.c_str(), tempSensor["channel"].get<int>());
-        ret = new TempSensor(tempSensor["thermistor_id"].get<int>(), tempSensor["channel"].get<int>(), err);
+        ret = new TempSensor(tempSensor["thermistor_id"].get<int>(), tempSensor["channel"].get<int>(), sessionId,
+                             err);
     }
 
     if(ret == nullptr)
@@ -226,24 +377,31 @@ double TempSensor::readRaw(Error * const err) noexcept
 }
 
 
-// writeTempLog() - if enough time has passed since the last temperature reading was written to the temperature log,
-// write the current reading to the log.  Swallow any errors that occur.
+// publishSample() - if enough time has passed since the last sample was published, publish the current filtered
+// reading to the telemetry bus.  Samples are flagged for persistence, i.e. for writing to the temperature log by the
+// telemetry logger, at the log interval.  Like the sample interval, the log interval adapts to the rate of change of
+// temperature: it is the time taken to change by <resolution_>, clamped between the min log interval and the
+// configured (max) log interval.  Out-of-range readings are not published.
 //
-void TempSensor::writeTempLog()
+void TempSensor::publishSample() noexcept
 {
-    const time_t now = ::time(NULL);
+    if(!inRange())
+        return;
 
-    if(logInterval_ && inRange() && ((now - lastLogWriteTime_) >= logInterval_))
+    const time_t now = ::time(NULL);
+    const int64_t nowMs = TelemetryBus::now();
+    const double absRate = ::fabs(rate_);
+    const time_t logInterval = (absRate > 0.0)
+                                ? (time_t) std::fmin(logInterval_, std::fmax(minLogInterval_, resolution_ / absRate))
+                                : logInterval_;
+    const bool persist = logInterval_ && ((now - lastLogWriteTime_) >= logInterval);
+
+    if(persist || ((nowMs - lastPublishTime_) >= publishInterval_))
     {
-        SQLiteStmt logStmt;
+        Registry::instance().telemetry().publishSensorSample(channel_, sessionId_, currentTemp_.C(), persist);
 
-        Registry::instance().db().prepare("INSERT INTO temperature(date_create, sensor_id, temperature) "
-                                          "VALUES(CURRENT_TIMESTAMP, :sensor_id, :temperature)", logStmt)
-        && logStmt.bind(":sensor_id", channel_)
-        && logStmt.bind(":temperature", currentTemp_.C())
-        && logStmt.execute();
-
-        lastLogWriteTime_ = now;
+        lastPublishTime_ = nowMs;
+        if(persist)
+            lastLogWriteTime_ = now;
     }
 }
-
@@ -1,8 +1,47 @@
+--
+-- alarm
+--
+DROP TABLE IF EXISTS "alarm";
+CREATE TABLE "alarm"(
+    id                  INTEGER PRIMARY KEY NOT NULL,
+    rule_id             INT UNSIGNED NOT NULL,
+    date_raised         DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    date_cleared        DATETIME DEFAULT NULL,
+    value               DOUBLE NOT NULL);
+
+DROP INDEX IF EXISTS alarm_rule_id_date_cleared;
+CREATE INDEX alarm_rule_id_date_cleared
+    ON "alarm"(rule_id, date_cleared);
+
+--
+-- alarmrule
+--
+-- metric:    "temp" (target_id = sensor channel), "deviation" (temp - target; target_id = session id),
+--            "duty" (fraction of time on; target_id = effector channel) or "stale" (seconds since the last reading
+--            from the sensor on channel target_id)
+-- aggregate: "last", "mean", "min", "max" or "variance", over the last window_s seconds
+-- operator:  "<", "<=", ">" or ">="
+--
+DROP TABLE IF EXISTS "alarmrule";
+CREATE TABLE "alarmrule"(
+    id                  INTEGER PRIMARY KEY NOT NULL,
+    name                VARCHAR(255) NOT NULL,
+    metric              CHAR(16) NOT NULL COLLATE NOCASE,
+    target_id           INT NOT NULL,
+    aggregate           CHAR(16) NOT NULL DEFAULT "last" COLLATE NOCASE,
+    operator            CHAR(2) NOT NULL,
+    threshold           DOUBLE NOT NULL,
+    window_s            INT UNSIGNED NOT NULL DEFAULT 0,
+    enabled             TINYINT NOT NULL DEFAULT 1);
+
 --
 -- effectorlog
 --
+-- seq:       change sequence number, shared with the temperature table; see /changes
+--
 DROP TABLE IF EXISTS "effectorlog";
 CREATE TABLE "effectorlog"(
+    seq                 INTEGER PRIMARY KEY NOT NULL,
     date_create         DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
     effector_id         INT UNSIGNED NOT NULL,
     newstate            TINYINT NOT NULL);
@@ -38,6 +77,17 @@ CREATE TABLE "option"(
     name                VARCHAR(255) PRIMARY KEY NOT NULL,
     value               TEXT DEFAULT NULL);
 
+--
+-- pidgains
+--
+DROP TABLE IF EXISTS "pidgains";
+CREATE TABLE "pidgains"(
+    sensor_channel      INTEGER PRIMARY KEY NOT NULL,
+    kp                  DOUBLE NOT NULL,
+    ki                  DOUBLE NOT NULL,
+    kd                  DOUBLE NOT NULL,
+    date_tuned          DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP);
+
 --
 -- profile
 --
@@ -74,6 +124,10 @@ CREATE TABLE "sensortype"(
 --
 -- session
 --
+-- date_start:      start of the profile; moved forward by each hold, once released, and back by each skipped stage
+-- date_hold:       start of the current hold, or NULL if the session is not held
+-- target_override: target temperature (C) overriding the profile, or NULL
+--
 DROP TABLE IF EXISTS "session";
 CREATE TABLE "session"(
     id                  INTEGER PRIMARY KEY AUTOINCREMENT NOT NULL,
@@ -81,7 +135,9 @@ CREATE TABLE "session"(
     profile_id          INT UNSIGNED NOT NULL,
     date_create         DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
     date_start          DATETIME DEFAULT NULL,
-    date_finish         DATETIME DEFAULT NULL);
+    date_finish         DATETIME DEFAULT NULL,
+    date_hold           DATETIME DEFAULT NULL,
+    target_override     DOUBLE DEFAULT NULL);
 
 DROP INDEX IF EXISTS session_id_date_finish;
 CREATE UNIQUE INDEX session_id_date_finish
@@ -103,8 +159,11 @@ CREATE UNIQUE INDEX sessioneffector_session_id_effectortype_id_channel
 --
 -- temperature
 --
+-- seq:       change sequence number, shared with the effectorlog table; see /changes
+--
 DROP TABLE IF EXISTS "temperature";
 CREATE TABLE "temperature"(
+    seq                 INTEGER PRIMARY KEY NOT NULL,
     date_create         DATETIME NOT NULL DEFAULT CURRENT_TIMESTAMP,
     sensor_id           TINYINT UNSIGNED NOT NULL,
     temperature         DECIMAL(4, 6) NOT NULL);
@@ -243,5 +302,14 @@ INSERT INTO temperaturesensor(role, session_id, channel, thermistor_id) VALUES
     ("vessel", 2, 1, 1);
 
 DELETE FROM temperature;
+
+DELETE FROM alarmrule;
+INSERT INTO alarmrule(id, name, metric, target_id, aggregate, operator, threshold, window_s) VALUES
+    (1, "FV1 over target",      "deviation",    1, "min",       ">",    2.0,     600),     -- >target+2C for 10 min
+    (2, "FV1 sensor stuck",     "temp",         0, "variance",  "<=",   0.0,    3600),     -- No variation for 1h
+    (3, "FV1 cooler overload",  "duty",         1, "mean",      ">",    0.9,   21600),     -- Cooler >90% on over 6h
+    (4, "FV1 sensor fault",     "stale",        0, "last",      ">",   60.0,       0);     -- No reading for 1 min
+
+DELETE FROM alarm;
 VACUUM;
 
@@ -0,0 +1,184 @@
+/*
+    writer.cc: streaming CBOR (RFC 7049) writer.  Objects and arrays are written as indefinite-length maps and arrays, so
+    nothing already written is revisited, and the output buffer may be drained between calls.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/cbor/writer.h"
+#include <cstring>
+
+using std::string;
+
+
+static const uint8_t
+    MAJOR_UINT          = 0,
+    MAJOR_NEGINT        = 1,
+    MAJOR_TEXT          = 3,
+
+    INDEFINITE_ARRAY    = 0x9f,
+    INDEFINITE_MAP      = 0xbf,
+    SIMPLE_FALSE        = 0xf4,
+    SIMPLE_TRUE         = 0xf5,
+    SIMPLE_NULL         = 0xf6,
+    FLOAT32             = 0xfa,
+    FLOAT64             = 0xfb,
+    BREAK               = 0xff;
+
+
+// head() - write the initial byte(s) of a data item: major type <major>, and argument <val> in the shortest encoding.
+//
+void CborWriter::head(const uint8_t major, const uint64_t val) noexcept
+{
+    const char type = major << 5;
+
+    if(val < 24)
+    {
+        out_ += (char) (type | val);
+        return;
+    }
+
+    int nbytes;
+    if(val <= 0xff)
+    {
+        out_ += (char) (type | 24);
+        nbytes = 1;
+    }
+    else if(val <= 0xffff)
+    {
+        out_ += (char) (type | 25);
+        nbytes = 2;
+    }
+    else if(val <= 0xffffffff)
+    {
+        out_ += (char) (type | 26);
+        nbytes = 4;
+    }
+    else
+    {
+        out_ += (char) (type | 27);
+        nbytes = 8;
+    }
+
+    while(nbytes--)
+        out_ += (char) (val >> (nbytes * 8));
+}
+
+
+Serializer& CborWriter::beginObject() noexcept
+{
+    out_ += (char) INDEFINITE_MAP;
+    return *this;
+}
+
+
+Serializer& CborWriter::endObject() noexcept
+{
+    out_ += (char) BREAK;
+    return *this;
+}
+
+
+Serializer& CborWriter::beginArray() noexcept
+{
+    out_ += (char) INDEFINITE_ARRAY;
+    return *this;
+}
+
+
+Serializer& CborWriter::endArray() noexcept
+{
+    out_ += (char) BREAK;
+    return *this;
+}
+
+
+Serializer& CborWriter::key(const SerialKey& key) noexcept
+{
+    return value(key.str(), key.length());
+}
+
+
+Serializer& CborWriter::value(const bool val) noexcept
+{
+    out_ += (char) (val ? SIMPLE_TRUE : SIMPLE_FALSE);
+    return *this;
+}
+
+
+// value() - write an integer.  A negative integer n is encoded as major type 1 with argument -1 - n (i.e. ~n).
+//
+Serializer& CborWriter::value(const long long val) noexcept
+{
+    if(val >= 0)
+        head(MAJOR_UINT, val);
+    else
+        head(MAJOR_NEGINT, ~((unsigned long long) val));
+
+    return *this;
+}
+
+
+Serializer& CborWriter::value(const unsigned long long val) noexcept
+{
+    head(MAJOR_UINT, val);
+    return *this;
+}
+
+
+// value() - write a floating-point number, as a single-precision float if that represents it exactly.  NaN and the
+// infinities are written as they are; unlike JSON, CBOR can represent them.
+//
+Serializer& CborWriter::value(const double val) noexcept
+{
+    const float f = val;
+    uint64_t bits;
+    int nbytes;
+
+    if(((double) f == val) || (val != val))
+    {
+        uint32_t b;
+        ::memcpy(&b, &f, sizeof(b));
+
+        out_ += (char) FLOAT32;
+        bits = b;
+        nbytes = 4;
+    }
+    else
+    {
+        ::memcpy(&bits, &val, sizeof(bits));
+
+        out_ += (char) FLOAT64;
+        nbytes = 8;
+    }
+
+    while(nbytes--)
+        out_ += (char) (bits >> (nbytes * 8));
+
+    return *this;
+}
+
+
+Serializer& CborWriter::value(const char *str, const size_t len) noexcept
+{
+    head(MAJOR_TEXT, len);
+    out_.append(str, len);
+
+    return *this;
+}
+
+
+Serializer& CborWriter::null() noexcept
+{
+    out_ += (char) SIMPLE_NULL;
+    return *this;
+}
+
+
+Serializer& CborWriter::encodedValue(const char *data, const size_t len) noexcept
+{
+    out_.append(data, len);
+    return *this;
+}
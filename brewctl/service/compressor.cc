@@ -0,0 +1,192 @@
+/*
+    compressor.cc: HTTP content-coding (gzip, deflate) of response bodies, using zlib.  A Compressor encodes a body
+    incrementally, flushing after each block so that a streamed response can be decoded as it arrives.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/compressor.h"
+#include "include/framework/log.h"
+#include "include/util/string.h"
+#include <algorithm>
+#include <cstring>
+
+using std::string;
+
+
+static const int
+    COMPRESSION_LEVEL   = 6,        // zlib compression level: a compromise between CPU time and compression ratio
+    MEM_LEVEL           = 8,        // zlib memory level (the default)
+    WINDOW_BITS         = 15,       // log2(window size); add 16 to select the gzip wrapper instead of zlib's
+    GZIP_WINDOW_BITS    = WINDOW_BITS + 16;
+
+static const size_t
+    OUTPUT_CHUNK        = 4096,     // Output buffer growth increment
+    SOURCE_BLOCK_SIZE   = 4096;     // Max size of each block read from a CompressedStream's source
+
+static const char * const encodingNames[] =
+{
+    "identity",
+    "gzip",
+    "deflate"
+};
+
+
+// ctor - initialise a zlib stream producing <encoding> (ENCODING_GZIP or ENCODING_DEFLATE).
+//
+Compressor::Compressor(const ContentEncoding_t encoding) noexcept
+    : ok_(false)
+{
+    ::memset(&zs_, 0, sizeof(zs_));
+
+    if((encoding != ENCODING_GZIP) && (encoding != ENCODING_DEFLATE))
+        return;
+
+    const int ret = ::deflateInit2(&zs_, COMPRESSION_LEVEL, Z_DEFLATED,
+                                   (encoding == ENCODING_GZIP) ? GZIP_WINDOW_BITS : WINDOW_BITS, MEM_LEVEL,
+                                   Z_DEFAULT_STRATEGY);
+    if(ret != Z_OK)
+        logWarning("Compressor: deflateInit2() failed: %d", ret);
+    else
+        ok_ = true;
+}
+
+
+Compressor::~Compressor() noexcept
+{
+    if(ok_)
+        ::deflateEnd(&zs_);
+}
+
+
+// write() - compress <len> bytes from <data>, appending the output to <out>.  Unless <finish> is true, the output is
+// flushed to a byte boundary (Z_SYNC_FLUSH), so that everything written so far can be decompressed by the client; if
+// <finish> is true, the compressed stream is ended, and the Compressor can't be used again.
+//
+bool Compressor::write(const char *data, const size_t len, string& out, const bool finish) noexcept
+{
+    if(!ok_)
+        return false;
+
+    zs_.next_in = (Bytef *) data;
+    zs_.avail_in = len;
+
+    // deflate() has flushed all of its output when it returns with space left in the output buffer
+    do
+    {
+        const size_t used = out.length();
+
+        out.resize(used + OUTPUT_CHUNK);
+        zs_.next_out = (Bytef *) &out[used];
+        zs_.avail_out = OUTPUT_CHUNK;
+
+        const int ret = ::deflate(&zs_, finish ? Z_FINISH : Z_SYNC_FLUSH);
+
+        out.resize(used + OUTPUT_CHUNK - zs_.avail_out);
+
+        if(ret == Z_STREAM_ERROR)
+        {
+            logWarning("Compressor: deflate() failed");
+            ::deflateEnd(&zs_);
+            ok_ = false;
+            return false;
+        }
+    } while(zs_.avail_out == 0);
+
+    return true;
+}
+
+
+// compress() - compress <in>, in its entirety, into <out> with <encoding>.
+//
+bool Compressor::compress(const ContentEncoding_t encoding, const string& in, string& out) noexcept
+{
+    Compressor c(encoding);
+
+    out.clear();
+    return c.write(in.data(), in.length(), out, true);
+}
+
+
+// negotiate() - return the preferred content-coding listed in <acceptEncoding>, the value of a request's Accept-
+// Encoding header, or ENCODING_IDENTITY if the header is null or lists no coding that we support.  gzip is preferred
+// to deflate when both are equally acceptable.
+//
+ContentEncoding_t Compressor::negotiate(const char *acceptEncoding) noexcept
+{
+    if(acceptEncoding == nullptr)
+        return ENCODING_IDENTITY;
+
+    const string list(acceptEncoding);
+    ContentEncoding_t encoding = ENCODING_IDENTITY;
+    string item;
+    double q, bestQ = 0.0;
+
+    for(size_t pos = 0; Util::String::nextQualityItem(list, pos, item, q); )
+    {
+        const ContentEncoding_t e = ((item == "gzip") || (item == "x-gzip") || (item == "*")) ? ENCODING_GZIP
+                                    : (item == "deflate") ? ENCODING_DEFLATE : ENCODING_IDENTITY;
+
+        if((e != ENCODING_IDENTITY) && ((q > bestQ) || ((q == bestQ) && (e == ENCODING_GZIP))) && (q > 0.0))
+        {
+            encoding = e;
+            bestQ = q;
+        }
+    }
+
+    return encoding;
+}
+
+
+// name() - return the name of <encoding>, as used in the Content-Encoding header.
+//
+const char *Compressor::name(const ContentEncoding_t encoding) noexcept
+{
+    return ((encoding >= 0) && (encoding < NUM_ENCODINGS)) ? encodingNames[encoding] : encodingNames[0];
+}
+
+
+// ctor - compress the output of <source> with <encoding>.
+//
+CompressedStream::CompressedStream(const ResponseStream_sptr_t& source, const ContentEncoding_t encoding) noexcept
+    : source_(source),
+      compressor_(encoding),
+      offset_(0),
+      finished_(false)
+{
+}
+
+
+// read() - copy up to <max> bytes of the compressed stream into <buf>.  Each block read from the source is compressed
+// and flushed, so the client receives the source's output with at most one block's delay.
+//
+ssize_t CompressedStream::read(char *buf, const size_t max) noexcept
+{
+    while(offset_ >= buffer_.length())
+    {
+        if(finished_)
+            return 0;
+
+        char block[SOURCE_BLOCK_SIZE];
+        const ssize_t len = source_->read(block, sizeof(block));
+
+        buffer_.clear();
+        offset_ = 0;
+
+        if(len < 0)
+            return -1;
+
+        finished_ = (len == 0);
+        if(!compressor_.write(block, len, buffer_, finished_))
+            return -1;
+    }
+
+    const size_t len = std::min(max, buffer_.length() - offset_);
+
+    ::memcpy(buf, buffer_.data() + offset_, len);
+    offset_ += len;
+
+    return len;
+}
@@ -0,0 +1,182 @@
+/*
+    eventstream.cc: a Server-Sent Events stream of telemetry records (sensor samples, effector transitions, control-state
+    changes), served to one client of the /stream endpoint.  Each stream consumes the telemetry bus through its own
+    subscriber, optionally filtered by session and rate-limited, and is identified by the bus position of each record so
+    that a reconnecting client can resume where it left off.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+
+
+    Events
+
+    +----------+------------------------------------------------------------------------+
+    | Event    | Data                                                                   |
+    +----------+------------------------------------------------------------------------+
+    | sample   | {"ch": sensor channel, "s": session, "t": ms since epoch, "c": temp C} |
+    | effector | {"ch": effector channel, "t": ms since epoch, "on": 0/1, "w": watts}   |
+    | control  | {"s": session, "t": ms since epoch, "st": state, "tgt": C, "cur": C}   |
+    | dropped  | {"n": number of records missed because the client fell behind}         |
+    +----------+------------------------------------------------------------------------+
+*/
+
+#include "include/service/eventstream.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using std::set;
+using std::string;
+
+
+static const size_t
+    MAX_FILL_BYTES  = 8192;         // Stop formatting events into the buffer once it holds this many bytes
+
+static const int
+    RETRY_MS        = 2000;         // Reconnection delay suggested to clients
+
+
+// ctor - if <lastEventId> is non-negative, resume from the record following that event; otherwise start with the next
+// record to be published.
+//
+EventStream::EventStream(TelemetryBus& bus, struct MHD_Connection *connection, const int sessionId,
+                         const set<int>& effectorChannels, const int minIntervalMs, const int keepaliveIntervalMs,
+                         const int64_t lastEventId) noexcept
+    : subscriber_(bus),
+      connection_(connection),
+      sessionId_(sessionId),
+      effectorChannels_(effectorChannels),
+      minIntervalMs_(minIntervalMs),
+      keepaliveIntervalMs_(keepaliveIntervalMs),
+      reportedDrops_(0),
+      lastWrite_(TelemetryBus::now()),
+      offset_(0)
+{
+    if(lastEventId >= 0)
+        subscriber_.seek(lastEventId + 1);
+
+    buffer_ = "retry: " + std::to_string(RETRY_MS) + "\n\n";
+}
+
+
+// read() - copy up to <max> bytes of the stream into <buf>.  Returns the number of bytes copied, which is 0 if there
+// are no events to send at present.
+//
+ssize_t EventStream::read(char *buf, const size_t max) noexcept
+{
+    if(offset_ >= buffer_.length())
+    {
+        buffer_.clear();
+        offset_ = 0;
+        fill();
+    }
+
+    const size_t len = std::min(max, buffer_.length() - offset_);
+
+    ::memcpy(buf, buffer_.data() + offset_, len);
+    offset_ += len;
+
+    return len;
+}
+
+
+// fill() - format the records waiting on the bus into the (empty) buffer.  If there are none, and nothing has been sent
+// for <keepaliveIntervalMs_>, write a comment line instead, so that intermediaries don't close an idle connection.
+//
+void EventStream::fill() noexcept
+{
+    TelemetryRecord_t record;
+
+    while((buffer_.length() < MAX_FILL_BYTES) && subscriber_.next(record))
+        if(accept(record))
+            format(record, subscriber_.cursor() - 1);
+
+    if(subscriber_.dropped() != reportedDrops_)
+    {
+        char event[64];
+
+        ::snprintf(event, sizeof(event), "event: dropped\ndata: {\"n\":%llu}\n\n",
+                   (unsigned long long) (subscriber_.dropped() - reportedDrops_));
+        buffer_ += event;
+        reportedDrops_ = subscriber_.dropped();
+    }
+
+    const int64_t now = TelemetryBus::now();
+
+    if(buffer_.empty() && ((now - lastWrite_) >= keepaliveIntervalMs_))
+        buffer_ = ":\n\n";
+
+    if(!buffer_.empty())
+        lastWrite_ = now;
+}
+
+
+// accept() - return true if <record> passes the stream's session filter and rate limit.
+//
+bool EventStream::accept(const TelemetryRecord_t& record) noexcept
+{
+    switch(record.type)
+    {
+        case TELEMETRY_SENSOR_SAMPLE:
+            if(sessionId_ && (record.sessionId != sessionId_))
+                return false;
+
+            if(minIntervalMs_)
+            {
+                auto it = lastSample_.find(record.channel);
+                if((it != lastSample_.end()) && ((record.timestamp - it->second) < minIntervalMs_))
+                    return false;
+
+                lastSample_[record.channel] = record.timestamp;
+            }
+
+            return true;
+
+        case TELEMETRY_EFFECTOR_TRANSITION:
+            return !sessionId_ || effectorChannels_.count(record.channel);
+
+        case TELEMETRY_CONTROL_STATE:
+            return !sessionId_ || (record.sessionId == sessionId_);
+
+        default:
+            return false;
+    }
+}
+
+
+// format() - append to the buffer the event describing <record>, which is at position <id> on the bus.
+//
+void EventStream::format(const TelemetryRecord_t& record, const uint64_t id) noexcept
+{
+    char event[256];
+    int len = 0;
+
+    switch(record.type)
+    {
+        case TELEMETRY_SENSOR_SAMPLE:
+            len = ::snprintf(event, sizeof(event),
+                             "id: %llu\nevent: sample\ndata: {\"ch\":%d,\"s\":%d,\"t\":%lld,\"c\":%.3f}\n\n",
+                             (unsigned long long) id, record.channel, record.sessionId, (long long) record.timestamp,
+                             record.sensor.tempC);
+            break;
+
+        case TELEMETRY_EFFECTOR_TRANSITION:
+            len = ::snprintf(event, sizeof(event),
+                             "id: %llu\nevent: effector\ndata: {\"ch\":%d,\"t\":%lld,\"on\":%d,\"w\":%.1f}\n\n",
+                             (unsigned long long) id, record.channel, (long long) record.timestamp,
+                             record.effector.state, record.effector.powerW);
+            break;
+
+        case TELEMETRY_CONTROL_STATE:
+            len = ::snprintf(event, sizeof(event),
+                             "id: %llu\nevent: control\ndata: {\"s\":%d,\"t\":%lld,\"st\":%d,\"tgt\":%.3f,\"cur\":%.3f}"
+                             "\n\n",
+                             (unsigned long long) id, record.sessionId, (long long) record.timestamp,
+                             record.control.state, record.control.targetC, record.control.currentC);
+            break;
+    }
+
+    if(len > 0)
+        buffer_.append(event, std::min((size_t) len, sizeof(event) - 1));
+}
@@ -0,0 +1,362 @@
+/*
+    historystream.cc: streams the downsampled temperature history of a session directly from a cursor over the
+    temperature log.  Rows are reduced to at most a fixed number of points as they are read, so neither the result set
+    nor the response is ever held in memory in full.  The response may alternatively be encoded in the compact
+    application/x-brewctl-ts format (see timeseries.h).
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+
+
+    The requested time range [from, to) is divided into equal buckets of <interval> seconds.  The response is (shown as
+    JSON; it is written in the negotiated format, provided that the format's Serializer is streamable, otherwise JSON):
+
+        {"session": id, "from": s, "to": s, "mode": name, "interval": s, "data": [...]}
+
+    where, in "minmax" and "avg" mode, "data" holds one element per bucket - [min, max] or the mean temperature - or null
+    if the bucket contains no samples; and in "lttb" mode it holds [t, temperature] pairs: the first and last samples,
+    and between them one sample from each non-empty bucket, chosen by the Largest-Triangle-Three-Buckets method so that
+    the shape of the series is preserved.
+
+    In compact form, the response is an application/x-brewctl-ts stream with one value column per point (two, [min,
+    max], in "minmax" mode).  Empty buckets are omitted, and each bucket is timestamped with its start time.
+*/
+
+#include "include/service/historystream.h"
+#include "include/framework/log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using std::string;
+
+
+static const size_t
+    MAX_FILL_BYTES  = 8192;         // Stop formatting points into the buffer once it holds this many bytes
+
+static const char * const modeNames[] =
+{
+    "minmax",
+    "avg",
+    "lttb"
+};
+
+
+// ctor - stream the history of sensor <channel>, on behalf of session <sessionId>, over [<from>, <to>), reduced to at
+// most <points> buckets.  <to> must be greater than <from>, and <points> must be greater than 0.  The response is
+// written in <format> or, if <compact> is true, encoded as application/x-brewctl-ts.
+//
+HistoryStream::HistoryStream(const int sessionId, const int channel, const int64_t from, const int64_t to,
+                             const int points, const HistoryMode_t mode, const SerialFormat_t format,
+                             const bool compact) noexcept
+    : sessionId_(sessionId),
+      channel_(channel),
+      from_(from),
+      to_(to),
+      mode_(mode),
+      format_(format),
+      writer_(Serializer::create(format, buffer_)),
+      compact_(compact),
+      encoder_(buffer_, (mode == HISTORY_MINMAX) ? 2 : 1),
+      offset_(0),
+      started_(false),
+      done_(false),
+      failed_(false),
+      bucket_(0),
+      count_(0),
+      min_(0.0),
+      max_(0.0),
+      sum_(0.0),
+      selected_{0, 0.0},
+      nextBucket_(0)
+{
+    // The buffer is drained as the stream is read, so a writer which revisits its output can't be used
+    if(!writer_->streamable())
+    {
+        format_ = SERIAL_JSON;
+        writer_ = Serializer::create(format_, buffer_);
+    }
+
+    interval_ = std::max((int64_t) 1, (to - from + points - 1) / points);
+    nbuckets_ = (to - from + interval_ - 1) / interval_;
+}
+
+
+// init() - prepare the query over the temperature log, on the connection <db>, which must remain open until the stream
+// has been read.  Must be called, and succeed, before the stream is read.
+//
+bool HistoryStream::init(SQLite& db, Error * const err) noexcept
+{
+    return db.prepare("SELECT CAST(STRFTIME('%s', date_create) AS INTEGER), temperature "
+                      "FROM temperature "
+                      "WHERE date_create >= DATETIME(:from, 'unixepoch') "
+                      "AND date_create < DATETIME(:to, 'unixepoch') "
+                      "AND sensor_id=:channel "
+                      "ORDER BY date_create", stmt_, err)
+           && stmt_.bind(":from", (long long) from_, err)
+           && stmt_.bind(":to", (long long) to_, err)
+           && stmt_.bind(":channel", channel_, err);
+}
+
+
+// modeFromName() - return the HistoryMode_t named by <name>, or HISTORY_INVALID if there is no such mode.
+//
+HistoryMode_t HistoryStream::modeFromName(const std::string_view name) noexcept
+{
+    for(int i = 0; i < HISTORY_INVALID; ++i)
+        if(name == modeNames[i])
+            return (HistoryMode_t) i;
+
+    return HISTORY_INVALID;
+}
+
+
+// modeName() - return the name of <mode>.
+//
+const char *HistoryStream::modeName(const HistoryMode_t mode) noexcept
+{
+    return ((mode >= 0) && (mode < HISTORY_INVALID)) ? modeNames[mode] : "invalid";
+}
+
+
+// contentType() - return the MIME type of the response.
+//
+const char *HistoryStream::contentType() const noexcept
+{
+    return compact_ ? TimeSeries::CONTENT_TYPE : Serializer::contentType(format_);
+}
+
+
+// read() - copy up to <max> bytes of the response into <buf>.  Returns the number of bytes copied, 0 at the end of the
+// response, or -1 if the query failed part-way through.
+//
+ssize_t HistoryStream::read(char *buf, const size_t max) noexcept
+{
+    if(offset_ >= buffer_.length())
+    {
+        buffer_.clear();
+        offset_ = 0;
+        fill();
+
+        if(buffer_.empty())
+            return failed_ ? -1 : 0;
+    }
+
+    const size_t len = std::min(max, buffer_.length() - offset_);
+
+    ::memcpy(buf, buffer_.data() + offset_, len);
+    offset_ += len;
+
+    return len;
+}
+
+
+// fill() - step the cursor, formatting the resulting points into the (empty) buffer, until the buffer holds at least
+// MAX_FILL_BYTES or the result set is exhausted.
+//
+void HistoryStream::fill() noexcept
+{
+    if(done_ || failed_)
+        return;
+
+    if(!started_)
+    {
+        if(compact_)
+            encoder_.header();
+        else
+            writer_->beginObject()
+                    .field("session",    sessionId_)
+                    .field("from",       (long long) from_)
+                    .field("to",         (long long) to_)
+                    .field("mode",       modeName(mode_))
+                    .field("interval",   (long long) interval_)
+                    .beginArray("data");
+
+        started_ = true;
+    }
+
+    Point_t p;
+
+    while(buffer_.length() < MAX_FILL_BYTES)
+    {
+        if(!nextRow(p))
+        {
+            if(!failed_)
+            {
+                finish();
+                done_ = true;
+            }
+
+            return;
+        }
+
+        add(p);
+    }
+}
+
+
+// nextRow() - step the cursor, and read the current row into <p>.  Returns false at the end of the result set, or on
+// error (in which case <failed_> is set).  Columns are read directly from the statement, bypassing SQLiteColumn's
+// conversion via text, as this is called once per logged sample.
+//
+bool HistoryStream::nextRow(Point_t& p) noexcept
+{
+    Error err;
+
+    if(!stmt_.step(&err))
+    {
+        if(err.code())
+        {
+            logWarning("HistoryStream: session %d: query failed: %s", sessionId_, err.message().c_str());
+            failed_ = true;
+        }
+
+        return false;
+    }
+
+    sqlite3_stmt * const stmt = (sqlite3_stmt *) stmt_;
+
+    p.t = ::sqlite3_column_int64(stmt, 0);
+    p.v = ::sqlite3_column_double(stmt, 1);
+
+    return true;
+}
+
+
+// add() - add the point <p> to the bucket containing it, writing out any buckets which are thereby completed.
+//
+void HistoryStream::add(const Point_t& p) noexcept
+{
+    const int64_t bucket = std::min(std::max((p.t - from_) / interval_, (int64_t) 0), nbuckets_ - 1);
+
+    if(mode_ == HISTORY_LTTB)
+    {
+        if(!count_++)
+        {
+            // The first point is always kept
+            writePoint(p);
+            selected_ = p;
+            return;
+        }
+
+        if((bucket != nextBucket_) && !next_.empty())
+        {
+            // The bucket following <pending_> is complete, so a point can now be selected from <pending_>
+            if(!pending_.empty())
+            {
+                double t = 0.0, v = 0.0;
+                for(const auto& q : next_)
+                {
+                    t += q.t;
+                    v += q.v;
+                }
+
+                selectPoint({(int64_t) (t / next_.size()), v / next_.size()});
+            }
+
+            pending_.swap(next_);
+            next_.clear();
+        }
+
+        nextBucket_ = bucket;
+        next_.push_back(p);
+        return;
+    }
+
+    for(; bucket_ < bucket; ++bucket_)
+        writeBucket();
+
+    if(!count_++)
+        min_ = max_ = p.v;
+
+    min_ = std::min(min_, p.v);
+    max_ = std::max(max_, p.v);
+    sum_ += p.v;
+}
+
+
+// finish() - write out the remaining buckets (or, in LTTB mode, points), and close the response.
+//
+void HistoryStream::finish() noexcept
+{
+    if(mode_ == HISTORY_LTTB)
+    {
+        if(!next_.empty())
+        {
+            if(!pending_.empty())
+                selectPoint(next_.back());
+
+            // The last point is always kept
+            writePoint(next_.back());
+        }
+    }
+    else
+    {
+        for(; bucket_ < nbuckets_; ++bucket_)
+            writeBucket();
+    }
+
+    if(compact_)
+        encoder_.flush();
+    else
+        writer_->endArray().endObject();
+}
+
+
+// writeBucket() - write the summary of the current bucket, which may be empty, and reset the bucket statistics.
+//
+void HistoryStream::writeBucket() noexcept
+{
+    if(compact_)
+    {
+        if(count_)
+        {
+            const double values[2] = {(mode_ == HISTORY_MINMAX) ? min_ : (sum_ / count_), max_};
+            encoder_.add(from_ + (bucket_ * interval_), values);
+        }
+    }
+    else if(!count_)
+        writer_->null();
+    else if(mode_ == HISTORY_MINMAX)
+        writer_->beginArray().value(min_).value(max_).endArray();
+    else
+        writer_->value(sum_ / count_);
+
+    count_ = 0;
+    sum_ = 0.0;
+}
+
+
+void HistoryStream::writePoint(const Point_t& p) noexcept
+{
+    if(compact_)
+        encoder_.add(p.t, &p.v);
+    else
+        writer_->beginArray().value((long long) p.t).value(p.v).endArray();
+}
+
+
+// selectPoint() - LTTB step: from the points of the <pending_> bucket, write the one which forms the largest triangle
+// with the previously-selected point and <next>, which is the mean of the following bucket.
+//
+void HistoryStream::selectPoint(const Point_t& next) noexcept
+{
+    // Times are taken relative to the previously-selected point, to preserve precision in the products below
+    const double nt = next.t - selected_.t, nv = next.v - selected_.v;
+    double maxArea = -1.0;
+    const Point_t *best = &pending_.front();
+
+    for(const auto& q : pending_)
+    {
+        const double area = std::fabs((nt * (q.v - selected_.v)) - ((q.t - selected_.t) * nv));
+        if(area > maxArea)
+        {
+            maxArea = area;
+            best = &q;
+        }
+    }
+
+    selected_ = *best;
+    writePoint(selected_);
+}
@@ -8,58 +8,170 @@
 
 #include "include/service/httprequesthandler.h"
 #include "include/framework/log.h"
-#include "include/service/json/array.h"
-#include "include/service/json/object.h"
-#include "include/service/json/element.h"
+#include "include/framework/registry.h"
+#include "include/service/historystream.h"
+#include "include/service/serializer.h"
+#include "include/sqlite/sqlitestmt.h"
+#include "include/util/string.h"
 #include "include/util/url.h"
-
-using std::map;
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <limits>
+
+using std::future;
+using std::future_status;
 using std::string;
+using std::string_view;
 using std::vector;
 
 
-// API call-handler table
-HttpRequestHandler::ApiHandlerMap_t HttpRequestHandler::handlers_ =
+static const int
+    SESSION_COMMAND_TIMEOUT_S   = 5,        // Max time to wait for the session manager to execute a command
+    DEFAULT_HISTORY_POINTS      = 300,      // Default number of points returned by /session/{id}/history
+    MAX_HISTORY_POINTS          = 2000,     // Max number of points returned by /session/{id}/history
+    DEFAULT_CHANGES_LIMIT       = 500,      // Default number of changes returned by /changes
+    MAX_CHANGES_LIMIT           = 5000;     // Max number of changes returned by /changes
+
+static const size_t
+    MAX_BATCH_REQUESTS          = Util::URL::MAX_ARGS;  // Max number of sub-requests in a /batch request
+
+
+// API route table.  The trie is built at compile time; a malformed or conflicting route is a compile-time error.
+struct HttpRoutes
 {
-    {"/option",         &HttpRequestHandler::callOption}
+    typedef HttpRequestHandler H;
+
+    static constexpr H::Route_t routes[] =
+    {
+        {"/alarms",                     H::METHOD_GET | H::METHOD_HEAD,     &H::callAlarms},
+        {"/batch",                      H::METHOD_GET | H::METHOD_HEAD,     &H::callBatch},
+        {"/changes",                    H::METHOD_GET | H::METHOD_HEAD,     &H::callChanges},
+        {"/option",                     H::METHOD_GET | H::METHOD_HEAD,     &H::callOption},
+        {"/options",                    H::METHOD_POST,                     &H::callImport},
+        {"/profiles",                   H::METHOD_POST,                     &H::callImport},
+        {"/sessions",                   H::METHOD_GET | H::METHOD_HEAD,     &H::callSessions},
+        {"/session/command",            H::METHOD_POST | H::METHOD_PUT,     &H::callSessionCommand},
+        {"/session/{id:int}/command",   H::METHOD_POST | H::METHOD_PUT,     &H::callSessionCommand},
+        {"/session/{id:int}/history",   H::METHOD_GET | H::METHOD_HEAD,     &H::callSessionHistory},
+        {"/temperatures",               H::METHOD_POST,                     &H::callImport}
+    };
+
+    static constexpr Router::Trie<H::ApiCallHandler_t, sizeof(routes) / sizeof(routes[0])> trie{routes};
 };
 
 
-HttpRequestHandler::HttpMethodMap_t HttpRequestHandler::methods_ =
+// Cache of serialised responses to the endpoints that report published state (/alarms, /sessions)
+ResponseCache HttpRequestHandler::cache_;
+
+
+static const struct
+{
+    const char *                        name;
+    HttpRequestHandler::HttpMethod_t    method;
+} methodNames[] =
 {
-    {"HEAD",    HTTP_HEAD},
-    {"GET",     HTTP_GET},
-    {"POST",    HTTP_POST},
-    {"PUT",     HTTP_PUT},
-    {"DELETE",  HTTP_DELETE}
+    {"HEAD",    HttpRequestHandler::HTTP_HEAD},
+    {"GET",     HttpRequestHandler::HTTP_GET},
+    {"POST",    HttpRequestHandler::HTTP_POST},
+    {"PUT",     HttpRequestHandler::HTTP_PUT},
+    {"DELETE",  HttpRequestHandler::HTTP_DELETE}
 };
 
 
-// ctor - capture request args
+// ctor - capture request args.  <url> holds the request path and query args, and must outlive the handler.  <accept>,
+// if not null, is the value of the request's Accept header.  <upload>, if not null, is the importer to which the body
+// of the request has been passed.
+//
+HttpRequestHandler::HttpRequestHandler(const string& method, Util::URL& url, const char *accept, Importer *upload)
+    noexcept
+    : method_(methodFromString(method)), methodStr_(method), accept_((accept != nullptr) ? accept : ""),
+      url_(url), path_(url.path()), statusCode_(HTTP_OK), db_(&Registry::instance().db()), upload_(upload),
+      inBatch_(false)
+{
+    format_ = negotiateFormat();
+    contentType_ = Serializer::contentType(format_);
+
+    logDebug("HttpRequestHandler: method=%s path=%.*s args=%zu", method.c_str(), (int) path_.length(), path_.data(),
+             url.argCount());
+}
+
+
+// ctor - create a handler for a GET sub-request, <url>, of the /batch request handled by <batch>.  The sub-request's
+// response is written in the batch response's format, from the batch's alarm set and session snapshot, and its
+// database queries are executed on <db>.
+//
+HttpRequestHandler::HttpRequestHandler(const HttpRequestHandler& batch, Util::URL& url, SQLite& db) noexcept
+    : method_(HTTP_GET), methodStr_("GET"), format_(batch.format_), url_(url), path_(url.path()), statusCode_(HTTP_OK),
+      contentType_(batch.contentType_), db_(&db), upload_(nullptr), alarms_(batch.alarms_), snapshot_(batch.snapshot_),
+      inBatch_(true)
+{
+}
+
+
+// methodFromString() - map an HTTP method name to an HttpMethod_t; returns HTTP_INVALID for unsupported methods.
 //
-HttpRequestHandler::HttpRequestHandler(const string& method, const string& uri) noexcept
-    : method_(HTTP_INVALID), methodStr_(method), uri_(uri), url_(uri), statusCode_(HTTP_OK)
+HttpRequestHandler::HttpMethod_t HttpRequestHandler::methodFromString(const string& method) noexcept
 {
-    logDebug("HttpRequestHandler: method=%s uri=%s", method.c_str(), uri.c_str());
+    for(const auto& m : methodNames)
+        if(method == m.name)
+            return m.method;
 
-    auto m = methods_.find(methodStr_);
-    if(m != methods_.end())
-        method_ = m->second;
+    return HTTP_INVALID;
 }
 
 
-// handleRequest() - called by client code when it is ready for us to handle the current request.
+// handleRequest() - called by client code when it is ready for us to handle the current request.  The request path is
+// matched against the route table, capturing any path parameters into <params_>, and the route's method mask is
+// checked before its handler is called.
 //
 bool HttpRequestHandler::handleRequest() noexcept
 {
     if(method_ == HTTP_INVALID)
         return methodNotAllowed();
 
-    auto handler = handlers_.find(url_.path());
-    if(handler == handlers_.end())
+    const Route_t * const route = HttpRoutes::trie.match(path_, params_);
+    if(route == nullptr)
         return notFound();
 
-    return (this->*handler->second)();
+    if(!(route->methods & (1 << method_)))
+        return methodNotAllowed();
+
+    return (this->*route->handler)();
+}
+
+
+// response() - return the response to the request.  A response served from the cache is returned as-is; any other is
+// wrapped, without copying its body, in a new HttpResponse_t.  Call only once, after handleRequest().
+//
+HttpResponse_sptr_t HttpRequestHandler::response() noexcept
+{
+    if(cachedResponse_)
+        return cachedResponse_;
+
+    HttpResponse_t * const response = new HttpResponse_t();
+
+    response->status = statusCode_;
+    response->body = std::move(responseBody_);
+    response->stream = stream_;
+    response->contentType = contentType_;
+
+    return HttpResponse_sptr_t(response);
+}
+
+
+// respond() - set this object's response status to <status>, and set the response body to an object containing the
+// single member <key>: <value>.
+//
+bool HttpRequestHandler::respond(const HttpStatus_t status, const SerialKey& key, const string& value) noexcept
+{
+    statusCode_ = status;
+    responseBody_.clear();
+    serializer(responseBody_)->beginObject().field(key, value).endObject();
+
+    return true;
 }
 
 
@@ -68,10 +180,7 @@ bool HttpRequestHandler::handleRequest() noexcept
 //
 bool HttpRequestHandler::missingArg(const string& arg) noexcept
 {
-    statusCode_ = HTTP_BAD_REQUEST;
-    responseBody_ = JsonObject().add("missingArg", new JsonElement(arg));
-
-    return true;
+    return respond(HTTP_BAD_REQUEST, "missingArg", arg);
 }
 
 
@@ -81,12 +190,120 @@ bool HttpRequestHandler::missingArg(const vector<string>& args) noexcept
         return missingArg(args[0]);
 
     statusCode_ = HTTP_BAD_REQUEST;
+    responseBody_.clear();
+
+    const Serializer_uptr_t w = serializer(responseBody_);
 
-    JsonObject o;
-    JsonArray a;
-//    o.addArray("missingArg"
+    w->beginObject().beginArray("missingArg");
+    for(const auto& arg : args)
+        w->value(arg);
+    w->endArray().endObject();
 
-    return false;       // FIXME
+    return true;
+}
+
+
+// intArg() - if the request argument <name> exists, parse it as an integer into <val>.  Returns false, having set the
+// response to indicate that the argument is invalid, if the argument exists but is not an integer.
+//
+bool HttpRequestHandler::intArg(const string& name, long long& val) noexcept
+{
+    if(!url_.argExists(name))
+        return true;
+
+    if(!url_.argInt(name, val))
+    {
+        respond(HTTP_BAD_REQUEST, "invalidArg", name);
+        return false;
+    }
+
+    return true;
+}
+
+
+// sessionIdArg() - read the session id from the path parameter "id" or, if there is none, from the query arg "id",
+// into <id>.  If the id is not a valid session id (in particular, if it is out of range), respond with 400 Bad Request
+// and return false.
+//
+bool HttpRequestHandler::sessionIdArg(session_id_t& id) noexcept
+{
+    long long val = params_.exists("id") ? params_.getInt("id") : 0;
+    if(!params_.exists("id") && !intArg("id", val))
+        return false;
+
+    if((val < std::numeric_limits<session_id_t>::min()) || (val > std::numeric_limits<session_id_t>::max()))
+    {
+        respond(HTTP_BAD_REQUEST, "invalidArg", "id");
+        return false;
+    }
+
+    id = (session_id_t) val;
+    return true;
+}
+
+
+// accepts() - return true if the request's Accept header lists the media type <type>, with a non-zero quality.
+//
+bool HttpRequestHandler::accepts(const char *type) const noexcept
+{
+    string range;
+    double q;
+
+    for(size_t pos = 0; Util::String::nextQualityItem(accept_, pos, range, q); )
+        if(range == type)
+            return q > 0.0;
+
+    return false;
+}
+
+
+// negotiateFormat() - return the serialisation format of the most-preferred media type in the request's Accept header
+// for which there is a Serializer.  JSON is the default, if no such type is listed.
+//
+SerialFormat_t HttpRequestHandler::negotiateFormat() const noexcept
+{
+    SerialFormat_t format = SERIAL_JSON;
+    string range;
+    double q, bestQ = 0.0;
+
+    for(size_t pos = 0; Util::String::nextQualityItem(accept_, pos, range, q); )
+    {
+        const SerialFormat_t f = Serializer::formatFromContentType(range);
+
+        if((f != SERIAL_NUM_FORMATS) && (q > bestQ))
+        {
+            format = f;
+            bestQ = q;
+        }
+    }
+
+    return format;
+}
+
+
+// serializer() - return a writer which formats a document in the negotiated format, appending to <out>.
+//
+Serializer_uptr_t HttpRequestHandler::serializer(string& out) const noexcept
+{
+    return Serializer::create(format_, out);
+}
+
+
+// alarms() - return the alarm set from which responses are built: that of the batch, for a sub-request of a /batch
+// request; otherwise the current alarm set.
+//
+AlarmSet_sptr_t HttpRequestHandler::alarms() const noexcept
+{
+    return alarms_ ? alarms_ : Registry::instance().alarms().current();
+}
+
+
+// snapshot() - return the session snapshot from which responses are built: that of the batch, for a sub-request of a
+// /batch request; otherwise the current snapshot.
+//
+SessionSnapshotSet_sptr_t HttpRequestHandler::snapshot() const noexcept
+{
+    return snapshot_ ? snapshot_ : Registry::instance().snapshots().current();
 }
 
 
@@ -95,10 +312,7 @@ bool HttpRequestHandler::missingArg(const vector<string>& args) noexcept
 //
 bool HttpRequestHandler::notFound() noexcept
 {
-    statusCode_ = HTTP_NOT_FOUND;
-    responseBody_ = JsonObject().add("resource", new JsonElement(url_.path()));
-
-    return true;
+    return respond(HTTP_NOT_FOUND, "resource", string(path_));
 }
 
 
@@ -107,23 +321,541 @@ bool HttpRequestHandler::notFound() noexcept
 //
 bool HttpRequestHandler::methodNotAllowed() noexcept
 {
-    statusCode_ = HTTP_METHOD_NOT_ALLOWED;
-    responseBody_ = JsonObject().add("method", new JsonElement(methodStr_));
+    return respond(HTTP_METHOD_NOT_ALLOWED, "method", methodStr_);
+}
+
+//
+// API call handlers follow
+//
+
+// writeAlarm() - write an object describing <alarm>.
+//
+static void writeAlarm(Serializer& w, const Alarm_t& alarm) noexcept
+{
+    w.beginObject()
+     .field("id",       (long long) alarm.id)
+     .field("ruleId",   (int) alarm.ruleId)
+     .field("name",     alarm.ruleName)
+     .field("value",    alarm.value)
+     .field("raised",   (long long) alarm.raised);
+
+    if(alarm.cleared)
+        w.field("cleared", (long long) alarm.cleared);
+
+    w.endObject();
+}
+
+
+// callAlarms() - handle the /alarms endpoint.  Returns the active alarms and the most recently-cleared alarms, as
+// published by the alarm engine.  The response is cached until the alarm engine publishes a new alarm set.
+//
+bool HttpRequestHandler::callAlarms() noexcept
+{
+    const AlarmSet_sptr_t alarms = this->alarms();
+
+    cachedResponse_ = cache_.get("/alarms", format_, alarms->version, [this, &alarms](HttpResponse_t& r)
+    {
+        r.contentType = contentType_;
+        serializeAlarms(*alarms, *serializer(r.body));
+    });
 
     return true;
 }
 
+
+// serializeAlarms() - write <alarms> to <w>.
 //
-// API call handlers follow
+void HttpRequestHandler::serializeAlarms(const AlarmSet_t& alarms, Serializer& w) noexcept
+{
+    w.beginObject()
+     .field("version",      (unsigned long long) alarms.version)
+     .field("timestamp",    (long long) alarms.timestamp);
+
+    w.beginArray("active");
+    for(const auto& a : alarms.active)
+        writeAlarm(w, a);
+    w.endArray();
+
+    w.beginArray("recent");
+    for(const auto& a : alarms.recent)
+        writeAlarm(w, a);
+    w.endArray();
+
+    w.endObject();
+}
+
+
+// callBatch() - handle the /batch endpoint.  Each "req" argument is a sub-request: the path, and any query string, of a
+// GET request, percent-encoded as a whole (e.g. /batch?req=/sessions&req=%2Fsession%2F3%2Fhistory%3Fpoints%3D60).  The
+// sub-requests are dispatched through the route table, in order, against the same alarm set and session snapshot, and
+// within a single database read transaction, so that their results are mutually consistent.  The response is:
+//
+//     {"results": [{"path": p, "status": s, "body": b}, ...]}
+//
+// where <b> is the sub-request's response body, embedded in the response's format, or null if it could not be read.  A
+// sub-request whose response is in a different format (which the batch could not embed) is reported with status 406
+// and a null body.
+//
+bool HttpRequestHandler::callBatch() noexcept
+{
+    if(inBatch_)
+        return respond(HTTP_BAD_REQUEST, "error", "Batch requests can't be nested");
+
+    string_view requests[MAX_BATCH_REQUESTS];
+    const size_t numRequests = url_.argValues("req", requests, MAX_BATCH_REQUESTS);
+
+    if(!numRequests)
+        return missingArg("req");
+
+    // The read transaction is held on a separate, read-only connection, so that it neither blocks nor is blocked by the
+    // application's writes.  It is started immediately - a deferred transaction would only take its snapshot of the
+    // database at the first query of the first sub-request that reads it.
+    SQLite snapshotDb;
+    SQLiteStmt start;
+    Error err;
+
+    if(!snapshotDb.open(Registry::instance().db().path(), SQLITE_OPEN_READONLY, &err)
+       || !snapshotDb.exec("BEGIN", &err)
+       || !snapshotDb.prepare("SELECT COUNT(*) FROM sqlite_master", start, &err)
+       || !start.step(&err))
+        return respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message());
+
+    start.finalise();
+
+    alarms_ = Registry::instance().alarms().current();
+    snapshot_ = Registry::instance().snapshots().current();
+
+    auto w = serializer(responseBody_);
+    w->beginObject().beginArray("results");
+
+    for(size_t i = 0; i < numRequests; ++i)
+    {
+        Util::URL url(requests[i]);
+        HttpRequestHandler handler(*this, url, snapshotDb);
+
+        handler.handleRequest();
+
+        const HttpResponse_sptr_t response = handler.response();
+        int status = response->status;
+        bool complete = true;
+        string streamed;
+
+        // A body is embedded only if it is in the batch's own format.  A sub-request may respond in another - e.g. a
+        // history stream, whose format must be streamable, falls back to JSON - and its body can't then be embedded.
+        if((response->contentType == nullptr) || ::strcmp(response->contentType, contentType_))
+        {
+            status = HTTP_NOT_ACCEPTABLE;
+            complete = false;
+        }
+        else if(response->stream)       // Streamed responses are read to completion, so that they are embedded in full
+        {
+            char buffer[4096];
+            ssize_t len;
+
+            while((len = response->stream->read(buffer, sizeof(buffer))) > 0)
+                streamed.append(buffer, len);
+
+            if(len < 0)
+            {
+                status = HTTP_INTERNAL_SERVER_ERROR;
+                complete = false;
+            }
+        }
+
+        const string& body = response->stream ? streamed : response->body;
+
+        w->beginObject()
+          .field("path",      string(url.path()))
+          .field("status",    status)
+          .key("body");
+
+        if(complete && !body.empty())
+            w->encodedValue(body.data(), body.length());
+        else
+            w->null();
+
+        w->endObject();
+    }
+
+    w->endArray().endObject();
+
+    snapshotDb.exec("COMMIT");
+    statusCode_ = HTTP_OK;
+
+    return true;
+}
+
+
+// callChanges() - handle the /changes endpoint, which returns logged temperature samples and effector transitions in
+// the order in which they were logged, for incremental synchronisation.  Query arguments: "since" (a cursor; only
+// changes following it are returned; default 0, i.e. from the start of the log) and "limit" (max number of changes).
+// The response includes the cursor to pass as "since" to fetch the next batch, and a flag indicating whether there are
+// more changes to fetch.  Each table is read by a range scan of its primary key, the change sequence number, so the
+// cost of a request is proportional to the number of changes returned rather than to the size of the log.
+//
+bool HttpRequestHandler::callChanges() noexcept
+{
+    long long since = 0, limit = DEFAULT_CHANGES_LIMIT;
+
+    if(!intArg("since", since) || !intArg("limit", limit))
+        return true;
+
+    if(since < 0)
+        return respond(HTTP_BAD_REQUEST, "invalidArg", "since");
+
+    if(limit <= 0)
+        return respond(HTTP_BAD_REQUEST, "invalidArg", "limit");
+
+    limit = std::min(limit, (long long) MAX_CHANGES_LIMIT);
+
+    // Read one row more than the limit from each table, to find out whether there are further changes
+    SQLite& db = this->db();
+    SQLiteStmt temps, effectors;
+    Error err;
+
+    if(!db.prepare("SELECT seq, CAST(STRFTIME('%s', date_create) AS INTEGER) AS ts, sensor_id, temperature "
+                   "FROM temperature WHERE seq > :since ORDER BY seq LIMIT :limit", temps, &err)
+       || !temps.bind(":since", since, &err)
+       || !temps.bind(":limit", limit + 1, &err)
+       || !db.prepare("SELECT seq, CAST(STRFTIME('%s', date_create) AS INTEGER) AS ts, effector_id, newstate "
+                      "FROM effectorlog WHERE seq > :since ORDER BY seq LIMIT :limit", effectors, &err)
+       || !effectors.bind(":since", since, &err)
+       || !effectors.bind(":limit", limit + 1, &err))
+        return respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message());
+
+    // Merge the two result sets in sequence-number order
+    bool haveTemp = temps.step(&err), haveEffector = !err.code() && effectors.step(&err);
+    long long cursor = since, n = 0;
+
+    responseBody_.clear();
+
+    const Serializer_uptr_t w = serializer(responseBody_);
+
+    w->beginObject().beginArray("changes");
+
+    for(; (haveTemp || haveEffector) && !err.code() && (n < limit); ++n)
+    {
+        const bool isTemp = haveTemp && (!haveEffector || (temps[0].get<long long>() < effectors[0].get<long long>()));
+        SQLiteStmt& row = isTemp ? temps : effectors;
+
+        cursor = row[0].get<long long>();
+
+        w->beginObject()
+         .field("seq",          cursor)
+         .field("type",         isTemp ? "temperature" : "effector")
+         .field("timestamp",    row[1].get<long long>())
+         .field("channel",      row[2].get<int>());
+
+        if(isTemp)
+            w->field("value", row[3].get<double>());
+        else
+            w->field("value", row[3].get<int>());
+
+        w->endObject();
+
+        if(isTemp)
+            haveTemp = temps.step(&err);
+        else
+            haveEffector = effectors.step(&err);
+    }
+
+    if(err.code())
+    {
+        logWarning("HttpRequestHandler: /changes query failed: %s", err.message().c_str());
+        return respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message());
+    }
+
+    w->endArray()
+     .field("cursor",   cursor)
+     .field("more",     haveTemp || haveEffector)
+     .endObject();
+
+    statusCode_ = HTTP_OK;
+
+    return true;
+}
+
+
+// callImport() - handle the /options, /profiles and /temperatures endpoints, to which documents are POSTed for import
+// (see Importer).  The document has been imported by the time this method is called; report the outcome.  On failure,
+// the response identifies the offset in the document at which the import failed, and the number of records imported
+// before then, which are kept.
 //
+bool HttpRequestHandler::callImport() noexcept
+{
+    if(upload_ == nullptr)
+        return respond(HTTP_BAD_REQUEST, "error", "Missing request body");
+
+    statusCode_ = upload_->failed() ? HTTP_BAD_REQUEST : HTTP_OK;
+    responseBody_.clear();
+
+    const Serializer_uptr_t w = serializer(responseBody_);
+
+    w->beginObject()
+     .field("imported",     (unsigned long long) upload_->imported());
+
+    if(upload_->failed())
+        w->field("error",       upload_->error())
+         .field("offset",       (unsigned long long) upload_->offset());
+
+    w->endObject();
+
+    return true;
+}
+
 
 // callOption() - handle the /option endpoint
 //
 bool HttpRequestHandler::callOption() noexcept
 {
-    if(url_.args().find("key") == url_.args().end())
+    if(!url_.argExists("key"))
         return missingArg("key");
 
     return true;
 }
 
+
+
+// callSessions() - handle the /sessions endpoint.  The response is built from the most recent session-state snapshot,
+// so this method never waits for the session manager or touches the hardware; it is cached until the session manager
+// publishes a new snapshot.
+//
+bool HttpRequestHandler::callSessions() noexcept
+{
+    const SessionSnapshotSet_sptr_t snapshot = this->snapshot();
+
+    if(!snapshot->version)
+    {
+        // Nothing has been published yet - the session manager is still starting up.
+        return respond(HTTP_SERVICE_UNAVAILABLE, "error", "Session state not yet available");
+    }
+
+    cachedResponse_ = cache_.get("/sessions", format_, snapshot->version, [this, &snapshot](HttpResponse_t& r)
+    {
+        r.contentType = contentType_;
+        serializeSessions(*snapshot, *serializer(r.body));
+    });
+
+    return true;
+}
+
+
+// serializeSessions() - write <snapshot> to <w>.
+//
+void HttpRequestHandler::serializeSessions(const SessionSnapshotSet_t& snapshot, Serializer& w) noexcept
+{
+    w.beginObject()
+     .field("version",      (unsigned long long) snapshot.version)
+     .field("timestamp",    (long long) snapshot.timestamp)
+     .field("powerLoad",    snapshot.powerLoad)
+     .field("powerBudget",  snapshot.powerBudget);
+
+    if(snapshot.ambientTemp)
+        w.field("ambientTemp", snapshot.ambientTemp.C());
+
+    w.beginArray("sessions");
+
+    for(const auto& s : snapshot.sessions)
+    {
+        w.beginObject()
+         .field("id",           (int) s.id)
+         .field("gyleId",       (int) s.gyleId)
+         .field("gyleName",     s.gyleName)
+         .field("type",         (int) s.type)
+         .field("active",       s.active)
+         .field("complete",     s.complete)
+         .field("targetTemp",   s.targetTemp.C())
+         .field("overridden",   s.targetOverridden)
+         .field("held",         s.held)
+         .field("tempControl",  (int) s.tempControlState)
+         .field("remaining",    (long long) s.remainingTime)
+         .field("output",       s.controlOutput)
+         .field("autotuning",   s.autotuning)
+         .field("heater",       s.heaterState)
+         .field("cooler",       s.coolerState)
+         .field("powerWaiting", s.powerWaiting);
+
+        if(s.sensorInRange)
+            w.field("currentTemp", s.currentTemp.C());
+
+        if(s.timeToTarget >= 0.0)
+            w.field("timeToTarget", (long long) s.timeToTarget);
+
+        w.beginObject("model")
+         .field("valid",        s.modelValid)
+         .field("samples",      (long long) s.modelSamples)
+         .field("timeConstant", s.modelTimeConstant)
+         .field("heatRate",     s.modelHeatRate)
+         .field("coolRate",     s.modelCoolRate)
+         .field("coupling",     s.modelCoupling)
+         .endObject();
+
+        w.endObject();
+    }
+
+    w.endArray().endObject();
+}
+
+
+// callSessionCommand() - handle the /session/command and /session/{id}/command endpoints.  Arguments: "id" (session
+// id; taken from the path if present), "cmd" (command name; see SessionCommandQueue) and, for the "settarget" command,
+// "temp" (e.g. "18.5C"; a missing unit suffix implies Celsius).  The command is queued for the session manager; this
+// thread then waits for it to be executed.
+//
+bool HttpRequestHandler::callSessionCommand() noexcept
+{
+    if(!params_.exists("id") && !url_.argExists("id"))
+        return missingArg("id");
+
+    if(!url_.argExists("cmd"))
+        return missingArg("cmd");
+
+    session_id_t id;
+    if(!sessionIdArg(id))
+        return true;
+
+    const SessionCommandType_t type = SessionCommandQueue::fromName(url_.arg("cmd"));
+    double value = 0.0;
+
+    if(type == SESSION_CMD_NONE)
+    {
+        return respond(HTTP_BAD_REQUEST, "invalidArg", "cmd");
+    }
+
+    if(type == SESSION_CMD_SET_TARGET)
+    {
+        if(!url_.argExists("temp"))
+            return missingArg("temp");
+
+        // Query args are not NUL-terminated, so copy the arg for strtod()
+        const string_view temp = url_.arg("temp");
+        char str[32];
+
+        if(temp.length() >= sizeof(str))
+            return respond(HTTP_BAD_REQUEST, "invalidArg", "temp");
+
+        ::memcpy(str, temp.data(), temp.length());
+        str[temp.length()] = '\0';
+
+        char *end = nullptr;
+        const double t = ::strtod(str, &end);
+        const TemperatureUnit_t unit = *end ? Temperature::unitFromChar(*end) : TEMP_UNIT_CELSIUS;
+
+        if((end == str) || (unit == TEMP_UNIT_UNKNOWN))
+        {
+            return respond(HTTP_BAD_REQUEST, "invalidArg", "temp");
+        }
+
+        value = Temperature(t, unit).C();
+    }
+
+    future<Error> result = Registry::instance().sessionCommands().submit(type, id, value);
+
+    if(result.wait_for(std::chrono::seconds(SESSION_COMMAND_TIMEOUT_S)) != future_status::ready)
+    {
+        return respond(HTTP_SERVICE_UNAVAILABLE, "error", "Timed out waiting for session manager");
+    }
+
+    const Error err = result.get();
+
+    switch(err.code())
+    {
+        case NO_ERROR:
+            statusCode_ = HTTP_OK;
+            break;
+
+        case NO_SUCH_SESSION:
+            statusCode_ = HTTP_NOT_FOUND;
+            break;
+
+        case SESSION_MANAGER_STOPPING:
+            statusCode_ = HTTP_SERVICE_UNAVAILABLE;
+            break;
+
+        default:
+            statusCode_ = HTTP_CONFLICT;
+            break;
+    }
+
+    const Serializer_uptr_t writer = serializer(responseBody_);
+    Serializer& w = *writer;
+
+    w.beginObject()
+     .field("id",       id)
+     .field("cmd",      SessionCommandQueue::name(type))
+     .field("success",  err.code() == NO_ERROR);
+
+    if(err.code())
+        w.field("error", err.message());
+
+    w.endObject();
+
+    return true;
+}
+
+
+// callSessionHistory() - handle the /session/{id}/history endpoint.  Arguments (all optional): "from" and "to" (Unix
+// times; default to, and are limited to, the start and end of the session), "points" (max number of buckets) and "mode"
+// ("minmax", "avg" or "lttb"; see HistoryStream).  The response body is produced from a cursor over the temperature log
+// as the client reads it; it is encoded as application/x-brewctl-ts if the client accepts that type, otherwise in the
+// negotiated format.
+//
+bool HttpRequestHandler::callSessionHistory() noexcept
+{
+    session_id_t id;
+    if(!sessionIdArg(id))
+        return true;
+
+    SQLite& db = this->db();
+    SQLiteStmt session, sensor;
+    Error err;
+
+    if(!db.prepare("SELECT CAST(STRFTIME('%s', COALESCE(date_start, date_create)) AS INTEGER) AS start, "
+                   "CAST(STRFTIME('%s', COALESCE(date_finish, 'now')) AS INTEGER) AS finish "
+                   "FROM session WHERE id=:id", session, &err)
+       || !session.bind(":id", id, &err)
+       || !db.prepare("SELECT channel FROM temperaturesensor WHERE role='vessel' AND session_id=:id", sensor, &err)
+       || !sensor.bind(":id", id, &err))
+        return respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message());
+
+    if(!session.step(&err))
+        return err.code() ? respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message()) : notFound();
+
+    if(!sensor.step(&err))
+    {
+        return err.code() ? respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message())
+                          : respond(HTTP_NOT_FOUND, "error", "Session has no vessel temperature sensor");
+    }
+
+    const long long start = session["start"].get<long long>(), finish = session["finish"].get<long long>() + 1;
+    long long from = start, to = finish, points = DEFAULT_HISTORY_POINTS;
+
+    if(!intArg("from", from) || !intArg("to", to) || !intArg("points", points))
+        return true;
+
+    from = std::max(from, start);
+    to = std::min(to, finish);
+
+    if(to <= from)
+        return respond(HTTP_BAD_REQUEST, "invalidArg", "to");
+
+    if(points <= 0)
+        return respond(HTTP_BAD_REQUEST, "invalidArg", "points");
+
+    const HistoryMode_t mode = url_.argExists("mode") ? HistoryStream::modeFromName(url_.arg("mode"))
+                                                      : HISTORY_MINMAX;
+    if(mode == HISTORY_INVALID)
+        return respond(HTTP_BAD_REQUEST, "invalidArg", "mode");
+
+    auto stream = std::make_shared<HistoryStream>(id, sensor["channel"].get<int>(), from, to,
+                                                  std::min(points, (long long) MAX_HISTORY_POINTS), mode,
+                                                  format_, accepts(TimeSeries::CONTENT_TYPE));
+    if(!stream->init(db, &err))
+        return respond(HTTP_INTERNAL_SERVER_ERROR, "error", err.message());
+
+    statusCode_ = HTTP_OK;
+    contentType_ = stream->contentType();
+    stream_ = stream;
+
+    return true;
+}
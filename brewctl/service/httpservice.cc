@@ -10,59 +10,265 @@
 #include "include/framework/registry.h"
 #include "include/framework/thread.h"
 #include "include/service/httprequesthandler.h"
-#include "include/util/string.h"
+#include "include/sqlite/sqlitestmt.h"
+#include "include/util/net.h"
+#include "include/util/sys.h"
+#include "include/util/url.h"
+#include "include/util/validator.h"
+#include <algorithm>        // std::min()
+#include <cerrno>
+#include <cstdio>           // ::snprintf()
 #include <cstdlib>          // NULL
-#include <cstring>          // ::memcpy(), ::strdup()
+#include <cstring>          // ::memcpy(), ::strcmp()
+#include <set>
 #include <string>
 
 extern "C"
 {
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 }
 
+using std::lock_guard;
+using std::mutex;
+using std::set;
 using std::string;
+namespace Validator = Util::Validator;
 
 
-// ctor - member initialisation only
+static const int
+    DEFAULT_THREAD_POOL_SIZE        = 2,    // Default number of daemon threads polling and serving connections
+    DEFAULT_CONNECTION_LIMIT        = 32,   // Default max number of concurrent connections
+    DEFAULT_CONNECTION_TIMEOUT_S    = 30,   // Default time after which an idle (keep-alive) connection is closed
+    DEFAULT_STREAM_POLL_INTERVAL_MS = 250,  // Default interval between polls of idle event streams for new events
+    DEFAULT_STREAM_KEEPALIVE_S      = 15,   // Default max interval between writes to an idle event stream
+    DEFAULT_COMPRESS_MIN_BYTES      = 1024, // Default min size of a response body which will be compressed
+    DEFAULT_STATIC_MAX_AGE_S        = 86400,// Default time for which clients may cache a static asset
+    DEFAULT_MAX_UPLOAD_BYTES        = 16 * 1024 * 1024, // Default max size of a request body
+    UNIX_SOCKET_THREAD_POOL_SIZE    = 1;    // Number of daemon threads serving the Unix-domain socket
+
+static const char * const
+    DEFAULT_UNIX_SOCKET             = "/home/swallace/cjbc/brewctl/brewctl.sock";   // Socket path; "" = disabled
+
+static const char * const
+    DEFAULT_STATIC_DIR              = "/home/swallace/cjbc/brewctl/dashboard";      // Asset root; "" = disabled
+
+static const char * const
+    STATIC_URL_PREFIX               = "/dashboard";     // URL path under which static assets are served
+
+static const char
+    FORBIDDEN_BODY[]                = "{\"error\":\"Forbidden\"}";
+
+static const char
+    TOO_LARGE_BODY[]                = "{\"error\":\"Request body too large\"}";
+
+static const double
+    DAEMON_START_RETRY_S            = 1.0;  // Interval between attempts to start the daemon
+
+static const size_t
+    RESPONSE_BLOCK_SIZE             = 4096; // Max size of each block of a response body passed to MHD
+
+
+// ctor - read daemon parameters from config.  If <listenFd> is not -1, it is a listening socket inherited from a
+// previous instance of the application (see Handoff), and is used instead of binding a new socket to <port>.
 //
-HttpService::HttpService(const unsigned short port) noexcept
-    : Thread(), port_(port), daemon_(NULL)
+HttpService::HttpService(const unsigned short port, const int listenFd) noexcept
+    : Thread(), port_(port), listenFd_(listenFd), unixSocketGid_((gid_t) -1), daemon_(NULL), unixDaemon_(NULL),
+      stopping_(false)
 {
+    auto& config = Registry::instance().config();
+
+    threadPoolSize_ = config.get("service.thread_pool_size", DEFAULT_THREAD_POOL_SIZE, Validator::gt0);
+    connectionLimit_ = config.get("service.connection_limit", DEFAULT_CONNECTION_LIMIT, Validator::gt0);
+    connectionTimeout_ = config.get("service.connection_timeout_s", DEFAULT_CONNECTION_TIMEOUT_S, Validator::gt0);
+    streamPollInterval_ = config.get("service.stream_poll_interval_ms", DEFAULT_STREAM_POLL_INTERVAL_MS,
+                                     Validator::gt0);
+    streamKeepalive_ = config.get("service.stream_keepalive_s", DEFAULT_STREAM_KEEPALIVE_S, Validator::gt0);
+    compressMinBytes_ = config.get("service.compress_min_bytes", DEFAULT_COMPRESS_MIN_BYTES, Validator::ge0);
+    maxUploadBytes_ = config.get("service.max_upload_bytes", DEFAULT_MAX_UPLOAD_BYTES, Validator::gt0);
+    staticMaxAge_ = config.get("service.static_max_age_s", DEFAULT_STATIC_MAX_AGE_S, Validator::ge0);
+    unixSocketPath_ = config.get<string>("service.unix_socket", DEFAULT_UNIX_SOCKET);
+
+    const string group = config.get<string>("service.unix_socket_group", "");
+    if(!group.empty())
+    {
+        Error err;
+
+        unixSocketGid_ = Util::Sys::getGid(group, &err);
+        if(unixSocketGid_ == (gid_t) -1)
+            logWarning("HTTP service: ignoring Unix socket group: %s", err.message().c_str());
+    }
+
+    // The asset manifest is built once, here; assets added or changed later are not served until the next restart
+    const string staticDir = config.get<string>("service.static_dir", DEFAULT_STATIC_DIR);
+    if(!staticDir.empty())
+    {
+        Error err;
+
+        if(!assets_.load(staticDir, STATIC_URL_PREFIX, &err))
+            logWarning("HTTP service: not serving static assets from %s: %s", staticDir.c_str(),
+                       err.message().c_str());
+    }
 }
 
 
-// run() - main exection method for the Service thread.  Start the daemon, accept connections, etc.
+// run() - main exection method for the Service thread.  Start the daemon, retrying periodically if it fails to start.
+// The daemon runs a pool of <threadPoolSize_> threads, each polling its share of the connections with epoll, so
+// connections are cheap to keep open: clients may reuse a connection (HTTP/1.1 keep-alive) until it has been idle for
+// <connectionTimeout_> seconds.  Event streams with nothing to send are suspended; this thread resumes them every
+// <streamPollInterval_> ms, so that they can check for new events.  If a Unix-domain socket is configured, a second
+// daemon serves the same routes on it to local clients.
 //
 bool HttpService::run() noexcept
 {
     running_ = true;
     setName("http");
 
+    double lastStartAttempt = -DAEMON_START_RETRY_S;
+
     while(!stop_)
     {
-        daemon_ = ::MHD_start_daemon(MHD_USE_THREAD_PER_CONNECTION,
-                                     port_,
-                                     NULL,
-                                     NULL,
-                                     HttpService::callbackHandleConnection, this,
-                                     MHD_OPTION_NOTIFY_COMPLETED,
-                                     HttpService::callbackRequestCompleted, this,
-                                     MHD_OPTION_URI_LOG_CALLBACK,
-                                     HttpService::callbackLogUri, this,
-                                     MHD_OPTION_END);
-
-        ::usleep(1000 * 1000);
+        const double now = Util::Sys::monotonicTime();
+
+        if(((daemon_ == NULL) || ((unixDaemon_ == NULL) && !unixSocketPath_.empty()))
+           && ((now - lastStartAttempt) >= DAEMON_START_RETRY_S))
+        {
+            lastStartAttempt = now;
+
+            if(daemon_ == NULL)
+            {
+                daemon_ = startDaemon(port_, listenFd_, threadPoolSize_);
+                if(daemon_ == NULL)
+                    logWarning("HTTP service: failed to start daemon; retrying");
+            }
+
+            if((unixDaemon_ == NULL) && !unixSocketPath_.empty())
+                startUnixDaemon();
+        }
+
+        ::usleep(streamPollInterval_ * 1000);
+        resumeStreams();
     }
 
-    // Stop service
+    // Stop service.  The daemon can't be stopped while connections are suspended, so end all event streams first.
     logInfo("HTTP service stopping");
-    MHD_stop_daemon(daemon_);
+    {
+        lock_guard<mutex> lock(streamLock_);
+        stopping_ = true;
+    }
+
+    resumeStreams();
+
+    if(daemon_ != NULL)
+        MHD_stop_daemon(daemon_);
+
+    if(unixDaemon_ != NULL)
+    {
+        MHD_stop_daemon(unixDaemon_);
+        ::unlink(unixSocketPath_.c_str());
+    }
+
+    daemon_ = unixDaemon_ = NULL;
     running_ = false;
 
     return false;
 }
 
 
+// startDaemon() - start an MHD daemon, with a pool of <threadPoolSize> threads, listening on <port> or, if <listenFd>
+// is not -1, on the already-listening socket <listenFd>.  Returns NULL if the daemon fails to start.
+//
+MHD_Daemon *HttpService::startDaemon(const unsigned short port, const int listenFd, const int threadPoolSize) noexcept
+{
+    // MHD_OPTION_LISTEN_SOCKET must be the last option, so that it is omitted if there is no listening socket
+    return ::MHD_start_daemon(MHD_USE_EPOLL_INTERNALLY | MHD_USE_PIPE_FOR_SHUTDOWN | MHD_USE_SUSPEND_RESUME,
+                              port,
+                              NULL,
+                              NULL,
+                              HttpService::callbackHandleConnection, this,
+                              MHD_OPTION_NOTIFY_COMPLETED, HttpService::callbackRequestCompleted, this,
+                              MHD_OPTION_THREAD_POOL_SIZE, (unsigned int) threadPoolSize,
+                              MHD_OPTION_CONNECTION_LIMIT, (unsigned int) connectionLimit_,
+                              MHD_OPTION_CONNECTION_TIMEOUT, (unsigned int) connectionTimeout_,
+                              (listenFd != -1) ? MHD_OPTION_LISTEN_SOCKET : MHD_OPTION_END, listenFd,
+                              MHD_OPTION_END);
+}
+
+
+// startUnixDaemon() - start a daemon listening on the Unix-domain socket <unixSocketPath_>.  The socket is accessible to
+// its owner and, if <unixSocketGid_> is set, to members of that group; clients are also authorised individually, by
+// their credentials, as each request arrives (see peerAuthorised()).
+//
+void HttpService::startUnixDaemon() noexcept
+{
+    Error err;
+    const bool groupAccess = (unixSocketGid_ != (gid_t) -1);
+    const int fd = Util::Net::listenUnix(unixSocketPath_, groupAccess ? 0660 : 0600, connectionLimit_, &err);
+
+    if(fd == -1)
+    {
+        logWarning("HTTP service: failed to listen on %s: %s; retrying", unixSocketPath_.c_str(),
+                   err.message().c_str());
+        return;
+    }
+
+    if(groupAccess && ::chown(unixSocketPath_.c_str(), (uid_t) -1, unixSocketGid_))
+        logWarning("HTTP service: failed to set group of %s: %s", unixSocketPath_.c_str(), ::strerror(errno));
+
+    unixDaemon_ = startDaemon(0, fd, UNIX_SOCKET_THREAD_POOL_SIZE);
+    if(unixDaemon_ == NULL)
+    {
+        logWarning("HTTP service: failed to start daemon on %s; retrying", unixSocketPath_.c_str());
+        ::close(fd);
+        ::unlink(unixSocketPath_.c_str());
+    }
+    else
+        logInfo("HTTP service: listening on %s", unixSocketPath_.c_str());
+}
+
+
+// peerAuthorised() - return true if the client of <connection>, which must have been accepted by the Unix-domain socket
+// daemon, is authorised to use the API: i.e. if it runs as root, as the same user as this process or, if a socket group
+// is configured, as a member (by primary group) of that group.
+//
+bool HttpService::peerAuthorised(struct MHD_Connection *connection) const noexcept
+{
+    const union MHD_ConnectionInfo * const info =
+        MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CONNECTION_FD);
+    uid_t uid;
+    gid_t gid;
+
+    if((info == NULL) || !Util::Net::peerCredentials(info->connect_fd, uid, gid))
+    {
+        logWarning("HTTP service: failed to read the credentials of a Unix socket client");
+        return false;
+    }
+
+    if((uid == 0) || (uid == ::geteuid()) || ((unixSocketGid_ != (gid_t) -1) && (gid == unixSocketGid_)))
+        return true;
+
+    logWarning("HTTP service: refused request from uid %d, gid %d on %s", (int) uid, (int) gid,
+               unixSocketPath_.c_str());
+    return false;
+}
+
+
+// quiesce() - stop accepting new connections, and return the listening socket, which the daemon will no longer close
+// when it is stopped.  Used to hand the socket to a new instance of the application.  Returns -1 if the daemon is not
+// running.
+//
+int HttpService::quiesce() noexcept
+{
+    if(daemon_ == NULL)
+        return -1;
+
+    const MHD_socket fd = MHD_quiesce_daemon(daemon_);
+
+    return (fd == MHD_INVALID_SOCKET) ? -1 : fd;
+}
+
+
 // handleConnection() - respond to an inbound connection
 //
 int HttpService::handleConnection(struct MHD_Connection *connection, const char *url, const char *method,
@@ -70,58 +276,424 @@ int HttpService::handleConnection(struct MHD_Connection *connection, const char
                                   void **con_cls) noexcept
 {
     (void) version;
-    (void) upload_data;
-    (void) upload_data_size;
-    (void) con_cls;
 
     struct MHD_Response *response;
     int ret;
-    string fullUrl(url);
 
+    // A request whose body is imported is handled over several calls: one when its headers have been read, which sets
+    // up the upload context; one for each chunk of the body (see handleUpload()); and a last one, when the body is
+    // complete, which completes the import and then handles the request as any other.  The request's handler reports
+    // the outcome of the import.  If the request has been refused, a response has been queued already; the rest of the
+    // body is discarded.
     if(*con_cls != NULL)
-        fullUrl += (const char *) *con_cls;
-    
-    HttpRequestHandler handler(method, fullUrl);
+    {
+        UploadContext_t * const upload = (UploadContext_t *) *con_cls;
+
+        if(upload->refused)
+        {
+            *upload_data_size = 0;
+            return MHD_YES;
+        }
+
+        if(*upload_data_size)
+            return handleUpload(connection, upload, upload_data, upload_data_size);
+
+        if(upload->importer != nullptr)
+            upload->importer->finish();
+    }
+    else if(unixDaemon_ != NULL)
+    {
+        // Requests on the Unix-domain socket are authorised by the credentials of the client process
+        const union MHD_ConnectionInfo * const info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_DAEMON);
+
+        if((info != NULL) && (info->daemon == unixDaemon_) && !peerAuthorised(connection))
+            return queueStatus(connection, HttpRequestHandler::HTTP_FORBIDDEN, FORBIDDEN_BODY,
+                               sizeof(FORBIDDEN_BODY) - 1);
+    }
+
+    // Documents POSTed to an import endpoint are written to the database as they arrive.  A body which is declared to
+    // be too large is refused before any of it is read.
+    if((*con_cls == NULL) && !::strcmp(method, MHD_HTTP_METHOD_POST))
+    {
+        Importer * const importer = Importer::create(url);
+        if(importer != nullptr)
+        {
+            const char * const length = MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                                    MHD_HTTP_HEADER_CONTENT_LENGTH);
+            UploadContext_t * const upload = new UploadContext_t;
+
+            upload->received = 0;
+            upload->refused = false;
+            *con_cls = upload;      // Freed by callbackRequestCompleted()
+
+            if((length != NULL) && (::strtoull(length, nullptr, 10) > (unsigned long long) maxUploadBytes_))
+            {
+                delete importer;
+                upload->refused = true;
+                return queueStatus(connection, HttpRequestHandler::HTTP_PAYLOAD_TOO_LARGE, TOO_LARGE_BODY,
+                                   sizeof(TOO_LARGE_BODY) - 1);
+            }
+
+            upload->importer.reset(importer);
+            importer->begin();      // On failure, the error is reported when the upload is complete
+
+            return MHD_YES;
+        }
+    }
+
+    // MHD has already split the path from the query, and decoded both, in the connection's own buffers; the URL refers
+    // to those buffers, which remain valid for the duration of the request, rather than copying them
+    Util::URL requestUrl;
+
+    requestUrl.setPath(url);
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, HttpService::callbackAddArg, &requestUrl);
+
+    // The /stream endpoint is served directly, as a long-lived response rather than a document
+    if(!::strcmp(url, "/stream") && !::strcmp(method, MHD_HTTP_METHOD_GET))
+        return handleStream(connection, requestUrl);
+
+    // Static assets are served directly from their files
+    if(!::strcmp(method, MHD_HTTP_METHOD_GET) || !::strcmp(method, MHD_HTTP_METHOD_HEAD))
+    {
+        const StaticAssets::Asset_t * const asset = assets_.find(url);
+        if(asset != nullptr)
+            return handleAsset(connection, *asset);
+    }
+
+    HttpRequestHandler handler(method, requestUrl,
+                               MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT),
+                               (*con_cls != NULL) ? ((UploadContext_t *) *con_cls)->importer.get() : nullptr);
 
     handler.handleRequest();    // TODO check return value
 
-    response = MHD_create_response_from_buffer(handler.responseLength(), (void *) handler.responseBody().c_str(),
-                                               MHD_RESPMEM_MUST_COPY);
+    const HttpResponse_sptr_t body = handler.response();
+    unsigned int status = body->status;
+
+    // Compress the body if the client accepts a supported content-coding, unless the body is too small for compression
+    // to be worthwhile.  Streamed bodies, whose size is unknown, are always compressed.
+    ContentEncoding_t encoding =
+        Compressor::negotiate(MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                          MHD_HTTP_HEADER_ACCEPT_ENCODING));
+
+    const string *encodedBody = &body->body;
+
+    if(!body->stream && (encoding != ENCODING_IDENTITY))
+    {
+        if(body->body.length() < (size_t) compressMinBytes_)
+            encoding = ENCODING_IDENTITY;
+        else if((encodedBody = &body->encodedBody(encoding))->empty())
+        {
+            // Compression failed; send the body uncompressed
+            encoding = ENCODING_IDENTITY;
+            encodedBody = &body->body;
+        }
+    }
+
+    // Each content-coding is a distinct representation of the response, so must have its own entity tag
+    string etag = body->etag;
+    if(!etag.empty() && (encoding != ENCODING_IDENTITY))
+        etag.insert(etag.length() - 1, string("-") + Compressor::name(encoding));
+
+    if(!etag.empty()
+       && etagMatches(MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH), etag))
+    {
+        // The client already holds the current version of the response
+        status = HttpRequestHandler::HTTP_NOT_MODIFIED;
+        response = MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT);
+    }
+    else
+    {
+        // The body is served from the (possibly cached, shared) response itself.  MHD holds a reference to the response
+        // until it has finished sending it, and releases it by calling callbackFreeResponse().
+        ResponseContext_t * const ctx = new ResponseContext_t;
+
+        ctx->response = body;
+        ctx->body = encodedBody;
+        if(body->stream)
+            ctx->stream = (encoding != ENCODING_IDENTITY)
+                            ? ResponseStream_sptr_t(new CompressedStream(body->stream, encoding)) : body->stream;
+
+        response = MHD_create_response_from_callback(ctx->stream ? MHD_SIZE_UNKNOWN : ctx->body->length(),
+                                                     RESPONSE_BLOCK_SIZE,
+                                                     HttpService::callbackReadResponse,
+                                                     ctx,
+                                                     HttpService::callbackFreeResponse);
+
+        MHD_add_response_header(response, "Content-Type", body->contentType);
+        if(encoding != ENCODING_IDENTITY)
+            MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, Compressor::name(encoding));
+    }
+
+    // The representation of the response depends on the Accept header (see HttpRequestHandler::negotiateFormat()) and
+    // on the Accept-Encoding header
+    MHD_add_response_header(response, "Vary", "Accept, Accept-Encoding");
+
+    if(!etag.empty())
+    {
+        // Clients may keep the response, but must revalidate it before each use
+        MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, etag.c_str());
+        MHD_add_response_header(response, MHD_HTTP_HEADER_CACHE_CONTROL, "no-cache");
+    }
+
+    ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+
+    return ret;
+}
+
+
+// handleUpload() - consume a chunk, <upload_data>, of length <*upload_data_size>, of the body of a request which is
+// being imported, as described by <upload>.  The chunk is parsed, and any records it completes are written,
+// immediately, so it need not be kept.  If the body exceeds <maxUploadBytes_>, the import is abandoned, and its current
+// transaction rolled back, as soon as the limit is reached.  Records committed before then are kept; the response says
+// how many.
+//
+int HttpService::handleUpload(struct MHD_Connection *connection, UploadContext_t *upload, const char *upload_data,
+                              size_t *upload_data_size) noexcept
+{
+    const size_t len = *upload_data_size;
+
+    *upload_data_size = 0;      // The chunk has been consumed
+
+    upload->received += len;
+    if(upload->received > (size_t) maxUploadBytes_)
+    {
+        const size_t imported = upload->importer->imported();
+        char body[192];
+
+        upload->importer.reset();
+        upload->refused = true;
+
+        const int bodyLen = ::snprintf(body, sizeof(body), "{\"error\":\"Request body too large; the %zu record(s) "
+                                       "imported before the limit was reached have been kept\",\"imported\":%zu}",
+                                       imported, imported);
+
+        return queueStatus(connection, HttpRequestHandler::HTTP_PAYLOAD_TOO_LARGE, body, bodyLen);
+    }
+
+    upload->importer->feed(upload_data, len);
+    return MHD_YES;
+}
+
 
-    MHD_add_response_header(response, "Content-Length", Util::String::numberToString(handler.responseLength()).c_str());
+// queueStatus() - respond to the request on <connection> with status <status> and the JSON body <body>, of length
+// <len>.  The body is copied.
+//
+int HttpService::queueStatus(struct MHD_Connection *connection, const unsigned int status, const char *body,
+                             const size_t len) noexcept
+{
+    struct MHD_Response * const response = MHD_create_response_from_buffer(len, (void *) body,
+                                                                            MHD_RESPMEM_MUST_COPY);
     MHD_add_response_header(response, "Content-Type", "text/json");
-    MHD_add_response_header(response, "Connection", "close");
 
-    ret = MHD_queue_response(connection, handler.statusCode(), response);
+    const int ret = MHD_queue_response(connection, status, response);
     MHD_destroy_response(response);
 
     return ret;
 }
 
 
-// logUri() - called via HttpService::callbackLogUri() to receive the full URI of the connection request, including any
-// query arguments.
+// handleAsset() - serve the static asset <asset> on <connection>.  The file is sent by the kernel (using sendfile())
+// rather than being copied through a buffer.  Clients which accept gzip are sent the asset's pre-compressed sibling, if
+// it has one.  HTML documents, whose URLs are fixed, must be revalidated before each use; other assets, which are
+// expected to have versioned URLs, may be cached for <staticMaxAge_> seconds.
 //
-void *HttpService::logUri(const char *uri) noexcept
+int HttpService::handleAsset(struct MHD_Connection *connection, const StaticAssets::Asset_t& asset) noexcept
 {
-    string s(uri);
-    s.erase(0, s.find('?'));
+    const bool gzip = asset.hasGzip
+                      && (Compressor::negotiate(MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                                            MHD_HTTP_HEADER_ACCEPT_ENCODING))
+                          == ENCODING_GZIP);
+    const StaticAssets::File_t& file = gzip ? asset.gzipFile : asset.file;
+
+    struct MHD_Response *response;
+    const int fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    struct stat st;
+
+    if((fd == -1) || ::fstat(fd, &st))
+    {
+        logWarning("HTTP service: failed to open static asset %s: %s", file.path.c_str(), ::strerror(errno));
+        if(fd != -1)
+            ::close(fd);
+
+        response = MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT);
+        const int ret = MHD_queue_response(connection, HttpRequestHandler::HTTP_NOT_FOUND, response);
+        MHD_destroy_response(response);
+
+        return ret;
+    }
+
+    // If the file has changed since the manifest was built, its entity tag is stale, so is neither matched nor sent
+    const bool validEtag = (st.st_size == file.size) && (st.st_mtime == file.mtime);
+    unsigned int status = HttpRequestHandler::HTTP_OK;
 
-    return (void *) ::strdup(s.c_str());
+    if(validEtag
+       && etagMatches(MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_IF_NONE_MATCH),
+                      file.etag))
+    {
+        // The client already holds the current version of the asset
+        ::close(fd);
+        status = HttpRequestHandler::HTTP_NOT_MODIFIED;
+        response = MHD_create_response_from_buffer(0, NULL, MHD_RESPMEM_PERSISTENT);
+    }
+    else
+    {
+        // MHD closes the file when it has finished sending it
+        response = MHD_create_response_from_fd(st.st_size, fd);
+        if(response == NULL)
+        {
+            ::close(fd);
+            return MHD_NO;
+        }
+
+        MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_TYPE, asset.contentType);
+        if(gzip)
+            MHD_add_response_header(response, MHD_HTTP_HEADER_CONTENT_ENCODING, "gzip");
+    }
+
+    if(asset.hasGzip)
+        MHD_add_response_header(response, "Vary", "Accept-Encoding");
+
+    if(validEtag)
+        MHD_add_response_header(response, MHD_HTTP_HEADER_ETAG, file.etag.c_str());
+
+    if(!::strncmp(asset.contentType, "text/html", 9))
+        MHD_add_response_header(response, MHD_HTTP_HEADER_CACHE_CONTROL, "no-cache");
+    else
+    {
+        const string cacheControl = "public, max-age=" + std::to_string(staticMaxAge_);
+        MHD_add_response_header(response, MHD_HTTP_HEADER_CACHE_CONTROL, cacheControl.c_str());
+    }
+
+    const int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+
+    return ret;
 }
 
 
-// requestCompleted() - called via HttpService::callbackRequestCompleted() to indicate that the current request is
-// fully processed.
+// handleStream() - start a Server-Sent Events stream of telemetry on <connection>.  Query arguments: "session" restricts
+// events to those of one session; "interval_ms" sets the min interval between sample events from each sensor.  A client
+// reconnecting with a Last-Event-ID header resumes from the event following the one it names, provided that the event
+// is still on the telemetry bus.
 //
-void HttpService::requestCompleted(struct MHD_Connection *connection, void **con_cls,
-                                   enum MHD_RequestTerminationCode code) noexcept
+int HttpService::handleStream(struct MHD_Connection *connection, Util::URL& url) noexcept
 {
-    (void) connection;
-    (void) code;
+    long long session = 0, interval = 0;
 
-    if(*con_cls != NULL)
-        ::free(*con_cls);    
+    url.argInt("session", session);
+    url.argInt("interval_ms", interval);
+
+    const int sessionId = session;
+    const int minInterval = std::max(0LL, interval);
+    const char * const lastEventId = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Last-Event-ID");
+    set<int> effectorChannels;
+
+    // Effector transitions are not tagged with a session, so look up the channels of the session's effectors
+    if(sessionId)
+    {
+        SQLiteStmt stmt;
+        Error err;
+
+        if(Registry::instance().db().prepare("SELECT channel FROM sessioneffector WHERE session_id=:sessionId", stmt,
+                                             &err)
+           && stmt.bind(":sessionId", sessionId, &err))
+        {
+            while(stmt.step(&err))
+                effectorChannels.insert(stmt["channel"].get<int>());
+        }
+    }
+
+    StreamContext_t * const ctx = new StreamContext_t;
+
+    ctx->service = this;
+    ctx->stream.reset(new EventStream(Registry::instance().telemetry(), connection, sessionId, effectorChannels,
+                                      minInterval, streamKeepalive_ * 1000,
+                                      (lastEventId != NULL) ? ::strtoll(lastEventId, nullptr, 10) : -1));
+
+    struct MHD_Response * const response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, RESPONSE_BLOCK_SIZE,
+                                                                             HttpService::callbackReadStream, ctx,
+                                                                             HttpService::callbackFreeStream);
+
+    MHD_add_response_header(response, "Content-Type", "text/event-stream");
+    MHD_add_response_header(response, MHD_HTTP_HEADER_CACHE_CONTROL, "no-cache");
+
+    const int ret = MHD_queue_response(connection, HttpRequestHandler::HTTP_OK, response);
+    MHD_destroy_response(response);
+
+    return ret;
+}
+
+
+// readStream() - called via HttpService::callbackReadStream() to obtain the next block of the event stream <stream>.
+// If the stream has nothing to send, suspend its connection, so that the daemon does not poll it continually; run()
+// will resume it.
+//
+ssize_t HttpService::readStream(const EventStream_sptr_t& stream, char *buf, size_t max) noexcept
+{
+    const ssize_t len = stream->read(buf, max);
+    if(len)
+        return len;
+
+    lock_guard<mutex> lock(streamLock_);
+
+    if(stopping_)
+        return MHD_CONTENT_READER_END_OF_STREAM;
+
+    MHD_suspend_connection(stream->connection());
+    suspendedStreams_.push_back(stream);
+
+    return 0;
+}
+
+
+// resumeStreams() - resume the connections of all suspended event streams.
+//
+void HttpService::resumeStreams() noexcept
+{
+    lock_guard<mutex> lock(streamLock_);
+
+    for(auto& stream : suspendedStreams_)
+        MHD_resume_connection(stream->connection());
+
+    suspendedStreams_.clear();
+}
+
+
+// etagMatches() - return true if the value of an If-None-Match request header, <header>, matches <etag>.  The header
+// holds either "*" or a comma-separated list of entity tags, each of which may be weak (i.e. prefixed with "W/").
+//
+bool HttpService::etagMatches(const char *header, const string& etag) noexcept
+{
+    if(header == NULL)
+        return false;
+
+    const string tags(header);
+    size_t pos = 0;
+
+    while(pos < tags.length())
+    {
+        size_t end = tags.find(',', pos);
+        if(end == string::npos)
+            end = tags.length();
+
+        size_t start = tags.find_first_not_of(" \t", pos);
+        const size_t last = tags.find_last_not_of(" \t", end - 1);
+
+        if((start < end) && (last != string::npos) && (last >= start))
+        {
+            if(!tags.compare(start, 2, "W/"))
+                start += 2;
+
+            const string tag = tags.substr(start, last + 1 - start);
+            if((tag == "*") || (tag == etag))
+                return true;
+        }
+
+        pos = end + 1;
+    }
+
+    return false;
 }
 
 
@@ -137,20 +709,87 @@ int HttpService::callbackHandleConnection(void *cls, struct MHD_Connection *conn
 }
 
 
-// callbackLogUri() - static callback fn, called with a request's full URI (including query parameters).  Redirects the
-// call to the HttpServer::logUri() method.
+// callbackAddArg() - static callback fn, called by MHD_get_connection_values() for each of a request's (decoded) query
+// args.  <cls> is a ptr to the Util::URL to which the arg is added.  A key-only arg ("?key") has a null value.
 //
-void *HttpService::callbackLogUri(void *cls, const char *uri) noexcept
+int HttpService::callbackAddArg(void *cls, enum MHD_ValueKind kind, const char *key, const char *value) noexcept
 {
-    return ((HttpService *) cls)->logUri(uri);
+    (void) kind;
+
+    ((Util::URL *) cls)->addArg(key, (value != NULL) ? value : "", true);
+
+    return MHD_YES;
 }
 
 
-// callbackRequestCompleted() - static callback fn, called when a request is completed processed.  Redirects the call to
-// the HttpServer::requestCompleted() method.
+// callbackRequestCompleted() - static callback fn, called by MHD when a request has been completed, successfully or
+// otherwise.  Frees the request's upload context, if any, rolling back any uncommitted part of its import.
 //
 void HttpService::callbackRequestCompleted(void *cls, struct MHD_Connection *connection, void **con_cls,
                                            enum MHD_RequestTerminationCode code) noexcept
 {
-    return ((HttpService *) cls)->requestCompleted(connection, con_cls, code);
+    (void) cls;
+    (void) connection;
+    (void) code;
+
+    delete (UploadContext_t *) *con_cls;
+    *con_cls = NULL;
+}
+
+
+// callbackReadResponse() - static callback fn, called by MHD to obtain the next block of a response body.  <cls> is a
+// ptr to a ResponseContext_t.  The body is read from the context's stream, if it has one.
+//
+ssize_t HttpService::callbackReadResponse(void *cls, uint64_t pos, char *buf, size_t max) noexcept
+{
+    const ResponseContext_t& ctx = *((ResponseContext_t *) cls);
+
+    if(ctx.stream)
+    {
+        const ssize_t len = ctx.stream->read(buf, max);
+
+        return (len > 0) ? len : (len == 0) ? MHD_CONTENT_READER_END_OF_STREAM : MHD_CONTENT_READER_END_WITH_ERROR;
+    }
+
+    const string& body = *ctx.body;
+
+    if(pos >= body.length())
+        return MHD_CONTENT_READER_END_OF_STREAM;
+
+    const size_t len = std::min(max, (size_t) (body.length() - pos));
+    ::memcpy(buf, body.data() + pos, len);
+
+    return len;
+}
+
+
+// callbackFreeResponse() - static callback fn, called by MHD when it has finished with a response.  Releases the
+// reference to the response held by <cls>, a ptr to a ResponseContext_t.
+//
+void HttpService::callbackFreeResponse(void *cls) noexcept
+{
+    delete (ResponseContext_t *) cls;
 }
+
+
+// callbackReadStream() - static callback fn, called by MHD to obtain the next block of an event stream.  <cls> is a ptr
+// to a StreamContext_t.  Redirects the call to the HttpService::readStream() method.
+//
+ssize_t HttpService::callbackReadStream(void *cls, uint64_t pos, char *buf, size_t max) noexcept
+{
+    (void) pos;
+
+    StreamContext_t * const ctx = (StreamContext_t *) cls;
+
+    return ctx->service->readStream(ctx->stream, buf, max);
+}
+
+
+// callbackFreeStream() - static callback fn, called by MHD when an event stream's connection closes.  <cls> is a ptr
+// to a StreamContext_t.
+//
+void HttpService::callbackFreeStream(void *cls) noexcept
+{
+    delete (StreamContext_t *) cls;
+}
+
@@ -0,0 +1,743 @@
+/*
+    importer.cc: imports JSON documents uploaded to the API (e.g. a library of profiles, or historical temperature
+    data) into the database.  The document is parsed as it arrives, and each record is written as soon as it has been
+    read, in batched transactions, so an import of any size runs in constant memory.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/importer.h"
+#include "include/framework/log.h"
+#include "include/framework/registry.h"
+#include <cstdio>
+#include <strings.h>        // ::strcasecmp()
+
+using std::string;
+using std::string_view;
+
+
+static const int
+    BUSY_TIMEOUT_MS         = 5000;     // Max time to wait for another connection to release the database
+
+static const char * const profileTypes[] =
+{
+    "ferment",
+    "condition",
+    "serve"
+};
+
+static const unsigned int
+    SAMPLE_TIMESTAMP        = 1 << 0,   // Fields of a sample read by TemperatureImporter
+    SAMPLE_SENSOR           = 1 << 1,
+    SAMPLE_TEMPERATURE      = 1 << 2,
+    SAMPLE_ALL_FIELDS       = SAMPLE_TIMESTAMP | SAMPLE_SENSOR | SAMPLE_TEMPERATURE;
+
+
+// Scalar::getInt() - if the value is an integer, store it in <val> and return true; otherwise return false.
+//
+bool Scalar::getInt(long long& val) const noexcept
+{
+    if(type != SCALAR_INTEGER)
+        return false;
+
+    val = integer;
+    return true;
+}
+
+
+// Scalar::getDouble() - if the value is a number, store it in <val> and return true; otherwise return false.
+//
+bool Scalar::getDouble(double& val) const noexcept
+{
+    if(type == SCALAR_INTEGER)
+        val = integer;
+    else if(type == SCALAR_NUMBER)
+        val = number;
+    else
+        return false;
+
+    return true;
+}
+
+
+// ctor - trivial initialisation of members
+//
+Importer::Importer() noexcept
+    : depth_(0),
+      reader_(*this),
+      skipDepth_(-1),
+      inTransaction_(false),
+      batchRows_(0),
+      records_(0),
+      committed_(0)
+{
+}
+
+
+// dtor - roll back any uncommitted records; e.g. if the client disconnected part-way through the upload.
+//
+Importer::~Importer() noexcept
+{
+    rollback();
+}
+
+
+// create() - return a new importer for documents POSTed to the API path <path>, or nullptr if the path does not accept
+// uploads.  The caller takes ownership of the importer.
+//
+Importer *Importer::create(const string_view path) noexcept
+{
+    if(path == "/options")
+        return new OptionImporter();
+    else if(path == "/profiles")
+        return new ProfileImporter();
+    else if(path == "/temperatures")
+        return new TemperatureImporter();
+
+    return nullptr;
+}
+
+
+// begin() - open a connection to the application's database, and prepare the statements which write the records.  The
+// import runs on its own connection, so that its transactions don't interfere with those of other threads.
+//
+bool Importer::begin(Error * const err) noexcept
+{
+    if(!db_.open(Registry::instance().db().path(), SQLITE_OPEN_READWRITE, err)
+       || !db_.exec("PRAGMA busy_timeout=" + std::to_string(BUSY_TIMEOUT_MS), err)
+       || !prepare(db_, err))
+    {
+        fail((err != nullptr) ? err->message() : "Failed to open database");
+        return false;
+    }
+
+    return true;
+}
+
+
+// feed() - parse the next <len> bytes of the document, in <data>, writing any records which are completed.  The records
+// are committed before returning, so that the database is not write-locked while the next chunk of the document is
+// awaited (perhaps from a slow client); a record is written only once it is complete, so this is always a record
+// boundary.  Returns false if the import has failed; in that case, the current transaction is rolled back, and the rest
+// of the document is ignored.
+//
+bool Importer::feed(const char *data, const size_t len) noexcept
+{
+    if(failed())
+        return false;
+
+    if(!reader_.feed(data, len))
+    {
+        fail(reader_.error());
+        rollback();
+        return false;
+    }
+
+    return commit();
+}
+
+
+// finish() - signal the end of the document, and commit any outstanding records.  Returns false if the import failed.
+//
+bool Importer::finish() noexcept
+{
+    if(!failed() && !reader_.finish())
+        fail(reader_.error());
+
+    if(failed())
+    {
+        rollback();
+        return false;
+    }
+
+    return commit();
+}
+
+
+// skip() - called by enter() to skip the container being entered, and its contents; e.g. an unknown member of a record.
+// Returns true.
+//
+bool Importer::skip() noexcept
+{
+    skipDepth_ = depth_;
+    return true;
+}
+
+
+// write() - execute the statement <stmt>, which writes a row of the current record, within the current transaction;
+// start a transaction if there is none.  Returns false if the import has failed.
+//
+bool Importer::write(SQLiteStmt& stmt) noexcept
+{
+    Error err;
+
+    // The write lock is taken at the start of the transaction, rather than at its first write, so that a transaction
+    // can't be left unable to proceed by another connection taking the lock
+    if(!inTransaction_)
+    {
+        if(!db_.exec("BEGIN IMMEDIATE", &err))
+            return fail(err.message());
+
+        inTransaction_ = true;
+    }
+
+    if(!stmt.execute(&err) || !stmt.reset(&err))
+        return fail(err.message());
+
+    ++batchRows_;
+    return true;
+}
+
+
+// recordDone() - called when all of the rows of a record have been written.  Within a chunk of the document, records
+// are committed in batches of approx BATCH_SIZE rows; a record is never split between transactions.  Returns false if
+// the import has failed.
+//
+bool Importer::recordDone() noexcept
+{
+    ++records_;
+
+    return (batchRows_ < BATCH_SIZE) || commit();
+}
+
+
+// commit() - commit the current transaction, if any.  Returns false if the import has failed.
+//
+bool Importer::commit() noexcept
+{
+    if(!inTransaction_)
+        return true;
+
+    Error err;
+
+    if(!db_.exec("COMMIT", &err))
+    {
+        fail(err.message());
+        rollback();
+        return false;
+    }
+
+    inTransaction_ = false;
+    batchRows_ = 0;
+    committed_ = records_;
+
+    return true;
+}
+
+
+// rollback() - roll back the current transaction, if any, discarding the records written since the last commit.
+//
+void Importer::rollback() noexcept
+{
+    if(!inTransaction_)
+        return;
+
+    Error err;
+    if(!db_.exec("ROLLBACK", &err))
+        logWarning("Importer: failed to roll back transaction: %s", err.message().c_str());
+
+    inTransaction_ = false;
+    batchRows_ = 0;
+    records_ = committed_;
+}
+
+
+// fail() - record <error> as the reason for the failure of the import, unless a reason has already been recorded.
+// Returns false.
+//
+bool Importer::fail(const string& error) noexcept
+{
+    if(error_.empty())
+        error_ = error;
+
+    return false;
+}
+
+
+//
+// JsonHandler methods.  Track the depth of the current value within the document, and pass each value to the subclass,
+// unless it is within a container being skipped.
+//
+
+bool Importer::beginObject() noexcept
+{
+    if((skipDepth_ < 0) && !enter(true))
+        return false;
+
+    ++depth_;
+    return true;
+}
+
+
+bool Importer::endObject() noexcept
+{
+    return endContainer(true);
+}
+
+
+bool Importer::beginArray() noexcept
+{
+    if((skipDepth_ < 0) && !enter(false))
+        return false;
+
+    ++depth_;
+    return true;
+}
+
+
+bool Importer::endArray() noexcept
+{
+    return endContainer(false);
+}
+
+
+bool Importer::endContainer(const bool object) noexcept
+{
+    if(--depth_ == skipDepth_)
+    {
+        skipDepth_ = -1;
+        return true;
+    }
+
+    return (skipDepth_ >= 0) || leave(object);
+}
+
+
+bool Importer::key(const string_view key) noexcept
+{
+    key_ = key;
+    return true;
+}
+
+
+bool Importer::value(const Scalar_t& val) noexcept
+{
+    return (skipDepth_ >= 0) || scalar(val);
+}
+
+
+bool Importer::str(const string_view val) noexcept
+{
+    return value({SCALAR_STRING, val, 0, 0.0, false});
+}
+
+
+bool Importer::integer(const long long val) noexcept
+{
+    return value({SCALAR_INTEGER, string_view(), val, 0.0, false});
+}
+
+
+bool Importer::number(const double val) noexcept
+{
+    return value({SCALAR_NUMBER, string_view(), 0, val, false});
+}
+
+
+bool Importer::boolean(const bool val) noexcept
+{
+    return value({SCALAR_BOOLEAN, string_view(), 0, 0.0, val});
+}
+
+
+bool Importer::null() noexcept
+{
+    return value({SCALAR_NULL, string_view(), 0, 0.0, false});
+}
+
+
+//
+// ProfileImporter
+//
+
+// ctor - trivial initialisation of members
+//
+ProfileImporter::ProfileImporter() noexcept
+    : Importer(),
+      id_(0),
+      inStages_(false)
+{
+}
+
+
+// prepare() - prepare the statements which write profiles and their stages to <db>.
+//
+bool ProfileImporter::prepare(SQLite& db, Error * const err) noexcept
+{
+    return db.prepare("INSERT INTO profile(name, type) VALUES(:name, :type)", insertProfile_, err)
+           && db.prepare("INSERT OR REPLACE INTO profile(id, name, type) VALUES(:id, :name, :type)", replaceProfile_,
+                         err)
+           && db.prepare("DELETE FROM profilestage WHERE profile_id=:id", deleteStages_, err)
+           && db.prepare("INSERT INTO profilestage(profile_id, stage, duration_hours, temperature) "
+                         "VALUES(:profileId, :stage, :durationHours, :temperature)", insertStage_, err);
+}
+
+
+// enter() - called at the start of each object or array.  The document is an array of profile objects; the "stages"
+// member of each profile is an array of stage objects.
+//
+bool ProfileImporter::enter(const bool object) noexcept
+{
+    if((depth_ == 0) && !object)
+        return true;
+
+    if((depth_ == 1) && object)
+    {
+        // Start of a profile
+        id_ = 0;
+        name_.clear();
+        type_.clear();
+        stages_.clear();
+        return true;
+    }
+
+    if(depth_ == 2)
+    {
+        if(object || (key_ != "stages"))
+            return skip();      // Unknown members are ignored
+
+        inStages_ = true;
+        return true;
+    }
+
+    if((depth_ == 3) && object && inStages_)
+    {
+        if(stages_.size() >= MAX_STAGES)
+            return fail("Profile has too many stages");
+
+        stages_.push_back({-1, 0.0, false});
+        return true;
+    }
+
+    if(depth_ == 4)
+        return skip();
+
+    return fail((depth_ == 0) ? "Expected an array of profiles" : (object ? "Unexpected object" : "Unexpected array"));
+}
+
+
+// leave() - called at the end of each object or array.  Write each profile as it ends.
+//
+bool ProfileImporter::leave(const bool object) noexcept
+{
+    (void) object;
+
+    switch(depth_)
+    {
+        case 1:
+            return writeProfile() && recordDone();
+
+        case 2:
+            inStages_ = false;
+            return true;
+
+        case 3:
+            return stages_.back().hasTemperature || fail("Stage has no temperature");
+
+        default:
+            return true;
+    }
+}
+
+
+// scalar() - called for each scalar value.  Store the fields of the current profile, and of its current stage.
+//
+bool ProfileImporter::scalar(const Scalar_t& val) noexcept
+{
+    if(depth_ == 2)
+    {
+        if(key_ == "id")
+            return (val.getInt(id_) && (id_ > 0)) || fail("Invalid profile id");
+        else if(key_ == "name")
+        {
+            if(val.type != SCALAR_STRING)
+                return fail("Invalid profile name");
+
+            name_ = val.str;
+        }
+        else if(key_ == "type")
+        {
+            if(val.type != SCALAR_STRING)
+                return fail("Invalid profile type");
+
+            type_ = val.str;
+        }
+
+        return true;        // Unknown members are ignored
+    }
+
+    if(depth_ == 4)
+    {
+        Stage_t& stage = stages_.back();
+
+        if(key_ == "duration_hours")
+        {
+            if(val.type == SCALAR_NULL)
+                stage.durationHours = -1;
+            else if(!val.getInt(stage.durationHours) || (stage.durationHours < 0))
+                return fail("Invalid stage duration");
+        }
+        else if(key_ == "temperature")
+        {
+            if(!val.getDouble(stage.temperature))
+                return fail("Invalid stage temperature");
+
+            stage.hasTemperature = true;
+        }
+
+        return true;
+    }
+
+    return fail((depth_ == 0) ? "Expected an array of profiles" : "Unexpected value");
+}
+
+
+// writeProfile() - validate the current profile and write it, and its stages, to the database.
+//
+bool ProfileImporter::writeProfile() noexcept
+{
+    if(name_.empty())
+        return fail("Profile has no name");
+
+    bool validType = false;
+    for(const auto t : profileTypes)
+        validType |= !::strcasecmp(type_.c_str(), t);
+
+    if(!validType)
+        return fail("Profile '" + name_ + "' has invalid type '" + type_ + "'");
+
+    if(stages_.empty())
+        return fail("Profile '" + name_ + "' has no stages");
+
+    for(size_t i = 0; i + 1 < stages_.size(); ++i)
+        if(stages_[i].durationHours < 0)
+            return fail("Profile '" + name_ + "' has an indefinite stage which is not its last stage");
+
+    Error err;
+
+    if(id_)
+    {
+        // Replace the existing profile, if any
+        if(!replaceProfile_.bind(":id", id_, &err)
+           || !replaceProfile_.bind(":name", name_, &err)
+           || !replaceProfile_.bind(":type", type_, &err)
+           || !write(replaceProfile_)
+           || !deleteStages_.bind(":id", id_, &err)
+           || !write(deleteStages_))
+            return fail(err.message());
+    }
+    else
+    {
+        if(!insertProfile_.bind(":name", name_, &err)
+           || !insertProfile_.bind(":type", type_, &err)
+           || !write(insertProfile_))
+            return fail(err.message());
+
+        id_ = db_.lastInsertId();
+    }
+
+    for(size_t i = 0; i < stages_.size(); ++i)
+    {
+        const Stage_t& stage = stages_[i];
+
+        if(!insertStage_.bind(":profileId", id_, &err)
+           || !insertStage_.bind(":stage", (long long) i + 1, &err)
+           || !((stage.durationHours >= 0) ? insertStage_.bind(":durationHours", stage.durationHours, &err)
+                                           : insertStage_.bindNull(":durationHours", &err))
+           || !insertStage_.bind(":temperature", stage.temperature, &err)
+           || !write(insertStage_))
+            return fail(err.message());
+    }
+
+    return true;
+}
+
+
+//
+// TemperatureImporter
+//
+
+// ctor - trivial initialisation of members
+//
+TemperatureImporter::TemperatureImporter() noexcept
+    : Importer(),
+      timestamp_(0),
+      sensor_(0),
+      temperature_(0.0),
+      fields_(0)
+{
+}
+
+
+// prepare() - prepare the statement which writes samples to <db>.  As in TelemetryLogger::write(), each sample is
+// given the next change sequence number.
+//
+bool TemperatureImporter::prepare(SQLite& db, Error * const err) noexcept
+{
+    return db.prepare("INSERT OR IGNORE INTO temperature(seq, date_create, sensor_id, temperature) "
+                      "SELECT MAX(COALESCE((SELECT MAX(seq) FROM temperature), 0), "
+                      "COALESCE((SELECT MAX(seq) FROM effectorlog), 0)) + 1, "
+                      "DATETIME(:ts, 'unixepoch'), :sensor_id, :temperature", insert_, err);
+}
+
+
+// enter() - called at the start of each object or array.  The document is an array of sample objects.
+//
+bool TemperatureImporter::enter(const bool object) noexcept
+{
+    if((depth_ == 0) && !object)
+        return true;
+
+    if((depth_ == 1) && object)
+    {
+        fields_ = 0;
+        return true;
+    }
+
+    if(depth_ == 2)
+        return skip();          // Unknown members are ignored
+
+    return fail((depth_ == 0) ? "Expected an array of samples" : (object ? "Unexpected object" : "Unexpected array"));
+}
+
+
+// leave() - called at the end of each object or array.  Write each sample as it ends.
+//
+bool TemperatureImporter::leave(const bool object) noexcept
+{
+    (void) object;
+
+    if(depth_ != 1)
+        return true;
+
+    if(fields_ != SAMPLE_ALL_FIELDS)
+        return fail("Sample is missing a field");
+
+    Error err;
+
+    if(!insert_.bind(":ts", timestamp_, &err)
+       || !insert_.bind(":sensor_id", sensor_, &err)
+       || !insert_.bind(":temperature", temperature_, &err))
+        return fail(err.message());
+
+    return write(insert_) && recordDone();
+}
+
+
+// scalar() - called for each scalar value.  Store the fields of the current sample.
+//
+bool TemperatureImporter::scalar(const Scalar_t& val) noexcept
+{
+    if(depth_ != 2)
+        return fail((depth_ == 0) ? "Expected an array of samples" : "Unexpected value");
+
+    if(key_ == "timestamp")
+    {
+        if(!val.getInt(timestamp_))
+            return fail("Invalid timestamp");
+
+        fields_ |= SAMPLE_TIMESTAMP;
+    }
+    else if(key_ == "sensor")
+    {
+        if(!val.getInt(sensor_) || (sensor_ < 0))
+            return fail("Invalid sensor");
+
+        fields_ |= SAMPLE_SENSOR;
+    }
+    else if(key_ == "temperature")
+    {
+        if(!val.getDouble(temperature_))
+            return fail("Invalid temperature");
+
+        fields_ |= SAMPLE_TEMPERATURE;
+    }
+
+    return true;
+}
+
+
+//
+// OptionImporter
+//
+
+// ctor - trivial initialisation of members
+//
+OptionImporter::OptionImporter() noexcept
+    : Importer()
+{
+}
+
+
+// prepare() - prepare the statement which writes options to <db>.
+//
+bool OptionImporter::prepare(SQLite& db, Error * const err) noexcept
+{
+    return db.prepare("INSERT OR REPLACE INTO option(name, value) VALUES(:name, :value)", replace_, err);
+}
+
+
+// enter() - called at the start of each object or array.  The document is a single object.
+//
+bool OptionImporter::enter(const bool object) noexcept
+{
+    return ((depth_ == 0) && object) || fail((depth_ == 0) ? "Expected an object" : "Option values must be scalars");
+}
+
+
+// leave() - called at the end of each object or array.
+//
+bool OptionImporter::leave(const bool object) noexcept
+{
+    (void) object;
+    return true;
+}
+
+
+// scalar() - called for each scalar value.  Write each option as it is read; null values are stored as NULL.
+//
+bool OptionImporter::scalar(const Scalar_t& val) noexcept
+{
+    if(depth_ != 1)
+        return fail("Expected an object");
+
+    Error err;
+    bool ok = replace_.bind(":name", key_, &err);
+
+    if(ok)
+    {
+        switch(val.type)
+        {
+            case SCALAR_STRING:
+                ok = replace_.bind(":value", string(val.str), &err);
+                break;
+
+            case SCALAR_INTEGER:
+                ok = replace_.bind(":value", std::to_string(val.integer), &err);
+                break;
+
+            case SCALAR_NUMBER:
+                {
+                    char buf[32];
+                    ::snprintf(buf, sizeof(buf), "%.15g", val.number);
+                    ok = replace_.bind(":value", string(buf), &err);
+                }
+                break;
+
+            case SCALAR_BOOLEAN:
+                ok = replace_.bind(":value", string(val.boolean ? "true" : "false"), &err);
+                break;
+
+            case SCALAR_NULL:
+                ok = replace_.bindNull(":value", &err);
+                break;
+        }
+    }
+
+    if(!ok)
+        return fail(err.message());
+
+    return write(replace_) && recordDone();
+}
@@ -0,0 +1,464 @@
+/*
+    reader.cc: push (SAX-style) JSON parser.  The document is fed to the parser in arbitrarily-sized chunks, e.g. as the
+    body of an HTTP request arrives, and is reported to a handler as a sequence of events; no document tree is built,
+    so the memory used is independent of the size of the document.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/json/reader.h"
+#include <charconv>
+#include <cstdlib>
+
+using std::string_view;
+
+
+static const unsigned int
+    REPLACEMENT_CHARACTER   = 0xfffd;       // Substituted for unpaired surrogates in \u escape sequences
+
+
+// hexDigit() - return the value of hex digit <c>, or -1 if <c> is not a hex digit.
+//
+static int hexDigit(const char c) noexcept
+{
+    if((c >= '0') && (c <= '9'))
+        return c - '0';
+    else if((c >= 'a') && (c <= 'f'))
+        return (c - 'a') + 10;
+    else if((c >= 'A') && (c <= 'F'))
+        return (c - 'A') + 10;
+
+    return -1;
+}
+
+
+// isDigit() - return true if <c> is a decimal digit.
+//
+static bool isDigit(const char c) noexcept
+{
+    return (c >= '0') && (c <= '9');
+}
+
+
+// validNumber() - return true if <num> is a number in the form permitted by JSON, i.e. an optional minus sign; an
+// integer part with no leading zeros; an optional fraction; and an optional exponent.
+//
+static bool validNumber(const string_view num) noexcept
+{
+    size_t i = 0;
+    const size_t len = num.length();
+
+    if((i < len) && (num[i] == '-'))
+        ++i;
+
+    if((i < len) && (num[i] == '0'))
+        ++i;
+    else if((i < len) && isDigit(num[i]))
+        while((i < len) && isDigit(num[i]))
+            ++i;
+    else
+        return false;
+
+    if((i < len) && (num[i] == '.'))
+    {
+        if((++i >= len) || !isDigit(num[i]))
+            return false;
+
+        while((i < len) && isDigit(num[i]))
+            ++i;
+    }
+
+    if((i < len) && ((num[i] == 'e') || (num[i] == 'E')))
+    {
+        if((++i < len) && ((num[i] == '+') || (num[i] == '-')))
+            ++i;
+
+        if((i >= len) || !isDigit(num[i]))
+            return false;
+
+        while((i < len) && isDigit(num[i]))
+            ++i;
+    }
+
+    return i == len;
+}
+
+
+// ctor - report the document to <handler>.
+//
+JsonReader::JsonReader(JsonHandler& handler) noexcept
+    : handler_(handler),
+      state_(STATE_VALUE),
+      isKey_(false),
+      codePoint_(0),
+      codePointDigits_(0),
+      highSurrogate_(0),
+      depth_(0),
+      offset_(0),
+      error_(nullptr)
+{
+    inObject_[0] = false;
+}
+
+
+// feed() - parse the next <len> bytes of the document, in <data>.  Returns false if the document is invalid, if it
+// has been rejected by the handler, or if parsing failed previously.
+//
+bool JsonReader::feed(const char *data, const size_t len) noexcept
+{
+    if(failed())
+        return false;
+
+    for(size_t i = 0; i < len; ++i, ++offset_)
+        if(!consume(data[i]))
+            return false;
+
+    return true;
+}
+
+
+// finish() - signal the end of the document.  Returns false if the document is incomplete or invalid.
+//
+bool JsonReader::finish() noexcept
+{
+    if(failed())
+        return false;
+
+    // A number or literal at the top level is terminated only by the end of the document
+    if(state_ == STATE_NUMBER)
+        endNumber();
+    else if(state_ == STATE_LITERAL)
+        endLiteral();
+
+    if(!failed() && (state_ != STATE_DONE))
+        fail("Unexpected end of document");
+
+    return !failed();
+}
+
+
+// consume() - parse the char <c>.  Returns false if parsing fails.
+//
+bool JsonReader::consume(const char c) noexcept
+{
+    switch(state_)
+    {
+        case STATE_STRING:
+            if(c == '"')
+                return flushSurrogate() && endString();
+            else if(c == '\\')
+            {
+                state_ = STATE_ESCAPE;
+                return true;
+            }
+            else if((unsigned char) c < 0x20)
+                return fail("Control character in string");
+
+            return flushSurrogate() && append(c);
+
+        case STATE_ESCAPE:
+            state_ = STATE_STRING;
+
+            if(c == 'u')
+            {
+                state_ = STATE_UNICODE;
+                codePoint_ = 0;
+                codePointDigits_ = 0;
+                return true;
+            }
+
+            if(!flushSurrogate())
+                return false;
+
+            switch(c)
+            {
+                case '"':
+                case '\\':
+                case '/':   return append(c);
+                case 'b':   return append('\b');
+                case 'f':   return append('\f');
+                case 'n':   return append('\n');
+                case 'r':   return append('\r');
+                case 't':   return append('\t');
+                default:    return fail("Invalid escape sequence");
+            }
+
+        case STATE_UNICODE:
+            {
+                const int digit = hexDigit(c);
+                if(digit < 0)
+                    return fail("Invalid \\u escape sequence");
+
+                codePoint_ = (codePoint_ << 4) | digit;
+                if(++codePointDigits_ < 4)
+                    return true;
+
+                state_ = STATE_STRING;
+                return appendCodePoint(codePoint_);
+            }
+
+        case STATE_NUMBER:
+            if(isDigit(c) || (c == '-') || (c == '+') || (c == '.') || (c == 'e') || (c == 'E'))
+                return append(c);
+
+            if(!endNumber())
+                return false;
+            break;      // <c> follows the number, so is parsed below
+
+        case STATE_LITERAL:
+            if((c >= 'a') && (c <= 'z'))
+                return append(c);
+
+            if(!endLiteral())
+                return false;
+            break;      // <c> follows the literal, so is parsed below
+
+        default:
+            break;
+    }
+
+    if((c == ' ') || (c == '\t') || (c == '\n') || (c == '\r'))
+        return true;
+
+    switch(state_)
+    {
+        case STATE_ARRAY_START:
+            if(c == ']')
+                return endContainer(false);
+            [[fallthrough]];
+
+        case STATE_VALUE:
+            return beginValue(c);
+
+        case STATE_OBJECT_START:
+            if(c == '}')
+                return endContainer(true);
+            [[fallthrough]];
+
+        case STATE_KEY:
+            if(c != '"')
+                return fail("Expected a key");
+
+            token_.clear();
+            isKey_ = true;
+            state_ = STATE_STRING;
+            return true;
+
+        case STATE_COLON:
+            if(c != ':')
+                return fail("Expected ':'");
+
+            state_ = STATE_VALUE;
+            return true;
+
+        case STATE_NEXT:
+            if(c == ',')
+            {
+                state_ = inObject_[depth_] ? STATE_KEY : STATE_VALUE;
+                return true;
+            }
+            else if(c == (inObject_[depth_] ? '}' : ']'))
+                return endContainer(inObject_[depth_]);
+
+            return fail(inObject_[depth_] ? "Expected ',' or '}'" : "Expected ',' or ']'");
+
+        default:
+            return fail("Unexpected data after end of document");
+    }
+}
+
+
+// beginValue() - begin reading a value, of which <c> is the first char.
+//
+bool JsonReader::beginValue(const char c) noexcept
+{
+    token_.clear();
+
+    if(c == '{')
+        return beginContainer(true);
+    else if(c == '[')
+        return beginContainer(false);
+    else if(c == '"')
+    {
+        isKey_ = false;
+        state_ = STATE_STRING;
+        return true;
+    }
+    else if((c == '-') || isDigit(c))
+        state_ = STATE_NUMBER;
+    else if((c >= 'a') && (c <= 'z'))
+        state_ = STATE_LITERAL;
+    else
+        return fail("Unexpected character");
+
+    return append(c);
+}
+
+
+// beginContainer() - begin an object (if <object> is true) or an array.
+//
+bool JsonReader::beginContainer(const bool object) noexcept
+{
+    if(depth_ >= MAX_DEPTH)
+        return fail("Document nested too deeply");
+
+    inObject_[++depth_] = object;
+    state_ = object ? STATE_OBJECT_START : STATE_ARRAY_START;
+
+    return (object ? handler_.beginObject() : handler_.beginArray()) || fail("Rejected by handler");
+}
+
+
+// endContainer() - end the current container, which is an object if <object> is true; otherwise an array.
+//
+bool JsonReader::endContainer(const bool object) noexcept
+{
+    --depth_;
+
+    return valueDone(object ? handler_.endObject() : handler_.endArray());
+}
+
+
+// endString() - report the key or string value which has been read.
+//
+bool JsonReader::endString() noexcept
+{
+    if(isKey_)
+    {
+        state_ = STATE_COLON;
+        return handler_.key(token_) || fail("Rejected by handler");
+    }
+
+    return valueDone(handler_.str(token_));
+}
+
+
+// endNumber() - report the number which has been read.  Integers are reported as such, unless they are too large to be
+// represented by a long long.
+//
+bool JsonReader::endNumber() noexcept
+{
+    if(!validNumber(token_))
+        return fail("Invalid number");
+
+    if(token_.find_first_of(".eE") == token_.npos)
+    {
+        long long val;
+        const auto result = std::from_chars(token_.data(), token_.data() + token_.length(), val);
+
+        if(result.ec == std::errc())
+            return valueDone(handler_.integer(val));
+    }
+
+    return valueDone(handler_.number(::strtod(token_.c_str(), nullptr)));
+}
+
+
+// endLiteral() - report the literal (true, false or null) which has been read.
+//
+bool JsonReader::endLiteral() noexcept
+{
+    if(token_ == "true")
+        return valueDone(handler_.boolean(true));
+    else if(token_ == "false")
+        return valueDone(handler_.boolean(false));
+    else if(token_ == "null")
+        return valueDone(handler_.null());
+
+    return fail("Invalid literal");
+}
+
+
+// valueDone() - called when a value has been read and reported to the handler; <ok> is the handler's return value.
+// Expect the next member of the enclosing container or, at the top level, the end of the document.
+//
+bool JsonReader::valueDone(const bool ok) noexcept
+{
+    if(!ok)
+        return fail("Rejected by handler");
+
+    state_ = depth_ ? STATE_NEXT : STATE_DONE;
+    return true;
+}
+
+
+// append() - append <c> to the current token.
+//
+bool JsonReader::append(const char c) noexcept
+{
+    if(token_.length() >= MAX_TOKEN_LENGTH)
+        return fail("Token too long");
+
+    token_ += c;
+    return true;
+}
+
+
+// appendCodePoint() - append the code point <cp>, read from a \u escape sequence, to the current token, UTF-8 encoded.
+// Characters outside the Basic Multilingual Plane are escaped as a surrogate pair, i.e. in two sequences; the first is
+// held until the second is read.  Unpaired surrogates are replaced with U+FFFD.
+//
+bool JsonReader::appendCodePoint(unsigned int cp) noexcept
+{
+    if((cp >= 0xdc00) && (cp <= 0xdfff))
+    {
+        // Trailing half of a surrogate pair
+        if(!highSurrogate_)
+            return appendCodePoint(REPLACEMENT_CHARACTER);
+
+        cp = 0x10000 + ((highSurrogate_ - 0xd800) << 10) + (cp - 0xdc00);
+        highSurrogate_ = 0;
+    }
+    else
+    {
+        if(!flushSurrogate())
+            return false;
+
+        if((cp >= 0xd800) && (cp <= 0xdbff))
+        {
+            // Leading half of a surrogate pair
+            highSurrogate_ = cp;
+            return true;
+        }
+    }
+
+    if(cp < 0x80)
+        return append(cp);
+    else if(cp < 0x800)
+        return append(0xc0 | (cp >> 6))
+               && append(0x80 | (cp & 0x3f));
+    else if(cp < 0x10000)
+        return append(0xe0 | (cp >> 12))
+               && append(0x80 | ((cp >> 6) & 0x3f))
+               && append(0x80 | (cp & 0x3f));
+
+    return append(0xf0 | (cp >> 18))
+           && append(0x80 | ((cp >> 12) & 0x3f))
+           && append(0x80 | ((cp >> 6) & 0x3f))
+           && append(0x80 | (cp & 0x3f));
+}
+
+
+// flushSurrogate() - if the leading half of a surrogate pair is being held, it is unpaired; replace it with U+FFFD.
+//
+bool JsonReader::flushSurrogate() noexcept
+{
+    if(!highSurrogate_)
+        return true;
+
+    highSurrogate_ = 0;
+    return appendCodePoint(REPLACEMENT_CHARACTER);
+}
+
+
+// fail() - stop parsing, recording <error> as the reason.  Returns false.
+//
+bool JsonReader::fail(const char * const error) noexcept
+{
+    if(error_ == nullptr)
+        error_ = error;
+
+    return false;
+}
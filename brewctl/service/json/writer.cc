@@ -0,0 +1,257 @@
+/*
+    writer.cc: streaming JSON writer.  Formats JSON directly into a caller-owned output buffer, without building a
+    document tree; the buffer can be reused between documents, or drained between calls when a document is produced
+    incrementally (e.g. by a chunked-response callback).
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/json/writer.h"
+#include <cmath>
+#include <cstdio>
+
+using std::string;
+
+
+static const char hexDigits[] = "0123456789abcdef";
+
+
+// ctor - write to <out>, appending to any existing contents.
+//
+JsonWriter::JsonWriter(string& out) noexcept
+    : Serializer(out),
+      depth_(0),
+      afterKey_(false)
+{
+    hasMembers_[0] = false;
+}
+
+
+// separate() - write the comma, if any, which must precede the next value or key in the current container.
+//
+void JsonWriter::separate() noexcept
+{
+    if(afterKey_)
+    {
+        afterKey_ = false;
+        return;
+    }
+
+    if(hasMembers_[depth_])
+        out_ += ',';
+
+    hasMembers_[depth_] = true;
+}
+
+
+// open() - begin a container (an object if <c> is '{'; an array if <c> is '[').  Containers nested beyond MAX_DEPTH
+// are a programming error; they are written, but their members are not correctly separated.
+//
+void JsonWriter::open(const char c) noexcept
+{
+    separate();
+    out_ += c;
+
+    if(depth_ < MAX_DEPTH)
+        hasMembers_[++depth_] = false;
+}
+
+
+// close() - end the current container with the character <c>.
+//
+void JsonWriter::close(const char c) noexcept
+{
+    out_ += c;
+
+    if(depth_ > 0)
+        --depth_;
+}
+
+
+Serializer& JsonWriter::beginObject() noexcept
+{
+    open('{');
+    return *this;
+}
+
+
+Serializer& JsonWriter::endObject() noexcept
+{
+    close('}');
+    return *this;
+}
+
+
+Serializer& JsonWriter::beginArray() noexcept
+{
+    open('[');
+    return *this;
+}
+
+
+Serializer& JsonWriter::endArray() noexcept
+{
+    close(']');
+    return *this;
+}
+
+
+// key() - write an object key.  The next call must write the corresponding value.
+//
+Serializer& JsonWriter::key(const SerialKey& key) noexcept
+{
+    separate();
+
+    out_ += '"';
+    out_.append(key.str(), key.length());
+    out_ += "\":";
+
+    afterKey_ = true;
+    return *this;
+}
+
+
+Serializer& JsonWriter::value(const bool val) noexcept
+{
+    separate();
+    out_ += val ? "true" : "false";
+
+    return *this;
+}
+
+
+// value() - write an integer.  Digits are generated into a fixed-size buffer, least-significant first.
+//
+Serializer& JsonWriter::value(const long long val) noexcept
+{
+    if(val >= 0)
+        return value((unsigned long long) val);
+
+    separate();
+    out_ += '-';
+
+    // Negate in unsigned arithmetic, so that the most negative value does not overflow
+    const unsigned long long mag = 0ULL - (unsigned long long) val;
+    char buf[24];
+    char *p = buf + sizeof(buf);
+
+    for(unsigned long long v = mag; ; v /= 10)
+    {
+        *--p = '0' + (v % 10);
+        if(v < 10)
+            break;
+    }
+
+    out_.append(p, buf + sizeof(buf) - p);
+    return *this;
+}
+
+
+Serializer& JsonWriter::value(const unsigned long long val) noexcept
+{
+    separate();
+
+    char buf[24];
+    char *p = buf + sizeof(buf);
+
+    for(unsigned long long v = val; ; v /= 10)
+    {
+        *--p = '0' + (v % 10);
+        if(v < 10)
+            break;
+    }
+
+    out_.append(p, buf + sizeof(buf) - p);
+    return *this;
+}
+
+
+// value() - write a floating-point number, or null if <val> is not finite (JSON has no representation for NaN or
+// infinity).
+//
+Serializer& JsonWriter::value(const double val) noexcept
+{
+    if(!std::isfinite(val))
+        return null();
+
+    separate();
+
+    char buf[32];
+    const int len = ::snprintf(buf, sizeof(buf), "%.15g", val);
+
+    if((len > 0) && ((size_t) len < sizeof(buf)))
+        out_.append(buf, len);
+    else
+        out_ += '0';
+
+    return *this;
+}
+
+
+Serializer& JsonWriter::value(const char *str, const size_t len) noexcept
+{
+    separate();
+    writeString(str, len);
+
+    return *this;
+}
+
+
+Serializer& JsonWriter::null() noexcept
+{
+    separate();
+    out_ += "null";
+
+    return *this;
+}
+
+
+Serializer& JsonWriter::encodedValue(const char *data, const size_t len) noexcept
+{
+    separate();
+    out_.append(data, len);
+
+    return *this;
+}
+
+
+// writeString() - write <len> chars from <str> as a quoted, escaped JSON string.  Runs of characters which need no
+// escaping are appended in one operation.
+//
+void JsonWriter::writeString(const char *str, const size_t len) noexcept
+{
+    out_ += '"';
+
+    size_t start = 0;
+    for(size_t i = 0; i < len; ++i)
+    {
+        const unsigned char c = str[i];
+        if((c >= 0x20) && (c != '"') && (c != '\\'))
+            continue;
+
+        out_.append(str + start, i - start);
+        start = i + 1;
+
+        switch(c)
+        {
+            case '"':   out_ += "\\\"";     break;
+            case '\\':  out_ += "\\\\";     break;
+            case '\b':  out_ += "\\b";      break;
+            case '\f':  out_ += "\\f";      break;
+            case '\n':  out_ += "\\n";      break;
+            case '\r':  out_ += "\\r";      break;
+            case '\t':  out_ += "\\t";      break;
+
+            default:
+                out_ += "\\u00";
+                out_ += hexDigits[c >> 4];
+                out_ += hexDigits[c & 0xf];
+                break;
+        }
+    }
+
+    out_.append(str + start, len - start);
+    out_ += '"';
+}
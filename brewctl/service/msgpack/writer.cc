@@ -0,0 +1,311 @@
+/*
+    writer.cc: streaming MessagePack writer.  MessagePack maps and arrays are prefixed with their member counts, which
+    are not known until the container is closed, so each container's header is reserved when it is opened and filled in
+    when it is closed.  The output buffer must therefore not be drained part-way through a document.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/msgpack/writer.h"
+#include <cstring>
+
+using std::string;
+
+
+static const uint8_t
+    NIL         = 0xc0,
+    BOOL_FALSE  = 0xc2,
+    BOOL_TRUE   = 0xc3,
+    FLOAT32     = 0xca,
+    FLOAT64     = 0xcb,
+    UINT8       = 0xcc,
+    UINT16      = 0xcd,
+    UINT32      = 0xce,
+    UINT64      = 0xcf,
+    INT8        = 0xd0,
+    INT16       = 0xd1,
+    INT32       = 0xd2,
+    INT64       = 0xd3,
+    STR8        = 0xd9,
+    STR16       = 0xda,
+    STR32       = 0xdb,
+    ARRAY32     = 0xdd,
+    MAP32       = 0xdf,
+    FIXSTR      = 0xa0,
+    FIXARRAY    = 0x90,
+    FIXMAP      = 0x80;
+
+static const uint32_t
+    MAX_FIX_CONTAINER   = 15,           // Max number of members of a fixarray, or of pairs in a fixmap
+    MAX_FIXSTR          = 31;           // Max length of a fixstr
+
+
+// ctor - write to <out>, appending to any existing contents.
+//
+MsgPackWriter::MsgPackWriter(string& out) noexcept
+    : Serializer(out),
+      depth_(0),
+      afterKey_(false)
+{
+    containers_[0] = {0, 0};
+}
+
+
+// member() - account for a new member of the current container: a key (in a map) or a value (in an array).  A value
+// which follows a key completes a pair that has already been counted.
+//
+void MsgPackWriter::member() noexcept
+{
+    if(afterKey_)
+        afterKey_ = false;
+    else
+        ++containers_[depth_].count;
+}
+
+
+// open() - begin a container of type <type> (ARRAY32 or MAP32), reserving space for a 32-bit member count.
+// Containers nested beyond MAX_DEPTH are a programming error; their members are not counted correctly.
+//
+void MsgPackWriter::open(const uint8_t type) noexcept
+{
+    member();
+
+    if(depth_ < MAX_DEPTH)
+        containers_[++depth_] = {out_.length(), 0};
+
+    out_ += (char) type;
+    out_.append(4, '\0');
+}
+
+
+// close() - end the current container, filling in its member count.  A container with few enough members to be
+// written as a fixarray/fixmap (of type <fixType>) is converted to one, shifting its members down over the unused
+// bytes of its header.
+//
+void MsgPackWriter::close(const uint8_t fixType) noexcept
+{
+    const Container_t& c = containers_[depth_];
+
+    if(c.count <= MAX_FIX_CONTAINER)
+    {
+        out_[c.offset] = (char) (fixType | c.count);
+        out_.erase(c.offset + 1, 4);
+    }
+    else
+    {
+        for(int i = 0; i < 4; ++i)
+            out_[c.offset + 1 + i] = (char) (c.count >> ((3 - i) * 8));
+    }
+
+    if(depth_ > 0)
+        --depth_;
+}
+
+
+Serializer& MsgPackWriter::beginObject() noexcept
+{
+    open(MAP32);
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::endObject() noexcept
+{
+    close(FIXMAP);
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::beginArray() noexcept
+{
+    open(ARRAY32);
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::endArray() noexcept
+{
+    close(FIXARRAY);
+    return *this;
+}
+
+
+// key() - write an object key.  The next call must write the corresponding value.
+//
+Serializer& MsgPackWriter::key(const SerialKey& key) noexcept
+{
+    member();
+    writeString(key.str(), key.length());
+
+    afterKey_ = true;
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::value(const bool val) noexcept
+{
+    member();
+    out_ += (char) (val ? BOOL_TRUE : BOOL_FALSE);
+
+    return *this;
+}
+
+
+// value() - write a signed integer, in the shortest encoding which represents it.
+//
+Serializer& MsgPackWriter::value(const long long val) noexcept
+{
+    if(val >= 0)
+        return value((unsigned long long) val);
+
+    member();
+
+    if(val >= -32)
+        out_ += (char) val;                 // Negative fixint
+    else if(val >= INT8_MIN)
+    {
+        out_ += (char) INT8;
+        writeBE(val, 1);
+    }
+    else if(val >= INT16_MIN)
+    {
+        out_ += (char) INT16;
+        writeBE(val, 2);
+    }
+    else if(val >= INT32_MIN)
+    {
+        out_ += (char) INT32;
+        writeBE(val, 4);
+    }
+    else
+    {
+        out_ += (char) INT64;
+        writeBE(val, 8);
+    }
+
+    return *this;
+}
+
+
+// value() - write an unsigned integer, in the shortest encoding which represents it.
+//
+Serializer& MsgPackWriter::value(const unsigned long long val) noexcept
+{
+    member();
+
+    if(val <= 0x7f)
+        out_ += (char) val;                 // Positive fixint
+    else if(val <= 0xff)
+    {
+        out_ += (char) UINT8;
+        writeBE(val, 1);
+    }
+    else if(val <= 0xffff)
+    {
+        out_ += (char) UINT16;
+        writeBE(val, 2);
+    }
+    else if(val <= 0xffffffff)
+    {
+        out_ += (char) UINT32;
+        writeBE(val, 4);
+    }
+    else
+    {
+        out_ += (char) UINT64;
+        writeBE(val, 8);
+    }
+
+    return *this;
+}
+
+
+// value() - write a floating-point number, as a single-precision float if that represents it exactly.
+//
+Serializer& MsgPackWriter::value(const double val) noexcept
+{
+    member();
+
+    const float f = val;
+
+    if(((double) f == val) || (val != val))
+    {
+        uint32_t bits;
+        ::memcpy(&bits, &f, sizeof(bits));
+
+        out_ += (char) FLOAT32;
+        writeBE(bits, 4);
+    }
+    else
+    {
+        uint64_t bits;
+        ::memcpy(&bits, &val, sizeof(bits));
+
+        out_ += (char) FLOAT64;
+        writeBE(bits, 8);
+    }
+
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::value(const char *str, const size_t len) noexcept
+{
+    member();
+    writeString(str, len);
+
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::null() noexcept
+{
+    member();
+    out_ += (char) NIL;
+
+    return *this;
+}
+
+
+Serializer& MsgPackWriter::encodedValue(const char *data, const size_t len) noexcept
+{
+    member();
+    out_.append(data, len);
+
+    return *this;
+}
+
+
+// writeBE() - write the least-significant <nbytes> bytes of <val>, most-significant first.
+//
+void MsgPackWriter::writeBE(const uint64_t val, int nbytes) noexcept
+{
+    while(nbytes--)
+        out_ += (char) (val >> (nbytes * 8));
+}
+
+
+void MsgPackWriter::writeString(const char *str, const size_t len) noexcept
+{
+    if(len <= MAX_FIXSTR)
+        out_ += (char) (FIXSTR | len);
+    else if(len <= 0xff)
+    {
+        out_ += (char) STR8;
+        writeBE(len, 1);
+    }
+    else if(len <= 0xffff)
+    {
+        out_ += (char) STR16;
+        writeBE(len, 2);
+    }
+    else
+    {
+        out_ += (char) STR32;
+        writeBE(len, 4);
+    }
+
+    out_.append(str, len);
+}
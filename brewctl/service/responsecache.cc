@@ -0,0 +1,116 @@
+/*
+    responsecache.cc: cache of serialised API responses, keyed by route and representation (e.g. serialisation format),
+    and by the version of the data from which each response was built.  Responses are immutable and reference-counted,
+    so they can be served concurrently, and outlive their eviction from the cache, without being copied.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/responsecache.h"
+#include <chrono>
+#include <cstdio>
+
+using std::lock_guard;
+using std::mutex;
+using std::promise;
+using std::shared_future;
+using std::string;
+
+
+// ctor - generate an instance ID, which forms part of each entity tag.  Data versions restart from 1 when the
+// application restarts, so without it a client could revalidate a stale response against a new one.
+//
+ResponseCache::ResponseCache() noexcept
+    : instanceId_(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count())
+{
+}
+
+
+// get() - return the response cached under <key> and <variant>, provided that it was built from data version <version>.
+// Otherwise, call <build> to build the response, cache it and return it.  If several threads request the same uncached
+// response concurrently, only the first builds it; the others wait for, and share, its result.  A response whose status
+// is not 200 (e.g. following a transient database error) is returned to those threads, but is not kept in the cache,
+// so the next request builds it again.
+//
+HttpResponse_sptr_t ResponseCache::get(const string& key, const int variant, const uint64_t version,
+                                       const Builder_t& build) noexcept
+{
+    promise<HttpResponse_sptr_t> result;
+    shared_future<HttpResponse_sptr_t> response;
+    bool builder = false;
+
+    {
+        lock_guard<mutex> lock(lock_);
+
+        const auto k = std::make_pair(key, variant);
+        auto it = entries_.find(k);
+        if((it != entries_.end()) && (it->second.version == version))
+            response = it->second.response;
+        else
+        {
+            response = result.get_future().share();
+            entries_[k] = {version, response};
+            builder = true;
+        }
+    }
+
+    // The lock is not held while building, so other routes - and other versions of this route - are not held up
+    if(builder)
+    {
+        HttpResponse_t * const r = new HttpResponse_t();
+
+        r->status = 200;
+        build(*r);
+
+        if(r->status == 200)
+            r->etag = etag(variant, version);
+
+        result.set_value(HttpResponse_sptr_t(r));
+
+        if(r->status != 200)
+        {
+            lock_guard<mutex> lock(lock_);
+
+            const auto it = entries_.find(std::make_pair(key, variant));
+            if((it != entries_.end()) && (it->second.version == version))
+                entries_.erase(it);
+        }
+    }
+
+    return response.get();
+}
+
+
+// HttpResponse::encodedBody() - return the response body compressed with <encoding>.  Each encoding is compressed once
+// only, when first requested, and kept with the response; a cached response is therefore compressed once however many
+// times it is served.  Returns an empty string if compression fails.
+//
+const string& HttpResponse::encodedBody(const ContentEncoding_t encoding) const noexcept
+{
+    if((encoding <= ENCODING_IDENTITY) || (encoding >= NUM_ENCODINGS))
+        return body;
+
+    std::call_once(encodeOnce[encoding], [this, encoding]
+    {
+        if(!Compressor::compress(encoding, body, encodedBodies[encoding]))
+            encodedBodies[encoding].clear();
+    });
+
+    return encodedBodies[encoding];
+}
+
+
+// etag() - return the entity tag for the representation <variant> of a response built from data version <version>.
+//
+string ResponseCache::etag(const int variant, const uint64_t version) const noexcept
+{
+    char buf[64];
+
+    ::snprintf(buf, sizeof(buf), "\"%llx-%llx-%x\"", (unsigned long long) instanceId_, (unsigned long long) version,
+               variant);
+
+    return buf;
+}
@@ -0,0 +1,63 @@
+/*
+    router.cc: compile-time HTTP route table.  Route patterns, e.g. "/session/{id:int}/history", are compiled by a
+    constexpr ctor into a trie over path segments, so that matching a request path is a single walk along the path,
+    with no allocation, however many routes there are.  Patterns consist of literal segments and typed parameter
+    segments ("{name:int}" or "{name:str}"); when both match a segment, literal segments take precedence.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/router.h"
+#include "include/framework/log.h"
+#include <cstdlib>
+
+using std::string_view;
+
+
+// invalidRoute() - called by the Trie ctor if a route table is malformed.  Not constexpr, so this is a compile-time
+// error for a constexpr route table; at run time it is a programming error.
+//
+void invalidRoute() noexcept
+{
+    logError("Router: invalid route table");
+    ::abort();
+}
+
+
+namespace Router
+{
+
+// find() - return the index of the parameter named <name>, or -1 if there is no such parameter.
+//
+int Params::find(const string_view name) const noexcept
+{
+    for(size_t i = 0; i < count_; ++i)
+        if(names_[i] == name)
+            return i;
+
+    return -1;
+}
+
+
+// str() - return the value of the parameter named <name>, or an empty string if there is no such parameter.
+//
+string_view Params::str(const string_view name) const noexcept
+{
+    const int i = find(name);
+
+    return (i != -1) ? values_[i] : string_view();
+}
+
+
+// getInt() - return the value of the int-typed parameter named <name>, or 0 if there is no such parameter.
+//
+long long Params::getInt(const string_view name) const noexcept
+{
+    const int i = find(name);
+
+    return (i != -1) ? ints_[i] : 0;
+}
+
+} // namespace Router
@@ -0,0 +1,93 @@
+/*
+    serializer.cc: interface to the streaming writers which format API responses.  Handlers describe a response as a
+    sequence of objects, arrays, keys and values; the writer chosen by content negotiation formats it as JSON, CBOR or
+    MessagePack, directly into a caller-owned output buffer.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/serializer.h"
+#include "include/framework/log.h"
+#include "include/service/cbor/writer.h"
+#include "include/service/json/writer.h"
+#include "include/service/msgpack/writer.h"
+#include <cstdlib>
+
+using std::string;
+
+
+static const struct
+{
+    const char *        type;
+    SerialFormat_t      format;
+} contentTypes[] =
+{
+    {"text/json",               SERIAL_JSON},       // The first type listed for each format is the one sent
+    {"application/json",        SERIAL_JSON},
+    {"application/cbor",        SERIAL_CBOR},
+    {"application/msgpack",     SERIAL_MSGPACK},
+    {"application/x-msgpack",   SERIAL_MSGPACK}
+};
+
+
+// invalidSerialKey() - called by the SerialKey ctor if a key contains a character which would need escaping.  Not
+// constexpr, so this is a compile-time error for constant keys; at run time it is a programming error.
+//
+void invalidSerialKey() noexcept
+{
+    logError("SerialKey: key contains a character which requires escaping");
+    ::abort();
+}
+
+
+// create() - factory for Serializer objects: return a writer which formats documents in <format>, appending to <out>.
+//
+Serializer_uptr_t Serializer::create(const SerialFormat_t format, string& out) noexcept
+{
+    switch(format)
+    {
+        case SERIAL_CBOR:       return Serializer_uptr_t(new CborWriter(out));
+        case SERIAL_MSGPACK:    return Serializer_uptr_t(new MsgPackWriter(out));
+        default:                return Serializer_uptr_t(new JsonWriter(out));
+    }
+}
+
+
+// contentType() - return the MIME type of documents in <format>.
+//
+const char *Serializer::contentType(const SerialFormat_t format) noexcept
+{
+    for(const auto& t : contentTypes)
+        if(t.format == format)
+            return t.type;
+
+    return contentTypes[0].type;
+}
+
+
+// formatFromContentType() - return the format identified by the MIME type <type>, or SERIAL_NUM_FORMATS if <type> is
+// not the type of any supported format.
+//
+SerialFormat_t Serializer::formatFromContentType(const string& type) noexcept
+{
+    for(const auto& t : contentTypes)
+        if(type == t.type)
+            return t.format;
+
+    return SERIAL_NUM_FORMATS;
+}
+
+
+Serializer& Serializer::value(const char *val) noexcept
+{
+    if(val == nullptr)
+        return null();
+
+    size_t len = 0;
+    while(val[len])
+        ++len;
+
+    return value(val, len);
+}
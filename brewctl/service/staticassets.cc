@@ -0,0 +1,202 @@
+/*
+    staticassets.cc: manifest of the static files (e.g. the web dashboard) served by the HTTP service.  The manifest is
+    built once, at startup, by scanning a directory tree; each file's entity tag is computed then, so that serving a
+    file requires no more than an open() and a sendfile().
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/staticassets.h"
+#include "include/framework/log.h"
+#include <cstdio>
+
+extern "C"
+{
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>           // ::crc32()
+}
+
+using std::string;
+using std::string_view;
+
+
+static const char * const GZIP_SUFFIX = ".gz";
+static const char * const INDEX_FILE = "index.html";
+static const char * const DEFAULT_CONTENT_TYPE = "application/octet-stream";
+
+static const struct
+{
+    const char *    extension;
+    const char *    contentType;
+} contentTypes[] =
+{
+    {".css",            "text/css; charset=utf-8"},
+    {".html",           "text/html; charset=utf-8"},
+    {".ico",            "image/x-icon"},
+    {".jpg",            "image/jpeg"},
+    {".js",             "application/javascript; charset=utf-8"},
+    {".json",           "application/json"},
+    {".map",            "application/json"},
+    {".png",            "image/png"},
+    {".svg",            "image/svg+xml"},
+    {".txt",            "text/plain; charset=utf-8"},
+    {".webmanifest",    "application/manifest+json"},
+    {".woff",           "font/woff"},
+    {".woff2",          "font/woff2"}
+};
+
+
+static bool endsWith(const string_view str, const string_view suffix) noexcept
+{
+    return (str.length() >= suffix.length()) && !str.compare(str.length() - suffix.length(), suffix.length(), suffix);
+}
+
+
+StaticAssets::StaticAssets() noexcept
+{
+}
+
+
+// load() - build the manifest from the files in the directory tree rooted at <root>, which are served under the URL
+// path <prefix>; e.g. <root>/js/app.js is served as <prefix>/js/app.js.  A directory's index.html is also served as
+// the directory itself, with or without a trailing slash.  A file <name>.gz is taken to be a gzip-compressed copy of
+// <name>, and is served in its place to clients which accept gzip; it is not served in its own right.
+//
+bool StaticAssets::load(const string& root, const string& prefix, Error * const err) noexcept
+{
+    assets_.clear();
+
+    if(!scan(root, prefix, err))
+        return false;
+
+    logInfo("Static assets: %zu file(s) under %s served at %s", assets_.size(), root.c_str(), prefix.c_str());
+    return true;
+}
+
+
+// find() - return the asset served at URL path <path>, or nullptr if there is no such asset.
+//
+const StaticAssets::Asset_t *StaticAssets::find(const string_view path) const noexcept
+{
+    const auto it = assets_.find(path);
+
+    return (it != assets_.end()) ? &it->second : nullptr;
+}
+
+
+// contentType() - return the MIME type of the file <fileName>, based on its extension.
+//
+const char *StaticAssets::contentType(const string_view fileName) noexcept
+{
+    for(const auto& t : contentTypes)
+        if(endsWith(fileName, t.extension))
+            return t.contentType;
+
+    return DEFAULT_CONTENT_TYPE;
+}
+
+
+// scan() - add the files in directory <dir>, and its subdirectories, to the manifest, under URL path <urlPath>.
+// Hidden files and directories are skipped, as are symbolic links, which might lead out of the asset tree.
+//
+bool StaticAssets::scan(const string& dir, const string& urlPath, Error * const err) noexcept
+{
+    DIR * const d = ::opendir(dir.c_str());
+    if(d == nullptr)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "opendir()");
+        return false;
+    }
+
+    for(struct dirent *ent; (ent = ::readdir(d)) != nullptr; )
+    {
+        const string name(ent->d_name);
+        if(name[0] == '.')
+            continue;
+
+        const string path = dir + "/" + name;
+        struct stat st;
+
+        if(::lstat(path.c_str(), &st))
+            continue;
+
+        if(S_ISDIR(st.st_mode))
+        {
+            Error subdirErr;
+
+            if(!scan(path, urlPath + "/" + name, &subdirErr))
+                logWarning("Static assets: skipping %s: %s", path.c_str(), subdirErr.message().c_str());
+
+            continue;
+        }
+
+        // A compressed sibling is served in place of its source file, so is picked up with the source file
+        if(!S_ISREG(st.st_mode) || endsWith(name, GZIP_SUFFIX))
+            continue;
+
+        Asset_t asset;
+
+        if(!describe(path, asset.file))
+        {
+            logWarning("Static assets: failed to read %s", path.c_str());
+            continue;
+        }
+
+        asset.hasGzip = describe(path + GZIP_SUFFIX, asset.gzipFile);
+        asset.contentType = contentType(name);
+
+        if(name == INDEX_FILE)
+        {
+            assets_[urlPath] = asset;
+            assets_[urlPath + "/"] = asset;
+        }
+
+        assets_[urlPath + "/" + name] = asset;
+    }
+
+    ::closedir(d);
+    return true;
+}
+
+
+// describe() - populate <file> with the size, modification time and entity tag of the regular file at <path>.  The tag
+// combines the file's size with the CRC-32 of its contents.  Returns false if the file can't be read, or if <path> is a
+// symbolic link.
+//
+bool StaticAssets::describe(const string& path, File_t& file) noexcept
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if(fd == -1)
+        return false;
+
+    struct stat st;
+    uLong crc = ::crc32(0L, Z_NULL, 0);
+    unsigned char buffer[65536];
+    ssize_t len = 0;
+
+    if(!::fstat(fd, &st) && S_ISREG(st.st_mode))
+        while((len = ::read(fd, buffer, sizeof(buffer))) > 0)
+            crc = ::crc32(crc, buffer, len);
+    else
+        len = -1;
+
+    ::close(fd);
+
+    if(len < 0)
+        return false;
+
+    char etag[48];
+    ::snprintf(etag, sizeof(etag), "\"%llx-%08lx\"", (unsigned long long) st.st_size, (unsigned long) crc);
+
+    file.path = path;
+    file.etag = etag;
+    file.size = st.st_size;
+    file.mtime = st.st_mtime;
+
+    return true;
+}
@@ -0,0 +1,214 @@
+/*
+    timeseriesencoder.cc: encodes time series in the application/x-brewctl-ts format (see timeseries.h).  Points are
+    accumulated into per-column bit-streams, and appended to a caller-owned output buffer a block at a time.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/timeseriesencoder.h"
+#include <algorithm>
+#include <cstring>
+
+using std::string;
+
+
+// ctor - encode points with <columns> values each (at most TimeSeries::MAX_COLUMNS), appending to <out>.
+//
+TimeSeriesEncoder::TimeSeriesEncoder(string& out, const size_t columns) noexcept
+    : out_(out),
+      columns_(std::min(columns, TimeSeries::MAX_COLUMNS)),
+      count_(0),
+      prevT_(0),
+      prevDelta_(0),
+      col_{}
+{
+}
+
+
+// header() - write the stream header.  Must be called once, before any points are added.
+//
+void TimeSeriesEncoder::header() noexcept
+{
+    out_.append((const char *) TimeSeries::MAGIC, sizeof(TimeSeries::MAGIC));
+    out_ += (char) TimeSeries::VERSION;
+    out_ += (char) columns_;
+    out_.append(3, '\0');
+}
+
+
+// add() - add a point, with timestamp <t> and columns() values from <values>.  The block is written to the output
+// buffer when it is full.
+//
+void TimeSeriesEncoder::add(const int64_t t, const double *values) noexcept
+{
+    writeTimestamp(t);
+
+    for(size_t i = 0; i < columns_; ++i)
+        writeValue(col_[i], values[i]);
+
+    if(++count_ >= BLOCK_POINTS)
+        flush();
+}
+
+
+// flush() - write the current block, if it contains any points, to the output buffer, and start a new block.
+//
+void TimeSeriesEncoder::flush() noexcept
+{
+    if(!count_)
+        return;
+
+    appendU32(out_, count_);
+    ts_.appendTo(out_);
+
+    for(size_t i = 0; i < columns_; ++i)
+    {
+        col_[i].bits.appendTo(out_);
+        col_[i].leading = col_[i].meaningful = 0;
+    }
+
+    count_ = 0;
+}
+
+
+// writeTimestamp() - write <t> to the timestamp column: in full if it is the first in the block; otherwise delta-of-
+// delta encoded.
+//
+void TimeSeriesEncoder::writeTimestamp(const int64_t t) noexcept
+{
+    if(!count_)
+    {
+        ts_.write(t, 64);
+        prevT_ = t;
+        prevDelta_ = 0;
+        return;
+    }
+
+    const int64_t delta = t - prevT_, dod = delta - prevDelta_;
+
+    if(!dod)
+        ts_.write(0, 1);
+    else if((dod >= -63) && (dod <= 64))
+    {
+        ts_.write(0x2, 2);
+        ts_.write(dod + 63, 7);
+    }
+    else if((dod >= -255) && (dod <= 256))
+    {
+        ts_.write(0x6, 3);
+        ts_.write(dod + 255, 9);
+    }
+    else if((dod >= -2047) && (dod <= 2048))
+    {
+        ts_.write(0xe, 4);
+        ts_.write(dod + 2047, 12);
+    }
+    else
+    {
+        ts_.write(0xf, 4);
+        ts_.write(dod, 64);
+    }
+
+    prevT_ = t;
+    prevDelta_ = delta;
+}
+
+
+// writeValue() - write <value> to column <c>: in full if it is the first in the block; otherwise XORed with its
+// predecessor, storing only the meaningful bits of the result.
+//
+void TimeSeriesEncoder::writeValue(Column_t& c, const double value) noexcept
+{
+    uint64_t bits;
+    ::memcpy(&bits, &value, sizeof(bits));
+
+    if(!count_)
+    {
+        c.bits.write(bits, 64);
+        c.prev = bits;
+        return;
+    }
+
+    const uint64_t x = bits ^ c.prev;
+    c.prev = bits;
+
+    if(!x)
+    {
+        c.bits.write(0, 1);
+        return;
+    }
+
+    const unsigned int leading = std::min(__builtin_clzll(x), 31),
+                       trailing = __builtin_ctzll(x);
+
+    if(c.meaningful && (leading >= c.leading) && (trailing >= (64 - c.leading - c.meaningful)))
+    {
+        // The meaningful bits fit within the previous window
+        c.bits.write(0x2, 2);
+        c.bits.write(x >> (64 - c.leading - c.meaningful), c.meaningful);
+    }
+    else
+    {
+        const unsigned int meaningful = 64 - leading - trailing;
+
+        c.bits.write(0x3, 2);
+        c.bits.write(leading, 5);
+        c.bits.write(meaningful & 0x3f, 6);
+        c.bits.write(x >> trailing, meaningful);
+
+        c.leading = leading;
+        c.meaningful = meaningful;
+    }
+}
+
+
+// appendU32() - append <val> to <out> as a little-endian u32.
+//
+void TimeSeriesEncoder::appendU32(string& out, const uint32_t val) noexcept
+{
+    const char bytes[4] = {(char) val, (char) (val >> 8), (char) (val >> 16), (char) (val >> 24)};
+
+    out.append(bytes, sizeof(bytes));
+}
+
+
+// write() - append the least-significant <nbits> bits of <val>, most-significant first.
+//
+void TimeSeriesEncoder::BitWriter::write(const uint64_t val, unsigned int nbits) noexcept
+{
+    while(nbits)
+    {
+        const unsigned int take = std::min(nbits, 8 - used_);
+
+        nbits -= take;
+        cur_ |= ((val >> nbits) & ((1U << take) - 1)) << (8 - used_ - take);
+        used_ += take;
+
+        if(used_ == 8)
+        {
+            bytes_ += (char) cur_;
+            cur_ = 0;
+            used_ = 0;
+        }
+    }
+}
+
+
+// appendTo() - append the column to <out>, as a u32 byte count followed by the bytes, padding the final byte with zero
+// bits; then clear the column.
+//
+void TimeSeriesEncoder::BitWriter::appendTo(string& out) noexcept
+{
+    if(used_)
+    {
+        bytes_ += (char) cur_;
+        cur_ = 0;
+        used_ = 0;
+    }
+
+    appendU32(out, bytes_.length());
+    out += bytes_;
+    bytes_.clear();
+}
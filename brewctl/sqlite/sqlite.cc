@@ -123,6 +123,25 @@ bool SQLite::prepareAndStep(const std::string& sql, SQLiteStmt& stmt, Error * co
 }
 
 
+// exec() - prepare and execute the SQL statement <sql>, discarding any result set; e.g. to begin or end a transaction,
+// or to set a pragma.
+//
+bool SQLite::exec(const std::string& sql, Error * const err) noexcept
+{
+    SQLiteStmt stmt;
+
+    return prepare(sql, stmt, err) && stmt.execute(err);
+}
+
+
+// lastInsertId() - return the rowid of the row most recently inserted through this connection.
+//
+long long SQLite::lastInsertId() noexcept
+{
+    return isOpen() ? ::sqlite3_last_insert_rowid(db_) : 0;
+}
+
+
 // fmtErr() - populate Error object err (if non-null) with the supplied error code and an appropriate
 // human-readable error message.
 //
@@ -0,0 +1,200 @@
+/*
+    timeseries.cc: round-trip test of the application/x-brewctl-ts encoder and reference decoder.  Build and run with
+    "make test".
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/service/timeseriesencoder.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                       \
+    do                                                                                    \
+    {                                                                                     \
+        if(!(cond))                                                                       \
+        {                                                                                 \
+            ::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+            ++failures;                                                                   \
+        }                                                                                 \
+    } while(0)
+
+
+// sameBits() - return true if <a> and <b> have the same bit pattern (so that NaNs, and -0.0, compare as expected).
+//
+static bool sameBits(const double a, const double b)
+{
+    return !::memcmp(&a, &b, sizeof(double));
+}
+
+
+// roundTrip() - encode <n> points with <columns> values each, generated by <gen>, decode them, and check that the
+// decoded points are identical to those encoded.
+//
+template<typename F> static void roundTrip(const size_t n, const size_t columns, F gen)
+{
+    vector<int64_t> ts(n);
+    vector<double> vals(n * columns);
+    string out;
+
+    TimeSeriesEncoder enc(out, columns);
+    enc.header();
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        gen(i, ts[i], &vals[i * columns]);
+        enc.add(ts[i], &vals[i * columns]);
+    }
+
+    enc.flush();
+
+    TimeSeries::Decoder dec((const uint8_t *) out.data(), out.length());
+    double values[TimeSeries::MAX_COLUMNS];
+    int64_t t;
+    size_t i;
+
+    CHECK(dec.columns() == columns);
+
+    for(i = 0; dec.next(t, values); ++i)
+    {
+        if(i >= n)
+            break;
+
+        CHECK(t == ts[i]);
+        for(size_t c = 0; c < columns; ++c)
+            CHECK(sameBits(values[c], vals[i * columns + c]));
+    }
+
+    CHECK(i == n);
+    CHECK(!dec.error());
+}
+
+
+// writeBits() - append the low <nbits> bits of <val>, most-significant first, to the bit-string <bits>.
+//
+static void writeBits(vector<bool>& bits, const uint64_t val, unsigned int nbits)
+{
+    while(nbits--)
+        bits.push_back((val >> nbits) & 1);
+}
+
+
+// appendColumn() - append the bit-string <bits>, preceded by its length in bytes, to <out>.
+//
+static void appendColumn(string& out, const vector<bool>& bits)
+{
+    const uint32_t len = (bits.size() + 7) / 8;
+    string bytes(len, '\0');
+
+    for(size_t i = 0; i < bits.size(); ++i)
+        if(bits[i])
+            bytes[i / 8] |= 0x80 >> (i % 8);
+
+    for(int i = 0; i < 4; ++i)
+        out += (char) (len >> (i * 8));
+
+    out += bytes;
+}
+
+
+int main()
+{
+    // Regular timestamps and slowly-varying values, over several blocks
+    roundTrip(1000, 1, [](size_t i, int64_t& t, double *v)
+    {
+        t = 1500000000 + 60 * i;
+        v[0] = 18.0 + ::sin(i / 50.0);
+    });
+
+    // Irregular timestamps, exercising each delta-of-delta range, and [min, max] pairs
+    roundTrip(600, 2, [last = (int64_t) -1000](size_t i, int64_t& t, double *v) mutable
+    {
+        static const int64_t steps[] = {60, 60, 61, 0, 300, 3000, 3153600000LL, -7};
+
+        t = last = i ? (last + steps[i % 8]) : last;
+        v[0] = (i % 3) ? 20.0 : 20.0625;
+        v[1] = v[0] + i * 0.001;
+    });
+
+    // Constant, special and extreme values
+    roundTrip(300, 3, [](size_t i, int64_t& t, double *v)
+    {
+        t = i * 10;
+        v[0] = 4.0;
+        v[1] = (i % 2) ? -0.0 : NAN;
+        v[2] = (i % 5) ? 1e308 : -1e-308;
+    });
+
+    // Empty stream
+    roundTrip(0, 1, [](size_t, int64_t&, double *) {});
+
+    // A '10' value before any '11' value in the block is malformed, and must be rejected
+    {
+        string out((const char *) TimeSeries::MAGIC, sizeof(TimeSeries::MAGIC));
+        out += (char) TimeSeries::VERSION;
+        out += (char) 1;
+        out.append(3, '\0');
+        out.append("\x02\x00\x00\x00", 4);
+
+        vector<bool> ts, val;
+        writeBits(ts, 0, 64);
+        writeBits(ts, 0, 1);
+        writeBits(val, 0, 64);
+        writeBits(val, 2, 2);
+        writeBits(val, 0, 8);
+        appendColumn(out, ts);
+        appendColumn(out, val);
+
+        TimeSeries::Decoder dec((const uint8_t *) out.data(), out.length());
+        double values[1];
+        int64_t t;
+
+        CHECK(dec.next(t, values));
+        CHECK(!dec.next(t, values));
+        CHECK(dec.error());
+    }
+
+    // Truncated streams must be rejected, not over-read
+    {
+        string out;
+        TimeSeriesEncoder enc(out, 2);
+        const double v[2] = {1.0, 2.0};
+
+        enc.header();
+        for(int i = 0; i < 10; ++i)
+            enc.add(i, v);
+        enc.flush();
+
+        for(size_t len = 0; len < out.length(); ++len)
+        {
+            TimeSeries::Decoder dec((const uint8_t *) out.data(), len);
+            double values[2];
+            int64_t t;
+
+            while(dec.next(t, values))
+                ;
+
+            CHECK(dec.error() == (len != TimeSeries::HEADER_SIZE));     // A bare header is a valid, empty stream
+        }
+    }
+
+    if(failures)
+    {
+        ::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    ::printf("timeseries: all checks passed\n");
+    return 0;
+}
@@ -18,6 +18,8 @@ extern "C"
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 }
 
@@ -85,5 +87,108 @@ uint64_t getRandomHardwareAddress() noexcept
     return ret & 0xffffffffffff;
 }
 
+
+// unixAddress() - local helper function: populate <addr> with the Unix-domain socket address <path>.  Returns false,
+// having set <err>, if the path is too long.
+//
+static bool unixAddress(const string& path, struct sockaddr_un& addr, Error * const err) noexcept
+{
+    if(path.length() >= sizeof(addr.sun_path))
+    {
+        formatError(err, SOCKET_PATH_TOO_LONG, path.c_str());
+        return false;
+    }
+
+    ::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ::strcpy(addr.sun_path, path.c_str());
+
+    return true;
+}
+
+
+// listenUnix() - create a Unix-domain stream socket bound to <path>, with file permissions <mode>, and listen on it with
+// a queue of <backlog> connections.  A socket left at <path> by a previous process is replaced; any other kind of file
+// is not.  Returns the socket's fd, or -1 on error.
+//
+int listenUnix(const string& path, const mode_t mode, const int backlog, Error * const err) noexcept
+{
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if(!unixAddress(path, addr, err))
+        return -1;
+
+    if(!::lstat(path.c_str(), &st) && S_ISSOCK(st.st_mode) && ::unlink(path.c_str()))
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "unlink()");
+        return -1;
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd == -1)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "socket()");
+        return -1;
+    }
+
+    if(::bind(fd, (struct sockaddr *) &addr, sizeof(addr)))
+        formatErrorWithErrno(err, SYSCALL_FAILED, "bind()");
+    else if(::chmod(path.c_str(), mode))
+        formatErrorWithErrno(err, SYSCALL_FAILED, "chmod()");
+    else if(::listen(fd, backlog))
+        formatErrorWithErrno(err, SYSCALL_FAILED, "listen()");
+    else
+        return fd;
+
+    ::close(fd);
+    return -1;
+}
+
+
+// connectUnix() - connect a Unix-domain stream socket to <path>.  Returns the socket's fd, or -1 on error.
+//
+int connectUnix(const string& path, Error * const err) noexcept
+{
+    struct sockaddr_un addr;
+
+    if(!unixAddress(path, addr, err))
+        return -1;
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd == -1)
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "socket()");
+        return -1;
+    }
+
+    if(::connect(fd, (struct sockaddr *) &addr, sizeof(addr)))
+    {
+        formatErrorWithErrno(err, SYSCALL_FAILED, "connect()");
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+// peerCredentials() - obtain the effective user and group IDs of the process at the other end of the connected Unix-
+// domain socket <fd>, as they were when the connection was made.  Returns false on error.
+//
+bool peerCredentials(const int fd, uid_t& uid, gid_t& gid) noexcept
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+
+    if(::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) || (len != sizeof(cred)))
+        return false;
+
+    uid = cred.uid;
+    gid = cred.gid;
+
+    return true;
+}
+
 } // namespace Util::Net
 
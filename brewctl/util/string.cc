@@ -7,8 +7,9 @@
 */
 
 #include "include/util/string.h"
+#include <algorithm>    // std::min()
 #include <cstdio>       // ::sprintf()
-#include <cstdlib>      // ::strtol()
+#include <cstdlib>      // ::strtol(), ::strtod()
 #include <limits>
 
 using std::numeric_limits;
@@ -49,5 +50,35 @@ string numberToString(const int& num) noexcept
     return (string) buffer;
 }
 
+
+// nextQualityItem() - parse the element which starts at or after <pos> in <list>, a comma-separated list of the form
+// used by the HTTP Accept and Accept-Encoding headers, returning the element (e.g. a media type) in <item> and its
+// quality value (default 1) in <q>, and advance <pos> past it.  Returns false at the end of the list.
+//
+bool nextQualityItem(const string& list, size_t& pos, string& item, double& q) noexcept
+{
+    while(pos < list.length())
+    {
+        size_t end = list.find(',', pos);
+        if(end == string::npos)
+            end = list.length();
+
+        const size_t start = list.find_first_not_of(" \t", pos),
+                     itemEnd = std::min(list.find_first_of("; \t", start), end),
+                     qpos = list.find("q=", itemEnd);
+
+        pos = end + 1;
+
+        if(start < itemEnd)
+        {
+            item.assign(list, start, itemEnd - start);
+            q = (qpos < end) ? ::strtod(list.c_str() + qpos + 2, nullptr) : 1.0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 } // namespace Util::String
 
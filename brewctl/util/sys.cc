@@ -11,11 +11,13 @@
 #include "include/framework/registry.h"
 #include "include/util/string.h"
 #include <boost/regex.hpp>
+#include <chrono>
 #include <cstdlib>          // NULL
 
 extern "C"
 {
 #include <fcntl.h>
+#include <grp.h>
 #include <pthread.h>
 #include <pwd.h>
 #include <signal.h>
@@ -180,6 +182,30 @@ uid_t getUid(const string& username, Error * const err) noexcept
 }
 
 
+// getGid() - given a group name, or a numeric group ID, in <groupname>, return the corresponding group ID.  If the
+// group does not exist, return (gid_t) -1.  If an error occurs, return (gid_t) -1 and set <err> accordingly.
+//
+gid_t getGid(const string& groupname, Error * const err) noexcept
+{
+    int intGid;
+    if(Util::String::isIntStr(groupname, &intGid) && (intGid >= 0))
+        return (gid_t) intGid;
+
+    errno = 0;
+    struct group *gr = ::getgrnam(groupname.c_str());
+    if(gr == NULL)
+    {
+        if(errno)
+            formatErrorWithErrno(err, SYSCALL_FAILED, "getgrnam()");
+
+        formatError(err, NO_SUCH_GROUP, groupname.c_str());
+        return (gid_t) -1;
+    }
+
+    return gr->gr_gid;
+}
+
+
 // setUid() - given a username, or a numeric user ID, in <username>, change the user ID of the current process to the
 // specified user.  Returns true on success; false otherwise.
 //
@@ -240,7 +266,9 @@ int readPidFile(const string& filename, Error * const err) noexcept
 
 
 // writePidFile() - write the current process ID to the file specified by <filename>, after first verifying that the
-// file does not already contain the PID of a running process.  Returns true on success; false otherwise.
+// file does not already contain the PID of another running process.  (The file may contain our own PID, if this
+// process was exec'ed by a previous instance of the application during an upgrade.)  Returns true on success; false
+// otherwise.
 //
 bool writePidFile(const string& filename, Error * const err) noexcept
 {
@@ -268,7 +296,7 @@ bool writePidFile(const string& filename, Error * const err) noexcept
         if(Util::String::isIntStr(pidstr))
         {
             int pidval = ::stol(pidstr);
-            if(pidval > 0)
+            if((pidval > 0) && (pidval != ::getpid()))
             {
                 // Found a valid PID in the PID file; see whether it represents a running process.
                 errno = 0;
@@ -325,5 +353,13 @@ bool writePidFile(const string& filename, Error * const err) noexcept
     return checkSyscall(::close(fd), "close()", err);
 }
 
-} // namespace Util::Sys
 
+// monotonicTime() - return the time, in seconds, on a clock which is unaffected by changes to the system's wall-clock
+// time.  The epoch is arbitrary: only differences between values returned by this function are meaningful.
+//
+double monotonicTime() noexcept
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace Util::Sys
@@ -7,16 +7,45 @@
 */
 
 #include "include/util/url.h"
+#include <algorithm>
+#include <charconv>
 
 using std::string;
+using std::string_view;
 
 
 namespace Util
 {
 
+// hexDigit() - return the value of hex digit <c>, or -1 if <c> is not a hex digit.
+//
+static int hexDigit(const char c) noexcept
+{
+    if((c >= '0') && (c <= '9'))
+        return c - '0';
+    else if((c >= 'a') && (c <= 'f'))
+        return (c - 'a') + 10;
+    else if((c >= 'A') && (c <= 'F'))
+        return (c - 'A') + 10;
+
+    return -1;
+}
+
+
+// ctor - create an empty URL; its path and args may be set with setPath() and addArg().
+//
+URL::URL() noexcept
+    : port_(NO_PORT_SPECIFIED),
+      numArgs_(0),
+      arenaUsed_(0)
+{
+}
+
+
 // ctor - parse the supplied URL
 //
-URL::URL(string url) noexcept
+URL::URL(const string_view url) noexcept
+    : URL()
 {
     parseURL(url);
 }
@@ -24,7 +53,7 @@ URL::URL(string url) noexcept
 
 // parseURL() - parse the supplied URL; store its components in member variables.  Return a ref to the current object.
 //
-URL& URL::parseURL(string url) noexcept
+URL& URL::parseURL(string_view url) noexcept
 {
     size_t delim;
 
@@ -33,57 +62,64 @@ URL& URL::parseURL(string url) noexcept
     if(delim != url.npos)
     {
         protocol_ = url.substr(0, delim);
-        url.erase(0, delim + 3);
+        url.remove_prefix(delim + 3);
     }
     else
-        protocol_ = "";
+        protocol_ = string_view();
 
     // Extract address and port
-    delim = url.find_first_of("/?#");
-    string addressAndPort = url.substr(0, delim);
-    url.erase(0, delim);
+    delim = std::min(url.find_first_of("/?#"), url.length());
+    string_view addressAndPort = url.substr(0, delim);
+    url.remove_prefix(delim);
 
     delim = addressAndPort.find(':');
     address_ = addressAndPort.substr(0, delim);
-    addressAndPort.erase(0, delim + 1);
+    port_ = NO_PORT_SPECIFIED;
 
-    if(addressAndPort.length())
-        port_ = ::strtoul(addressAndPort.c_str(), NULL, 10);
-    else
-        port_ = NO_PORT_SPECIFIED;
+    if((delim != addressAndPort.npos) && (delim + 1 < addressAndPort.length()))
+    {
+        port_ = 0;
+        for(const char c : addressAndPort.substr(delim + 1))
+        {
+            if((c < '0') || (c > '9'))
+                break;
+
+            port_ = (port_ * 10) + (c - '0');
+        }
+    }
 
     // Parse path
     delim = url.find('#');
     if(delim != url.npos)
     {
         anchor_ = url.substr(delim + 1);
-        url.erase(delim);
+        url.remove_suffix(url.length() - delim);
     }
     else
-        anchor_ = "";
+        anchor_ = string_view();
+
+    // Extract query args.  They are decoded when looked up, not here.
+    numArgs_ = 0;
+    arenaUsed_ = 0;
+    overflow_.clear();
 
-    // Extract query args
-    args_.clear();
     delim = url.find('?');
     if(delim != url.npos)
     {
-        string query = url.substr(delim + 1);
-        url.erase(delim);
+        string_view query = url.substr(delim + 1);
+        url.remove_suffix(url.length() - delim);
 
         while(query.length())
         {
-            delim = query.find('&');
+            delim = std::min(query.find('&'), query.length());
 
-            string var = query.substr(0, delim);
-            size_t equals = var.find('=');
+            const string_view var = query.substr(0, delim);
+            const size_t equals = var.find('=');
 
-            if(equals != var.npos)
-                args_[decode(var.substr(0, equals))] = decode(var.substr(equals + 1));
-            else
-                args_[decode(var.substr(0, equals))] = "";
+            if(var.length())
+                addArg(var.substr(0, equals), (equals != var.npos) ? var.substr(equals + 1) : string_view());
 
-            query.erase(0, delim);
-            query.erase(0, 1);
+            query.remove_prefix(std::min(delim + 1, query.length()));
         }
     }
 
@@ -93,50 +129,157 @@ URL& URL::parseURL(string url) noexcept
 }
 
 
-// decode() - URL-decode the supplied string <str>; return the URL-decoded version.
+// setPath() - set the path of the URL to <path>, which is not parsed further.  Used where the components of a request
+// URL have already been separated, e.g. by the HTTP daemon.  Return a ref to the current object.
+//
+URL& URL::setPath(const string_view path) noexcept
+{
+    path_ = path;
+
+    return *this;
+}
+
+
+// addArg() - add the query arg <key>=<value>.  If <decoded> is false, the key and value will be URL-decoded when they
+// are looked up.  Returns false if the URL already holds MAX_ARGS args.
+//
+bool URL::addArg(const string_view key, const string_view value, const bool decoded) noexcept
+{
+    if(numArgs_ >= MAX_ARGS)
+        return false;
+
+    args_[numArgs_++] = {key, value, decoded, decoded};
+
+    return true;
+}
+
+
+// arg() - return the value of the query arg <key>, or an empty string if the arg does not exist.
+//
+string_view URL::arg(const string_view key) noexcept
+{
+    const Arg_t * const a = findArg(key);
+
+    return (a != nullptr) ? a->value : string_view();
+}
+
+
+// argInt() - if the query arg <key> exists and is an integer, store its value in <val> and return true; otherwise
+// return false, leaving <val> unchanged.
+//
+bool URL::argInt(const string_view key, long long& val) noexcept
+{
+    const Arg_t * const a = findArg(key);
+    if(a == nullptr)
+        return false;
+
+    const char * const end = a->value.data() + a->value.length();
+    long long v;
+    const auto result = std::from_chars(a->value.data(), end, v);
+
+    if((result.ec != std::errc()) || (result.ptr != end))
+        return false;
+
+    val = v;
+    return true;
+}
+
+
+// argValues() - store the values of up to <max> instances of the (possibly repeated) query arg <key> in <values>, in
+// the order in which they appear in the URL.  Returns the number of values stored.
+//
+size_t URL::argValues(const string_view key, string_view *values, const size_t max) noexcept
+{
+    size_t n = 0;
+
+    for(size_t i = 0; (i < numArgs_) && (n < max); ++i)
+    {
+        Arg_t& a = args_[i];
+
+        if(decoded(a.key, a.keyDecoded) == key)
+            values[n++] = decoded(a.value, a.valueDecoded);
+    }
+
+    return n;
+}
+
+
+// findArg() - find the query arg named <key>, decoding its value if necessary.  If an arg is repeated, its last value
+// is found.  Returns nullptr if there is no such arg.
+//
+const URL::Arg_t *URL::findArg(const string_view key) noexcept
+{
+    for(size_t i = numArgs_; i--; )
+    {
+        Arg_t& a = args_[i];
+
+        if(decoded(a.key, a.keyDecoded) == key)
+        {
+            decoded(a.value, a.valueDecoded);
+            return &a;
+        }
+    }
+
+    return nullptr;
+}
+
+
+// decoded() - URL-decode <str> in place, i.e. replace it with a view of its decoded form, unless <isDecoded> is set;
+// then set <isDecoded>.  The decoded form is written to the arena or, if the arena is full, to the overflow list.
+// Returns the (decoded) string.
 //
-string URL::decode(const string& str) noexcept
+string_view URL::decoded(string_view& str, bool& isDecoded) noexcept
 {
-    string ret;
-    unsigned char val = 0;
-    int encoded_seq = 0, bad = 0;
+    if(isDecoded)
+        return str;
+
+    isDecoded = true;
+
+    if(str.find('%') == str.npos)
+        return str;
 
-    for(auto it = str.begin(); it != str.end(); ++it)
+    if(str.length() <= (ARENA_SIZE - arenaUsed_))
     {
-        if(*it == '%')
-            encoded_seq = 1;
+        char * const out = arena_ + arenaUsed_;
+        const size_t len = decode(str, out);
+
+        arenaUsed_ += len;
+        return str = string_view(out, len);
+    }
+
+    overflow_.emplace_front(str.length(), '\0');
+
+    string& out = overflow_.front();
+    out.resize(decode(str, &out[0]));
+
+    return str = out;
+}
+
+
+// decode() - URL-decode the supplied string <str> into <out>, which must have room for at least str.length() chars;
+// return the length of the decoded string.  Malformed escape sequences are dropped.
+//
+size_t URL::decode(const string_view str, char *out) noexcept
+{
+    size_t len = 0;
+
+    for(size_t i = 0; i < str.length(); ++i)
+    {
+        if(str[i] != '%')
+            out[len++] = str[i];
         else
         {
-            if(!encoded_seq)
-                ret += *it;
-            else
-            {
-                if((*it >= '0') && (*it <= '9'))
-                    val += *it - '0';
-                else if((*it >= 'a') && (*it <= 'f'))
-                    val += (*it - 'a') + 10;
-                else if((*it >= 'A') && (*it <= 'F'))
-                    val += (*it - 'A') + 10;
-                else
-                    bad = 1;
-
-                if(encoded_seq == 1)
-                    val <<= 4;
-
-                if(++encoded_seq == 3)
-                {
-                    if(!bad)
-                        ret += val;
-                    val = 0;
-                    encoded_seq = 0;
-                    bad = 0;
-                }
-            }
+            const int hi = (i + 1 < str.length()) ? hexDigit(str[i + 1]) : -1,
+                      lo = (i + 2 < str.length()) ? hexDigit(str[i + 2]) : -1;
+
+            if((hi >= 0) && (lo >= 0))
+                out[len++] = (char) ((hi << 4) | lo);
+
+            i += 2;
         }
     }
 
-    return ret;
+    return len;
 }
 
 } // namespace Util
-
@@ -0,0 +1,181 @@
+/*
+    windowedaggregate.cc: sliding-window aggregates (mean, min, max, variance) over a stream of weighted samples.  The
+    window is divided into a fixed number of buckets; adding a sample touches only the current bucket, and expired
+    buckets are folded out as the window slides, so the cost per sample is O(1) regardless of the window length.
+
+    Stuart Wallace <stuartw@atom.net>, January 2018.
+
+    Part of brewctl
+*/
+
+#include "include/util/windowedaggregate.h"
+#include <cmath>
+
+
+namespace Util
+{
+
+// ctor - <window> is the window length, in seconds; <nbuckets> the number of buckets into which it is divided.  The
+// window slides in steps of one bucket, so the effective window length varies by up to window / nbuckets.
+//
+WindowedAggregate::WindowedAggregate(const double window, const size_t nbuckets) noexcept
+    : window_((window > 0.0) ? window : 1.0),
+      buckets_(nbuckets ? nbuckets : 1)
+{
+    bucketLen_ = window_ / buckets_.size();
+    reset();
+}
+
+
+// reset() - discard all samples.
+//
+void WindowedAggregate::reset() noexcept
+{
+    for(auto& bucket : buckets_)
+        clearBucket(bucket);
+
+    current_ = 0;
+    start_ = -1.0;
+    ref_ = 0.0;
+    last_ = 0.0;
+    weight_ = sum_ = sumSq_ = 0.0;
+    min_ = max_ = 0.0;
+}
+
+
+// clearBucket() - empty a single bucket.
+//
+void WindowedAggregate::clearBucket(Bucket_t& bucket) noexcept
+{
+    bucket.weight = bucket.sum = bucket.sumSq = 0.0;
+    bucket.min = HUGE_VAL;
+    bucket.max = -HUGE_VAL;
+}
+
+
+// add() - add a sample of <value>, with weight <weight>, at time <now> (seconds).  Weights allow time-weighted
+// aggregates: e.g. to compute a duty cycle, add the effector state (0 or 1) weighted by the time spent in that state.
+//
+void WindowedAggregate::add(const double now, const double value, const double weight) noexcept
+{
+    advance(now);
+    last_ = value;
+
+    if(weight <= 0.0)
+        return;
+
+    if(start_ < 0.0)
+    {
+        start_ = now;
+        ref_ = value;
+        min_ = max_ = value;
+    }
+
+    Bucket_t& bucket = buckets_[current_ % buckets_.size()];
+    const double d = value - ref_;
+
+    bucket.weight += weight;
+    bucket.sum += weight * d;
+    bucket.sumSq += weight * d * d;
+    bucket.min = std::fmin(bucket.min, value);
+    bucket.max = std::fmax(bucket.max, value);
+
+    weight_ += weight;
+    sum_ += weight * d;
+    sumSq_ += weight * d * d;
+    min_ = std::fmin(min_, value);
+    max_ = std::fmax(max_, value);
+}
+
+
+// advance() - slide the window forward to time <now>, expiring any buckets which have fallen out of it.  Expiry is
+// done a bucket at a time, and the totals are then recomputed from the surviving buckets; this is O(nbuckets) per
+// bucket boundary crossed, rather than per sample, and avoids accumulating rounding error in the running totals.
+//
+void WindowedAggregate::advance(const double now) noexcept
+{
+    const int64_t idx = (int64_t) ::floor(now / bucketLen_);
+
+    if(start_ < 0.0)
+    {
+        current_ = idx;
+        return;
+    }
+
+    if(idx <= current_)
+        return;
+
+    if((size_t) (idx - current_) >= buckets_.size())
+    {
+        reset();
+        current_ = idx;
+        return;
+    }
+
+    while(current_ < idx)
+        clearBucket(buckets_[++current_ % buckets_.size()]);
+
+    recompute();
+}
+
+
+// recompute() - recalculate the window totals from the buckets.  If the window has become empty, forget its start
+// time, so that coverage() restarts from the next sample.
+//
+void WindowedAggregate::recompute() noexcept
+{
+    weight_ = sum_ = sumSq_ = 0.0;
+    min_ = HUGE_VAL;
+    max_ = -HUGE_VAL;
+
+    for(const auto& bucket : buckets_)
+    {
+        if(bucket.weight > 0.0)
+        {
+            weight_ += bucket.weight;
+            sum_ += bucket.sum;
+            sumSq_ += bucket.sumSq;
+            min_ = std::fmin(min_, bucket.min);
+            max_ = std::fmax(max_, bucket.max);
+        }
+    }
+
+    if(weight_ <= 0.0)
+    {
+        const int64_t current = current_;
+        reset();
+        current_ = current;
+    }
+}
+
+
+// coverage() - return the length of time, in seconds, for which samples have been continuously present in the window.
+// A rule such as "for 10 minutes" should only be evaluated once coverage() reaches the window length.
+//
+double WindowedAggregate::coverage(const double now) const noexcept
+{
+    return (start_ < 0.0) ? 0.0 : now - start_;
+}
+
+
+// mean() - return the weighted mean of the samples in the window, or 0 if the window is empty.
+//
+double WindowedAggregate::mean() const noexcept
+{
+    return (weight_ > 0.0) ? ref_ + (sum_ / weight_) : 0.0;
+}
+
+
+// variance() - return the weighted (population) variance of the samples in the window, or 0 if the window is empty.
+//
+double WindowedAggregate::variance() const noexcept
+{
+    if(weight_ <= 0.0)
+        return 0.0;
+
+    const double m = sum_ / weight_;
+
+    return std::fmax(0.0, (sumSq_ / weight_) - (m * m));
+}
+
+} // namespace Util